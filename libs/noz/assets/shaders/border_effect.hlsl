@@ -10,11 +10,6 @@ cbuffer CameraBuffer : register(b0, space1)
     float4x4 lightViewProjection;
 };
 
-cbuffer ObjectBuffer : register(b1, space1)
-{
-    float4x4 m;
-};
-
 struct VertexInput
 {
     float3 position : POSITION;
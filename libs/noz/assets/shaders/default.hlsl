@@ -12,8 +12,9 @@ struct VertexOutput
 
 VertexOutput vs(VertexInput input)
 {
-    float4x4 bone = bones[input.bone_index % 32];
-    float4 skinned_position = mul(bone, float4(input.position, 1.0));
+    float4x4 m = GetObjectTransform(input);
+    float4x4 bone = GetBoneTransform(input);
+    float4 skinned_position = mul(bone, float4(GetVertexPosition(input), 1.0));
     float4 world_position = mul(m, skinned_position);
     
     VertexOutput output;
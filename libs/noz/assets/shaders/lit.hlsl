@@ -12,9 +12,10 @@ struct VertexOutput
 
 VertexOutput vs(VertexInput input)
 {
-    float4x4 bone = bones[input.bone_index % 32];
-    float4 skinned_position = mul(bone, float4(input.position, 1.0));
-    float3 skinned_normal = normalize(mul((float3x3) bone, input.normal));
+    float4x4 m = GetObjectTransform(input);
+    float4x4 bone = GetBoneTransform(input);
+    float4 skinned_position = mul(bone, float4(GetVertexPosition(input), 1.0));
+    float3 skinned_normal = normalize(mul((float3x3) bone, GetVertexNormal(input)));
     float4 world_position = mul(m, skinned_position);
     float3 world_normal = normalize(mul((float3x3) m, skinned_normal));
 
@@ -2,30 +2,7 @@
 
 //@ VERTEX
 
-cbuffer CameraBuffer : register(vs_b0, space1)
-{
-    float4x4 vp;
-    float4x4 v;
-    float4x4 lightViewProjection;
-};
-
-cbuffer ObjectBuffer : register(vs_b1, space1)
-{
-    float4x4 m;
-};
-
-cbuffer BoneBuffer : register(vs_b2, space1)
-{
-    float4x4 boneTransforms[16]; // Bone skinning matrices (world transform * inverse bind pose)
-};
-
-struct VertexInput
-{
-    float3 position : POSITION;
-    float2 uv0 : TEXCOORD1;
-    float3 normal : TEXCOORD0;
-    float2 boneIndex : TEXCOORD2; // Single bone index per vertex
-};
+#include "../../shader_include/mesh.hlsl"
 
 struct VertexOutput
 {
@@ -34,13 +11,9 @@ struct VertexOutput
 
 VertexOutput vs(VertexInput input)
 {
-    // Apply bone skinning to position (limit to 16 bones)
-    int boneIndex = int(input.boneIndex.x) % 16; // Clamp to 16 bones
-    float4x4 boneTransform = boneTransforms[boneIndex];
-    
     // Apply bone transform to position
-    float4 skinnedPosition = mul(boneTransform, float4(input.position, 1.0));
-    float4x4 mvp = mul(lightViewProjection, m);
+    float4 skinnedPosition = mul(GetBoneTransform(input), float4(GetVertexPosition(input), 1.0));
+    float4x4 mvp = mul(lightViewProjection, GetObjectTransform(input));
     
     // Apply light view-projection matrix directly
     VertexOutput output;
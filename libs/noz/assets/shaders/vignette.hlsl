@@ -12,7 +12,7 @@ VertexOutput vs(VertexInput input)
 {
     VertexOutput output;
     // For fullscreen effects, we use the vertex positions directly as NDC coordinates
-    output.position = float4(input.position.xy, 0.0, 1.0);
+    output.position = float4(GetVertexPosition(input).xy, 0.0, 1.0);
     output.uv0 = input.uv0;
     return output;
 }
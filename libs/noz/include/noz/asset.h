@@ -16,6 +16,7 @@ constexpr asset_signature_t ASSET_SIGNATURE_SHADER      = 0x4E5A5348;  // 'NZSH'
 constexpr asset_signature_t ASSET_SIGNATURE_MATERIAL    = 0x4E5A4D54;  // 'NZMT'
 constexpr asset_signature_t ASSET_SIGNATURE_FONT        = 0x4E5A4654;  // 'NZFT'
 constexpr asset_signature_t ASSET_SIGNATURE_STYLE_SHEET = 0x4E5A5354;  // 'NZST'
+constexpr asset_signature_t ASSET_SIGNATURE_ATLAS       = 0x4E5A4154;  // 'NZAT'
 
 struct AssetHeader
 {
@@ -41,6 +42,7 @@ Object* LoadShader(Allocator* allocator, Stream* stream, AssetHeader* header, co
 Object* LoadFont(Allocator* allocator, Stream* stream, AssetHeader* header, const char* name);
 Object* LoadMesh(Allocator* allocator, Stream* stream, AssetHeader* header, const char* name);
 Object* LoadStyleSheet(Allocator* allocator, Stream* stream, AssetHeader* header, const char* name);
+Object* LoadAtlas(Allocator* allocator, Stream* stream, AssetHeader* header, const char* name);
 
 // @macros
 #define NOZ_LOAD_SHADER(path, member) \
@@ -56,4 +58,7 @@ Object* LoadStyleSheet(Allocator* allocator, Stream* stream, AssetHeader* header
     member = (Mesh*)LoadAsset(g_asset_allocator, path, ASSET_SIGNATURE_MESH, LoadMesh);
 
 #define NOZ_LOAD_FONT(path, member) \
-    member = (Font*)LoadAsset(g_asset_allocator, path, ASSET_SIGNATURE_FONT, LoadFont);
\ No newline at end of file
+    member = (Font*)LoadAsset(g_asset_allocator, path, ASSET_SIGNATURE_FONT, LoadFont);
+
+#define NOZ_LOAD_ATLAS(path, member) \
+    member = (Atlas*)LoadAsset(g_asset_allocator, path, ASSET_SIGNATURE_ATLAS, LoadAtlas);
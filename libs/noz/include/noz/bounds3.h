@@ -15,6 +15,7 @@ bool contains(const bounds3& bounds, const vec3& point);
 bool intersects(const bounds3& bounds, const bounds3& point);
 bounds3 expand(const bounds3& bounds, const vec3& point);
 bounds3 expand(const bounds3& bounds, const bounds3& other);
+bounds3 transform(const bounds3& bounds, const mat4& matrix);
 
 #if 0
 
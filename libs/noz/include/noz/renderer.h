@@ -12,7 +12,9 @@ struct Mesh : Object {};
 struct Font : Object {};
 struct Shader : Object {};
 struct MeshBuilder : Object {};
+struct StaticBatch : Object {};
 struct Animation : Object {};
+struct Atlas : Object {};
 
 // @renderer_traits
 struct RendererTraits
@@ -26,7 +28,16 @@ struct RendererTraits
     size_t max_frame_commands;
     size_t max_frame_objects;
     size_t max_frame_transforms;
+    size_t frame_memory_size;
+    size_t staging_memory_size;
+    size_t mesh_heap_vertices;
+    size_t mesh_heap_indices;
     uint32_t shadow_map_size;
+    uint32_t occlusion_width;
+    uint32_t occlusion_height;
+    size_t texture_memory_budget;
+    u32 glyph_cache_size;
+    size_t max_text_runs;
 };
 
 // @texture
@@ -48,14 +59,106 @@ enum TextureFormat
 {
     TEXTURE_FORMAT_RGBA8,
     TEXTURE_FORMAT_RGBA16F,
-    TEXTURE_FORMAT_R8
+    TEXTURE_FORMAT_R8,
+    TEXTURE_FORMAT_BC1,
+    TEXTURE_FORMAT_BC3,
+    TEXTURE_FORMAT_BC4,
+    TEXTURE_FORMAT_BC5,
+    TEXTURE_FORMAT_BC7,
+    TEXTURE_FORMAT_COUNT
 };
 
 Texture* CreateTexture(Allocator* allocator, void* data, size_t width, size_t height, TextureFormat format, const char* name);
 Texture* CreateTexture(Allocator* allocator, int width, int height, TextureFormat format, const char* name);
 int GetBytesPerPixel(TextureFormat format);
+bool IsBlockCompressed(TextureFormat format);
+u32 GetTextureLevelSize(TextureFormat format, u32 width, u32 height);
 ivec2 GetSize(Texture* texture);
 
+struct TextureStreamingStats
+{
+    size_t resident_size;
+    size_t budget;
+    size_t texture_count;
+    size_t pending_count;
+    size_t evicted_count;
+};
+
+TextureStreamingStats GetTextureStreamingStats();
+
+// @atlas
+
+// trim_min and trim_max are the part of the source image, from 0 to 1, that uv_min and uv_max cover
+// once transparent borders were trimmed
+struct AtlasImage
+{
+    vec2 uv_min;
+    vec2 uv_max;
+    ivec2 size;
+    int page;
+    vec2 trim_min;
+    vec2 trim_max;
+};
+
+int GetPageCount(Atlas* atlas);
+Texture* GetTexture(Atlas* atlas, int page=0);
+const AtlasImage* GetImage(Atlas* atlas, const char* name);
+
+// @font
+enum FontType
+{
+    FONT_TYPE_SDF,
+    FONT_TYPE_MSDF,
+    FONT_TYPE_MTSDF
+};
+
+struct FontGlyph
+{
+    vec2 uv_min;
+    vec2 uv_max;
+    vec2 size;
+    float advance;
+    vec2 bearing;
+    vec2 sdf_offset;
+};
+
+const FontGlyph* GetGlyph(Font* font, u32 codepoint);
+float GetKerning(Font* font, u32 first, u32 second);
+float GetBaseline(Font* font);
+float GetLineHeight(Font* font);
+Texture* GetTexture(Font* font);
+FontType GetFontType(Font* font);
+
+// @text
+enum TextAlign
+{
+    TEXT_ALIGN_LEFT,
+    TEXT_ALIGN_CENTER,
+    TEXT_ALIGN_RIGHT
+};
+
+// Positions are relative to the top left of the text with y pointing down
+struct TextQuad
+{
+    vec2 position_min;
+    vec2 position_max;
+    vec2 uv_min;
+    vec2 uv_max;
+};
+
+struct TextRun
+{
+    TextQuad* quads;
+    int quad_count;
+    int line_count;
+    vec2 size;
+};
+
+// The run is cached and stays valid until a later layout reuses its slot, a max_width of zero
+// disables wrapping
+const TextRun* LayoutText(Font* font, float font_size, const char* text, float max_width=0.0f, TextAlign align=TEXT_ALIGN_LEFT);
+vec2 MeasureText(Font* font, float font_size, const char* text, float max_width=0.0f);
+
 // @material
 Material* CreateMaterial(Allocator* allocator, Shader* shader);
 Shader* GetShader(Material* material);
@@ -72,7 +175,21 @@ Mesh* CreateMesh(
     size_t index_count,
     u16* indices,
     const char* name);
+Mesh* CreateMesh(
+    Allocator* allocator,
+    size_t vertex_count,
+    vec3* positions,
+    vec3* normals,
+    vec2* uvs,
+    u8* bone_indices,
+    size_t index_count,
+    u32* indices,
+    const char* name);
 Mesh* CreateMesh(Allocator* allocator, MeshBuilder* builder, const char* name);
+void Destroy(Mesh* mesh);
+size_t GetVertexCount(Mesh* mesh);
+size_t GetIndexCount(Mesh* mesh);
+bounds3 GetBounds(Mesh* mesh);
 
 // @mesh_builder
 MeshBuilder* CreateMeshBuilder(Allocator* allocator, int max_vertices, int max_indices);
@@ -81,11 +198,12 @@ vec3* GetPositions(MeshBuilder* builder);
 vec3* GetNormals(MeshBuilder* builder);
 vec2* GetUvs(MeshBuilder* builder);
 u8* GetBoneIndices(MeshBuilder* builder);
-u16* GetIndices(MeshBuilder* builder);
+u32* GetIndices(MeshBuilder* builder);
 size_t GetVertexCount(MeshBuilder* builder);
 size_t GetIndexCount(MeshBuilder* builder);
-void AddIndex(MeshBuilder* builder, uint16_t index);
-void AddTriangle(MeshBuilder* builder, uint16_t a, uint16_t b, uint16_t c);
+bool AddMesh(MeshBuilder* builder, Mesh* mesh, const mat4& transform);
+void AddIndex(MeshBuilder* builder, uint32_t index);
+void AddTriangle(MeshBuilder* builder, uint32_t a, uint32_t b, uint32_t c);
 void AddTriangle(MeshBuilder* builder, vec3 a, vec3 b, vec3 c, uint8_t bone_index);
 void AddPyramid(MeshBuilder* builder, vec3 start, vec3 end, float size, uint8_t bone_index);
 void AddCube(MeshBuilder* builder, vec3 center, vec3 size, uint8_t bone_index);
@@ -114,6 +232,16 @@ void AddQuad(
     vec2 uv_color,
     vec3 normal,
     uint8_t bone_index);
+void AddQuad(
+    MeshBuilder* builder,
+    vec3 a,
+    vec3 b,
+    vec3 c,
+    vec3 d,
+    vec2 uv_min,
+    vec2 uv_max,
+    vec3 normal,
+    uint8_t bone_index);
 void AddVertex(
     MeshBuilder* builder,
     vec3 position,
@@ -121,11 +249,46 @@ void AddVertex(
     vec2 uv,
     uint8_t bone_index);
 
+// @static_batch
+StaticBatch* CreateStaticBatch(Allocator* allocator, const bounds3& bounds, float chunk_size, int max_instances);
+int AddStaticInstance(StaticBatch* batch, Mesh* mesh, Material* material, const mat4& transform, color_t color);
+void RemoveStaticInstance(StaticBatch* batch, int instance);
+void UpdateStaticBatch(StaticBatch* batch);
+void DrawStaticBatch(StaticBatch* batch);
+
 // @renderer
 void SetGammaPassShader(Shader* shader);
 void SetShadowPassShader(Shader* shader);
+void PrewarmPipelines(Shader** shaders, size_t shader_count);
+
+// @upload
+struct UploadStats
+{
+    size_t bytes_uploaded;
+    size_t upload_count;
+    size_t flush_count;
+};
+
+UploadStats GetUploadStats();
 
 // @render_buffer
+struct RenderBufferStats
+{
+    size_t command_count;
+    size_t transform_count;
+    size_t draw_count;
+    size_t chunk_count;
+    size_t memory_used;
+    size_t dropped_command_count;
+    size_t peak_command_count;
+    size_t peak_transform_count;
+    size_t tested_draw_count;
+    size_t culled_draw_count;
+    size_t occluded_draw_count;
+    size_t triangle_count;
+    size_t lod_saved_triangle_count;
+};
+
 void ClearRenderCommands();
 void BeginRenderPass(bool clear, color_t clear_color, bool msaa, Texture* target);
 void BeginShadowPass(mat4 light_view, mat4 light_projection);
@@ -134,6 +297,10 @@ void BindColor(color_t color);
 void BindCamera(Camera* camera);
 void BindCamera(const mat4& view, const mat4& projection);
 void BindTransform(const mat4& transform);
+void BindBoneTransforms(const mat4* bones, size_t bone_count);
+void UnbindBoneTransforms();
 void BindMaterial(Material* material);
 void DrawMesh(Mesh* mesh);
-void EndRenderPass();
\ No newline at end of file
+void DrawOccluder(Mesh* mesh);
+void EndRenderPass();
+RenderBufferStats GetRenderBufferStats();
\ No newline at end of file
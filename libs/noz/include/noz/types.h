@@ -15,6 +15,8 @@ constexpr type_t TYPE_LIST = -901;
 constexpr type_t TYPE_MAP = -902;
 constexpr type_t TYPE_PROPS = -903;
 constexpr type_t TYPE_MESH_BUILDER = -904;
+constexpr type_t TYPE_STATIC_BATCH = -905;
+constexpr type_t TYPE_CANVAS = -906;
 
 // @asset
 constexpr type_t TYPE_MATERIAL = -800;
@@ -24,6 +26,7 @@ constexpr type_t TYPE_MESH = -803;
 constexpr type_t TYPE_SOUND = -804;
 constexpr type_t TYPE_TEXTURE = -805;
 constexpr type_t TYPE_STYLE_SHEET = -806;
+constexpr type_t TYPE_ATLAS = -807;
 
 // @scene
 constexpr type_t TYPE_ENTITY = -700;
@@ -6,6 +6,7 @@
 
 // @types
 struct StyleSheet : Object {};
+struct Canvas : Object {};
 
 // @style
 
@@ -112,3 +113,22 @@ void MergeStyles(Style* dst, const Style* src);
 // @stylesheet
 const Style& GetStyle(StyleSheet* sheet, const name_t* name);
 bool HasStyle(StyleSheet* sheet, const name_t* name);
+
+// @canvas
+Canvas* CreateCanvas(Allocator* allocator, int max_labels);
+int AddLabel(
+    Canvas* canvas,
+    Font* font,
+    Material* material,
+    float font_size,
+    const char* text,
+    const vec2& position,
+    color_t color,
+    float max_width=0.0f,
+    TextAlign align=TEXT_ALIGN_LEFT);
+void RemoveLabel(Canvas* canvas, int label);
+void SetLabelText(Canvas* canvas, int label, const char* text);
+void SetLabelPosition(Canvas* canvas, int label, const vec2& position);
+void SetLabelColor(Canvas* canvas, int label, color_t color);
+void UpdateCanvas(Canvas* canvas);
+void DrawCanvas(Canvas* canvas);
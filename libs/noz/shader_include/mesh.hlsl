@@ -6,20 +6,50 @@ cbuffer CameraBuffer : register(b0, space1)
     float4x4 lightViewProjection;
 };
 
-cbuffer ObjectBuffer : register(b1, space1)
-{
-    float4x4 m;
-};
+// Object and bone matrices for the whole frame, indexed by the per draw instance data
+StructuredBuffer<float4x4> transforms : register(t0, space0);
 
-cbuffer BoneBuffer : register(b2, space1)
-{
-    float4x4 bones[32];
-};
+#define VERTEX_FORMAT_FLOAT 0
 
 struct VertexInput
 {
-    float3 position : POSITION;
+    float4 position : POSITION;             // xyz position, w bone index
     float2 uv0 : TEXCOORD0;
-    float3 normal : TEXCOORD1;
-    float bone_index : TEXCOORD2;
+    float3 normal : TEXCOORD1;              // octahedral encoded in xy for compact formats
+    uint4 draw : TEXCOORD2;                 // transform index, bone offset, vertex format
+    float4 position_scale : TEXCOORD3;
+    float4 position_offset : TEXCOORD4;
 };
+
+float4 DecodePosition(VertexInput input)
+{
+    return input.position * input.position_scale + input.position_offset;
+}
+
+float3 GetVertexPosition(VertexInput input)
+{
+    return DecodePosition(input).xyz;
+}
+
+float3 GetVertexNormal(VertexInput input)
+{
+    if (input.draw.z == VERTEX_FORMAT_FLOAT)
+        return input.normal;
+
+    float2 e = input.normal.xy;
+    float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+float4x4 GetObjectTransform(VertexInput input)
+{
+    return transforms[input.draw.x];
+}
+
+float4x4 GetBoneTransform(VertexInput input)
+{
+    return transforms[input.draw.y + (uint)round(DecodePosition(input).w)];
+}
@@ -21,7 +21,16 @@ static ApplicationTraits g_default_traits =
         .max_frame_commands = 2048,
         .max_frame_objects = 128,
         .max_frame_transforms = 1024,
+        .frame_memory_size = 8 * noz::MB,
+        .staging_memory_size = 24 * noz::MB,
+        .mesh_heap_vertices = 256 * 1024,
+        .mesh_heap_indices = 1024 * 1024,
         .shadow_map_size = 2048,
+        .occlusion_width = 256,
+        .occlusion_height = 128,
+        .texture_memory_budget = 128 * noz::MB,
+        .glyph_cache_size = 512,
+        .max_text_runs = 256,
     }
 };
 
@@ -113,6 +122,9 @@ void InitApplication(ApplicationTraits* traits)
 
     if (traits->load_assets)
         traits->load_assets(traits->asset_memory_size);
+
+    // everything loaded goes to the gpu as one batch
+    FlushUploads();
 }
 
 // @shutdown
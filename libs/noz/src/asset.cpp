@@ -42,6 +42,7 @@ type_t ToType(asset_signature_t signature)
         case ASSET_SIGNATURE_SHADER:   return TYPE_SHADER;
         case ASSET_SIGNATURE_MATERIAL: return TYPE_MATERIAL;
         case ASSET_SIGNATURE_FONT:     return TYPE_FONT;
+        case ASSET_SIGNATURE_ATLAS:    return TYPE_ATLAS;
         default:                       return TYPE_UNKNOWN;
     }
 }
@@ -83,7 +84,7 @@ void SetAssetPath(Path* dst, const name_t* name, const char* ext)
     path_set_extension(dst, ext);
 }
 
-Stream* LoadAssetStream(Allocator* allocator, const char* asset_name, asset_signature_t signature)
+std::filesystem::path GetAssetPath(const char* asset_name, asset_signature_t signature)
 {
     assert(asset_name);
 
@@ -102,8 +103,13 @@ Stream* LoadAssetStream(Allocator* allocator, const char* asset_name, asset_sign
     
     asset_path /= asset_name;
     asset_path += GetExtensionFromSignature(signature);
+    return asset_path;
+}
 
-    return LoadStream(allocator, asset_path);
+Stream* LoadAssetStream(Allocator* allocator, const char* asset_name, asset_signature_t signature)
+{
+    assert(asset_name);
+    return LoadStream(allocator, GetAssetPath(asset_name, signature));
 }
 
 Object* LoadAsset(Allocator* allocator, const char* asset_name, asset_signature_t signature, AssetLoaderFunc loader)
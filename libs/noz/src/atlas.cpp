@@ -0,0 +1,114 @@
+//
+//  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
+//
+
+struct AtlasImpl
+{
+    OBJECT_BASE;
+    int page_count;
+    int image_count;
+    Texture** pages;
+    u64* hashes;
+    AtlasImage* images;
+};
+
+static AtlasImpl* Impl(Atlas* a) { return (AtlasImpl*)Cast(a, TYPE_ATLAS); }
+
+Object* LoadAtlas(Allocator* allocator, Stream* stream, AssetHeader* header, const char* name)
+{
+    auto page_count = (int)ReadU32(stream);
+    auto image_count = (int)ReadU32(stream);
+    if (page_count <= 0)
+        return nullptr;
+
+    auto atlas_size =
+        sizeof(AtlasImpl) +
+        page_count * sizeof(Texture*) +
+        image_count * sizeof(u64) +
+        image_count * sizeof(AtlasImage);
+
+    auto atlas = (Atlas*)CreateObject(allocator, atlas_size, TYPE_ATLAS);
+    if (!atlas)
+        return nullptr;
+
+    auto impl = Impl(atlas);
+    impl->page_count = page_count;
+    impl->image_count = image_count;
+    impl->pages = (Texture**)(impl + 1);
+    impl->hashes = (u64*)(impl->pages + page_count);
+    impl->images = (AtlasImage*)(impl->hashes + image_count);
+
+    // Images are stored sorted by name hash
+    for (int i = 0; i < image_count; i++)
+    {
+        AtlasImage& image = impl->images[i];
+        impl->hashes[i] = ReadU64(stream);
+        image.page = (int)ReadU32(stream);
+        image.uv_min.x = ReadFloat(stream);
+        image.uv_min.y = ReadFloat(stream);
+        image.uv_max.x = ReadFloat(stream);
+        image.uv_max.y = ReadFloat(stream);
+        image.size.x = (int)ReadU32(stream);
+        image.size.y = (int)ReadU32(stream);
+
+        // Version 1 atlases were never trimmed
+        image.trim_min = vec2(0.0f);
+        image.trim_max = vec2(1.0f);
+        if (header->version >= 2)
+        {
+            image.trim_min.x = ReadFloat(stream);
+            image.trim_min.y = ReadFloat(stream);
+            image.trim_max.x = ReadFloat(stream);
+            image.trim_max.y = ReadFloat(stream);
+        }
+    }
+
+    // Every page is a complete texture asset
+    for (int i = 0; i < page_count; i++)
+    {
+        AssetHeader page_header = {};
+        impl->pages[i] = nullptr;
+        if (ReadAssetHeader(stream, &page_header) && ValidateAssetHeader(&page_header, ASSET_SIGNATURE_TEXTURE))
+            impl->pages[i] = (Texture*)LoadTexture(allocator, stream, &page_header, name);
+
+        if (!impl->pages[i])
+            return nullptr;
+    }
+
+    return (Object*)impl;
+}
+
+int GetPageCount(Atlas* atlas)
+{
+    return Impl(atlas)->page_count;
+}
+
+Texture* GetTexture(Atlas* atlas, int page)
+{
+    auto impl = Impl(atlas);
+    assert(page >= 0 && page < impl->page_count);
+    return impl->pages[page];
+}
+
+const AtlasImage* GetImage(Atlas* atlas, const char* name)
+{
+    assert(name);
+
+    auto impl = Impl(atlas);
+    u64 hash = Hash(name);
+    int lo = 0;
+    int hi = impl->image_count;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (impl->hashes[mid] < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < impl->image_count && impl->hashes[lo] == hash)
+        return &impl->images[lo];
+
+    return nullptr;
+}
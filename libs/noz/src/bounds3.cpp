@@ -16,9 +16,7 @@ bounds3 to_bounds(const vec3* positions, size_t count)
         max_pos = glm::max(max_pos, positions[i]);
 	}
 
-    vec3 center = (min_pos + max_pos) * 0.5f;
-    vec3 extents = (max_pos - min_pos) * 0.5f;
-    return bounds3(center, extents);
+    return { min_pos, max_pos };
 }
 
 bool contains(const bounds3& bounds, const vec3& point)
@@ -57,3 +55,15 @@ bounds3 expand(const bounds3& bounds, const bounds3& other)
 	return { min, max };
 }
 
+bounds3 transform(const bounds3& bounds, const mat4& matrix)
+{
+    // Transform the center and project the extents onto the absolute basis vectors (Arvo)
+    vec3 center = (bounds.min + bounds.max) * 0.5f;
+    vec3 extents = (bounds.max - bounds.min) * 0.5f;
+    vec3 world_center = vec3(matrix * vec4(center, 1.0f));
+    vec3 world_extents =
+        abs(vec3(matrix[0])) * extents.x +
+        abs(vec3(matrix[1])) * extents.y +
+        abs(vec3(matrix[2])) * extents.z;
+    return { world_center - world_extents, world_center + world_extents };
+}
@@ -0,0 +1,119 @@
+//
+//  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
+//
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define NOZ_CULL_SSE 1
+#endif
+
+Frustum ToFrustum(const mat4& view_projection)
+{
+    // Gribb/Hartmann plane extraction from the rows of the clip matrix.  The near plane uses the
+    // -w..w form which is conservative when the projection maps depth to 0..1.
+    const mat4& m = view_projection;
+    vec4 row0 = { m[0][0], m[1][0], m[2][0], m[3][0] };
+    vec4 row1 = { m[0][1], m[1][1], m[2][1], m[3][1] };
+    vec4 row2 = { m[0][2], m[1][2], m[2][2], m[3][2] };
+    vec4 row3 = { m[0][3], m[1][3], m[2][3], m[3][3] };
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0;
+    frustum.planes[1] = row3 - row0;
+    frustum.planes[2] = row3 + row1;
+    frustum.planes[3] = row3 - row1;
+    frustum.planes[4] = row3 + row2;
+    frustum.planes[5] = row3 - row2;
+    return frustum;
+}
+
+static bool IsVisible(const Frustum& frustum, const bounds3& bounds)
+{
+    vec3 center = (bounds.min + bounds.max) * 0.5f;
+    vec3 extents = (bounds.max - bounds.min) * 0.5f;
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; i++)
+    {
+        const vec4& plane = frustum.planes[i];
+        vec3 normal = vec3(plane);
+        float d = dot(normal, center) + plane.w;
+        float r = dot(abs(normal), extents);
+        if (d + r < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+#if NOZ_CULL_SSE
+
+static __m128 AbsPS(__m128 v)
+{
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+
+// Test four boxes against every plane at once, returns a 4 bit mask of the visible boxes
+static int CullBounds4(const Frustum& frustum, const bounds3* bounds)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128 min_x = _mm_setr_ps(bounds[0].min.x, bounds[1].min.x, bounds[2].min.x, bounds[3].min.x);
+    __m128 min_y = _mm_setr_ps(bounds[0].min.y, bounds[1].min.y, bounds[2].min.y, bounds[3].min.y);
+    __m128 min_z = _mm_setr_ps(bounds[0].min.z, bounds[1].min.z, bounds[2].min.z, bounds[3].min.z);
+    __m128 max_x = _mm_setr_ps(bounds[0].max.x, bounds[1].max.x, bounds[2].max.x, bounds[3].max.x);
+    __m128 max_y = _mm_setr_ps(bounds[0].max.y, bounds[1].max.y, bounds[2].max.y, bounds[3].max.y);
+    __m128 max_z = _mm_setr_ps(bounds[0].max.z, bounds[1].max.z, bounds[2].max.z, bounds[3].max.z);
+
+    __m128 center_x = _mm_mul_ps(_mm_add_ps(min_x, max_x), half);
+    __m128 center_y = _mm_mul_ps(_mm_add_ps(min_y, max_y), half);
+    __m128 center_z = _mm_mul_ps(_mm_add_ps(min_z, max_z), half);
+    __m128 extents_x = _mm_mul_ps(_mm_sub_ps(max_x, min_x), half);
+    __m128 extents_y = _mm_mul_ps(_mm_sub_ps(max_y, min_y), half);
+    __m128 extents_z = _mm_mul_ps(_mm_sub_ps(max_z, min_z), half);
+
+    __m128 outside = _mm_setzero_ps();
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; i++)
+    {
+        const vec4& plane = frustum.planes[i];
+        __m128 nx = _mm_set1_ps(plane.x);
+        __m128 ny = _mm_set1_ps(plane.y);
+        __m128 nz = _mm_set1_ps(plane.z);
+
+        __m128 d = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(nx, center_x), _mm_mul_ps(ny, center_y)),
+            _mm_add_ps(_mm_mul_ps(nz, center_z), _mm_set1_ps(plane.w)));
+        __m128 r = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(AbsPS(nx), extents_x), _mm_mul_ps(AbsPS(ny), extents_y)),
+            _mm_mul_ps(AbsPS(nz), extents_z));
+
+        outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+    }
+
+    return ~_mm_movemask_ps(outside) & 0xF;
+}
+
+#endif
+
+size_t CullBounds(const Frustum& frustum, const bounds3* bounds, size_t count, bool* visible)
+{
+    size_t visible_count = 0;
+    size_t i = 0;
+
+#if NOZ_CULL_SSE
+    for (; i + 4 <= count; i += 4)
+    {
+        int mask = CullBounds4(frustum, bounds + i);
+        visible[i + 0] = (mask & 1) != 0;
+        visible[i + 1] = (mask & 2) != 0;
+        visible[i + 2] = (mask & 4) != 0;
+        visible[i + 3] = (mask & 8) != 0;
+        visible_count += (size_t)((mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        visible[i] = IsVisible(frustum, bounds[i]);
+        visible_count += visible[i] ? 1 : 0;
+    }
+
+    return visible_count;
+}
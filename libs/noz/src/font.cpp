@@ -1,25 +1,35 @@
 //
 //  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
 //
+//  Glyphs are found through a two level page table keyed by codepoint.  The root covers the pages
+//  up to the highest codepoint in the font and only pages that hold glyphs are allocated, so a
+//  latin font needs a single page while CJK fonts pay only for the blocks they use.  Kerning is a
+//  list of pairs sorted by codepoint and searched with a binary search.  Characters that are not
+//  in the atlas come from the glyph cache when the font carries their outlines.
+//
 
-#define MAX_GLYPHS 256  // Support extended ASCII
-#define MAX_KERNING (MAX_GLYPHS * MAX_GLYPHS)  // All possible kerning pairs
+constexpr u32 FONT_PAGE_BITS = 8;
+constexpr u32 FONT_PAGE_SIZE = 1 << FONT_PAGE_BITS;
+constexpr u32 FONT_PAGE_MASK = FONT_PAGE_SIZE - 1;
+constexpr u16 FONT_NO_GLYPH = 0xFFFF;
+constexpr u32 FONT_MAX_CODEPOINT = 0x10FFFF;
 
-struct FontGlyph
+struct FontKerning
 {
-    vec2 uv_min;
-    vec2 uv_max;
-    vec2 size;
-    float advance;
-    vec2 bearing;
-    vec2 sdf_offset;
+    u32 first;
+    u32 second;
+    float amount;
 };
 
+static_assert(sizeof(FontGlyph) == 11 * sizeof(float));
+static_assert(sizeof(FontKerning) == 12);
+
 struct FontImpl
 {
     OBJECT_BASE;
     Material* material;
     Texture* texture;
+    FontType type;
     float baseline;
     uint32_t original_font_size;
     float descent;
@@ -27,115 +37,179 @@ struct FontImpl
     float line_height;
     int atlas_width;
     int atlas_height;
-    FontGlyph glyphs[MAX_GLYPHS];     // Fixed array for glyphs (advance == 0 means no glyph)
-    uint16_t kerning_index[MAX_KERNING];  // Index into kerning_values array (0xFFFF = no kerning)
-    float* kerning_values;                 // Dynamic array of actual kerning values
-    uint16_t kerning_count;                // Number of kerning pairs
+    u32 glyph_count;
+    u32 root_count;
+    u32 kerning_count;
+    FontGlyph* glyphs;
+    u16* root;
+    u16* pages;
+    FontKerning* kerning;
+    const FontGlyph* fallback_glyph;
+    GlyphCache* glyph_cache;
 };
 
 static SDL_GPUDevice* g_device = nullptr;
 
 inline FontImpl* Impl(Font* f) { return (FontImpl*)Cast(f, TYPE_FONT); }
 
-#if 0
-static void font_destroy_impl(FontImpl* impl)
+static u32 LoadU32(const u8* data)
 {
-    assert(impl);
-    // Free dynamic kerning values array
-    if (impl->kerning_values) {
-        free(impl->kerning_values);
-        impl->kerning_values = nullptr;
-    }
+    u32 value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static u16 FindGlyph(FontImpl* impl, u32 codepoint)
+{
+    u32 page = codepoint >> FONT_PAGE_BITS;
+    if (page >= impl->root_count || impl->root[page] == FONT_NO_GLYPH)
+        return FONT_NO_GLYPH;
+
+    return impl->pages[impl->root[page] * FONT_PAGE_SIZE + (codepoint & FONT_PAGE_MASK)];
 }
-#endif
 
 Object* LoadFont(Allocator* allocator, Stream* stream, AssetHeader* header, const char* name)
 {
     if (!stream || !header)
         return nullptr;
-        
-    // Header already validated by LoadAsset
-    // Version is in header->version
 
-    auto* impl = (FontImpl*)CreateObject(allocator, sizeof(FontImpl), TYPE_FONT);
-    if (!impl)
+    // Version 1 was limited to 8 bit characters and versions before 5 sized glyph quads without
+    // the distance field border their texture rectangle holds, both have to be re-imported
+    if (header->version < 5)
         return nullptr;
 
-    // Name no longer stored in font
+    u32 original_font_size = ReadU32(stream);
+    FontType type = (FontType)ReadU32(stream);
 
-    // Arrays are already zeroed by object_create
-    // Initialize kerning index to 0xFFFF (no kerning)
-    memset(impl->kerning_index, 0xFF, sizeof(impl->kerning_index));
-    impl->kerning_values = nullptr;
-    impl->kerning_count = 0;
-
-    impl->original_font_size = ReadU32(stream);
-    impl->atlas_width = ReadU32(stream);
-    impl->atlas_height = ReadU32(stream);
-    impl->ascent = ReadFloat(stream);
-    impl->descent = ReadFloat(stream);
-    impl->line_height = ReadFloat(stream);
-    impl->baseline = ReadFloat(stream);
+    if (type != FONT_TYPE_SDF && type != FONT_TYPE_MSDF && type != FONT_TYPE_MTSDF)
+        return nullptr;
 
-    // Read glyph count and glyph data
-    uint16_t glyph_count = ReadU16(stream);
+    int atlas_width = (int)ReadU32(stream);
+    int atlas_height = (int)ReadU32(stream);
+    float ascent = ReadFloat(stream);
+    float descent = ReadFloat(stream);
+    float line_height = ReadFloat(stream);
+    float baseline = ReadFloat(stream);
+
+    // The stream is fully in memory, size the tables from the sorted codepoints in place before
+    // anything is copied
+    u32 glyph_count = ReadU32(stream);
+    size_t codepoints_position = GetPosition(stream);
+    size_t kerning_position = codepoints_position + glyph_count * (sizeof(u32) + sizeof(FontGlyph));
+    if (glyph_count >= FONT_NO_GLYPH || kerning_position + sizeof(u32) > GetSize(stream))
+        return nullptr;
 
-    // New efficient format: codepoint, then font_glyph structure directly
-    for (uint32_t i = 0; i < glyph_count; ++i)
+    const u8* codepoints = GetData(stream) + codepoints_position;
+    u32 root_count = 0;
+    u32 page_count = 0;
+    for (u32 i = 0; i < glyph_count; i++)
     {
-        uint32_t codepoint = ReadU32(stream);
-
-        if (codepoint < MAX_GLYPHS) {
-            // Read directly into the glyph structure
-            FontGlyph* glyph = &impl->glyphs[codepoint];
-            ReadBytes(stream, glyph, sizeof(FontGlyph));
-        }
-        else {
-            // Skip this glyph's data
-            SeekBegin(stream, GetPosition(stream) + sizeof(FontGlyph));
+        u32 codepoint = LoadU32(codepoints + i * sizeof(u32));
+        u32 page = codepoint >> FONT_PAGE_BITS;
+        if (codepoint > FONT_MAX_CODEPOINT || (i > 0 && codepoint <= LoadU32(codepoints + (i - 1) * sizeof(u32))))
+            return nullptr;
+
+        if (page >= root_count)
+        {
+            root_count = page + 1;
+            page_count++;
         }
     }
 
-    // Read kerning count and kerning data
-    impl->kerning_count = ReadU16(stream);
+    SetPosition(stream, kerning_position);
+    u32 kerning_count = ReadU32(stream);
+    if (GetPosition(stream) + kerning_count * sizeof(FontKerning) > GetSize(stream))
+        return nullptr;
 
-    if (impl->kerning_count > 0) {
-        // Allocate kerning values array
-        impl->kerning_values = (float*)malloc(impl->kerning_count * sizeof(float));
-        if (!impl->kerning_values) {
-            impl->kerning_count = 0;
-        }
-        else {
-            // Read all kerning pairs
-            for (uint16_t i = 0; i < impl->kerning_count; ++i)
-            {
-                uint32_t first = ReadU32(stream);
-                uint32_t second = ReadU32(stream);
-                float amount = ReadFloat(stream);
-
-                // Store in sparse representation
-                if (first < MAX_GLYPHS && second < MAX_GLYPHS) {
-                    uint32_t index = first * MAX_GLYPHS + second;
-                    impl->kerning_index[index] = i;
-                    impl->kerning_values[i] = amount;
-                }
-            }
+    size_t font_size =
+        sizeof(FontImpl) +
+        glyph_count * sizeof(FontGlyph) +
+        kerning_count * sizeof(FontKerning) +
+        root_count * sizeof(u16) +
+        page_count * FONT_PAGE_SIZE * sizeof(u16);
+
+    auto* impl = (FontImpl*)CreateObject(allocator, font_size, TYPE_FONT);
+    if (!impl)
+        return nullptr;
+
+    impl->material = nullptr;
+    impl->texture = nullptr;
+    impl->type = type;
+    impl->original_font_size = original_font_size;
+    impl->atlas_width = atlas_width;
+    impl->atlas_height = atlas_height;
+    impl->ascent = ascent;
+    impl->descent = descent;
+    impl->line_height = line_height;
+    impl->baseline = baseline;
+    impl->glyph_count = glyph_count;
+    impl->root_count = root_count;
+    impl->kerning_count = kerning_count;
+    impl->glyphs = (FontGlyph*)(impl + 1);
+    impl->kerning = (FontKerning*)(impl->glyphs + glyph_count);
+    impl->root = (u16*)(impl->kerning + kerning_count);
+    impl->pages = impl->root + root_count;
+
+    // Glyphs and kerning pairs are stored exactly as they are laid out in memory
+    SetPosition(stream, codepoints_position + glyph_count * sizeof(u32));
+    ReadBytes(stream, impl->glyphs, glyph_count * sizeof(FontGlyph));
+    SetPosition(stream, kerning_position + sizeof(u32));
+    ReadBytes(stream, impl->kerning, kerning_count * sizeof(FontKerning));
+
+    impl->glyph_cache = LoadGlyphCache(stream, type, (float)original_font_size);
+
+    memset(impl->root, 0xFF, root_count * sizeof(u16));
+    memset(impl->pages, 0xFF, page_count * FONT_PAGE_SIZE * sizeof(u16));
+    u16 next_page = 0;
+    for (u32 i = 0; i < glyph_count; i++)
+    {
+        u32 codepoint = LoadU32(codepoints + i * sizeof(u32));
+        u16& page = impl->root[codepoint >> FONT_PAGE_BITS];
+        if (page == FONT_NO_GLYPH)
+            page = next_page++;
+
+        impl->pages[page * FONT_PAGE_SIZE + (codepoint & FONT_PAGE_MASK)] = (u16)i;
+    }
+
+    // Missing characters draw the replacement character, or DEL for fonts imported without it
+    u16 fallback = FindGlyph(impl, 0xFFFD);
+    if (fallback == FONT_NO_GLYPH)
+        fallback = FindGlyph(impl, 0x7F);
+    impl->fallback_glyph = fallback != FONT_NO_GLYPH ? &impl->glyphs[fallback] : nullptr;
+
+    // The glyph cache gets a square region below the imported glyphs, whose texture coordinates
+    // shrink to match the larger texture
+    int texture_width = atlas_width;
+    int texture_height = atlas_height;
+    if (impl->glyph_cache)
+    {
+        int cache_size = GetGlyphCacheSize(impl->glyph_cache);
+        texture_width = max(atlas_width, cache_size);
+        texture_height = atlas_height + cache_size;
+
+        vec2 uv_scale = vec2((float)atlas_width / texture_width, (float)atlas_height / texture_height);
+        for (u32 i = 0; i < glyph_count; i++)
+        {
+            impl->glyphs[i].uv_min *= uv_scale;
+            impl->glyphs[i].uv_max *= uv_scale;
         }
     }
 
-    // Read atlas data
-    uint32_t atlas_data_size = impl->atlas_width * impl->atlas_height; // R8 format
-    uint8_t* atlas_data = (uint8_t*)malloc(atlas_data_size);
+    // Read atlas data, R8 for SDF fonts and RGBA8 for multi-channel fonts
+    TextureFormat atlas_format = type == FONT_TYPE_SDF ? TEXTURE_FORMAT_R8 : TEXTURE_FORMAT_RGBA8;
+    size_t texel_size = type == FONT_TYPE_SDF ? 1 : 4;
+    uint8_t* atlas_data = (uint8_t*)calloc((size_t)texture_width * texture_height, texel_size);
     if (!atlas_data)
     {
         Destroy((Font*)impl);
         return nullptr;
     }
 
-    ReadBytes(stream, atlas_data, atlas_data_size);
+    for (int y = 0; y < atlas_height; y++)
+        ReadBytes(stream, atlas_data + y * texture_width * texel_size, atlas_width * texel_size);
     // Note: stream destruction handled by caller
 
-    impl->texture = CreateTexture(allocator, atlas_data, impl->atlas_width, impl->atlas_height, TEXTURE_FORMAT_R8, name);
+    impl->texture = CreateTexture(allocator, atlas_data, texture_width, texture_height, atlas_format, name);
     free(atlas_data);
 
     if (!impl->texture)
@@ -144,7 +218,12 @@ Object* LoadFont(Allocator* allocator, Stream* stream, AssetHeader* header, cons
         return nullptr;
     }
 
-    // Create material with text shader  
+    impl->atlas_width = texture_width;
+    impl->atlas_height = texture_height;
+    if (impl->glyph_cache)
+        SetGlyphCacheTexture(impl->glyph_cache, impl->texture, ivec2(0, atlas_height), ivec2(texture_width, texture_height));
+
+    // Create material with text shader
     // TODO: Need to properly load the text shader and create material
     // For now, skip material creation
     impl->material = nullptr;
@@ -152,50 +231,46 @@ Object* LoadFont(Allocator* allocator, Stream* stream, AssetHeader* header, cons
     return (Object*)impl;
 }
 
-
-const FontGlyph* GetGlyph(Font* font, char ch)
+const FontGlyph* GetGlyph(Font* font, u32 codepoint)
 {
     FontImpl* impl = Impl(font);
-    
-    // Check if glyph exists (advance > 0 means valid glyph)
-    unsigned char index = (unsigned char)ch;
-    if (index < MAX_GLYPHS && impl->glyphs[index].advance > 0.0f) 
-    {
+
+    u16 index = FindGlyph(impl, codepoint);
+    if (index != FONT_NO_GLYPH)
         return &impl->glyphs[index];
-    }
 
-    // If character not found, try unknown glyph (ASCII DEL character)
-    unsigned char unknown_ch = 0x7F;
-    if (unknown_ch < MAX_GLYPHS && impl->glyphs[unknown_ch].advance > 0.0f) 
-    {
-        return &impl->glyphs[unknown_ch];
-    }
+    // Cached glyphs that are still being rasterized have an empty texture rectangle
+    if (impl->glyph_cache)
+        if (const FontGlyph* glyph = GetCachedGlyph(impl->glyph_cache, codepoint))
+            return glyph;
 
-    // Return default glyph if nothing found
-    static FontGlyph default_glyph = {
-        {0.0f, 0.0f},   // uv_min
-        {0.0f, 0.0f},   // uv_max
-        {0.0f, 0.0f},   // size
-        0.0f,           // advance
-        {0.0f, 0.0f},   // bearing
-        {0.0f, 0.0f}    // sdf_offset
-    };
+    if (impl->fallback_glyph)
+        return impl->fallback_glyph;
 
+    // Return default glyph if nothing found
+    static FontGlyph default_glyph = {};
     return &default_glyph;
 }
 
-float GetKerning(Font* font, char first, char second)
+float GetKerning(Font* font, u32 first, u32 second)
 {
     auto* impl = Impl(font);
-    
-    auto f = (unsigned char)first;
-    auto s = (unsigned char)second;
-    if (f < MAX_GLYPHS && s < MAX_GLYPHS)
+
+    u64 key = ((u64)first << 32) | second;
+    u32 lo = 0;
+    u32 hi = impl->kerning_count;
+    while (lo < hi)
     {
-        uint32_t index = f * MAX_GLYPHS + s;
-        uint16_t value_index = impl->kerning_index[index];
-        if (value_index != 0xFFFF && value_index < impl->kerning_count) 
-            return impl->kerning_values[value_index];
+        u32 mid = (lo + hi) / 2;
+        const FontKerning& k = impl->kerning[mid];
+        u64 mid_key = ((u64)k.first << 32) | k.second;
+        if (mid_key == key)
+            return k.amount;
+
+        if (mid_key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
 
     return 0.0f;
@@ -206,11 +281,52 @@ float GetBaseline(Font* font)
     return Impl(font)->baseline;
 }
 
+float GetLineHeight(Font* font)
+{
+    return Impl(font)->line_height;
+}
+
+Texture* GetTexture(Font* font)
+{
+    return Impl(font)->texture;
+}
+
+FontType GetFontType(Font* font)
+{
+    return Impl(font)->type;
+}
+
 Material* GetMaterial(Font* font)
 {
     return Impl(font)->material;
 }
 
+// Size the font was imported at, kerning amounts are in pixels of this size
+u32 GetFontSize(Font* font)
+{
+    return Impl(font)->original_font_size;
+}
+
+u32 GetGlyphVersion(Font* font)
+{
+    FontImpl* impl = Impl(font);
+    return impl->glyph_cache ? GetGlyphCacheVersion(impl->glyph_cache) : 0;
+}
+
+// Cell of the glyph cache a quad samples, -1 for glyphs of the atlas
+int GetGlyphCell(Font* font, const vec2& uv_min)
+{
+    FontImpl* impl = Impl(font);
+    return impl->glyph_cache ? GetGlyphCacheCell(impl->glyph_cache, uv_min) : -1;
+}
+
+void TouchGlyphCell(Font* font, int cell)
+{
+    FontImpl* impl = Impl(font);
+    if (impl->glyph_cache)
+        TouchGlyphCacheCell(impl->glyph_cache, cell);
+}
+
 void InitFont(RendererTraits* traits, SDL_GPUDevice* device)
 {
     g_device = device;
@@ -0,0 +1,630 @@
+//
+//  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
+//
+//  Dynamic fonts carry the outlines of every glyph that was left out of their atlas.  The font
+//  texture gets a square region below the imported glyphs that is split into equal cells, a glyph
+//  that is asked for and not resident takes a cell and is rasterized into a signed distance field
+//  on a worker thread.  Finished glyphs are uploaded once per frame as their own rectangle and
+//  cells of glyphs that were not drawn in the current frame are reused least recently used first.
+//
+
+constexpr int GLYPH_CACHE_MAX_RENDERS = 16;
+constexpr int GLYPH_CACHE_MIN_CELLS = 4;
+constexpr u16 GLYPH_CACHE_NO_CELL = 0xFFFF;
+constexpr int GLYPH_CACHE_MAX_CURVE_SEGMENTS = 16;
+constexpr float GLYPH_CACHE_FLATNESS = 1.0f / 16.0f;
+
+// Bytes of an outline record in the font asset, excluding its contours
+constexpr size_t GLYPH_OUTLINE_RECORD_SIZE = 13 * sizeof(u32);
+
+enum GlyphCellState
+{
+    glyph_cell_free,
+    glyph_cell_rendering,
+    glyph_cell_ready
+};
+
+enum GlyphRenderState
+{
+    glyph_render_free,
+    glyph_render_queued,
+    glyph_render_rendering,
+    glyph_render_done
+};
+
+struct GlyphOutline
+{
+    FontGlyph glyph;
+    vec2 scale;
+    vec2 translate;
+    ivec2 tile_size;
+    u32 first_contour;
+    u32 contour_count;
+    u16 cell;
+};
+
+struct GlyphCell
+{
+    GlyphCellState state;
+    u32 outline;
+    u64 last_used_frame;
+};
+
+struct GlyphCache
+{
+    FontType type;
+    float font_size;
+    Texture* texture;
+    ivec2 texture_size;
+    ivec2 origin;
+    float range;
+    int padding;
+    int cell_size;
+    int cells_per_row;
+    int cell_count;
+    u32 outline_count;
+    u32 version;
+    u32* codepoints;
+    GlyphOutline* outlines;
+    u32* contour_ends;
+    vec2* points;
+    GlyphCell* cells;
+};
+
+struct GlyphRender
+{
+    GlyphRenderState state;
+    GlyphCache* cache;
+    u32 outline;
+    u16 cell;
+    vec2 scale;
+    ivec2 size;
+    u8* data;
+};
+
+struct GlyphCacheSystem
+{
+    int region_size;
+    GlyphCache** caches;
+    int cache_count;
+    int max_caches;
+    GlyphRender renders[GLYPH_CACHE_MAX_RENDERS];
+
+    // Flattened outline of the glyph being rasterized, only touched by the worker
+    vec2* segments;
+    u32 segment_capacity;
+
+    u64 frame;
+    SDL_Thread* thread;
+    SDL_Mutex* mutex;
+    SDL_Condition* condition;
+    bool quit;
+};
+
+static GlyphCacheSystem* g_glyph_cache = nullptr;
+
+static int GetBytesPerTexel(const GlyphCache* cache)
+{
+    return cache->type == FONT_TYPE_SDF ? 1 : 4;
+}
+
+static vec2 EvaluateQuadratic(const vec2& p0, const vec2& p1, const vec2& p2, float t)
+{
+    float s = 1.0f - t;
+    return p0 * (s * s) + p1 * (2.0f * s * t) + p2 * (t * t);
+}
+
+// Contours are quadratic segments stored as a start and a control point each, the last segment
+// ends at the start of the contour.  Segments are split into lines until the distance between a
+// line and its curve, |p0 - 2p1 + p2| / 4n^2, is below the flatness.
+static u32 FlattenOutline(const GlyphCache* cache, const GlyphOutline& outline)
+{
+    u32 first_point = outline.first_contour > 0 ? cache->contour_ends[outline.first_contour - 1] : 0;
+    u32 last_point = cache->contour_ends[outline.first_contour + outline.contour_count - 1];
+    u32 capacity = (last_point - first_point) / 2 * GLYPH_CACHE_MAX_CURVE_SEGMENTS;
+    if (capacity > g_glyph_cache->segment_capacity)
+    {
+        vec2* segments = (vec2*)realloc(g_glyph_cache->segments, capacity * 2 * sizeof(vec2));
+        if (!segments)
+            return 0;
+
+        g_glyph_cache->segments = segments;
+        g_glyph_cache->segment_capacity = capacity;
+    }
+
+    vec2* segments = g_glyph_cache->segments;
+    u32 segment_count = 0;
+    u32 start = first_point;
+    for (u32 c = outline.first_contour; c < outline.first_contour + outline.contour_count; c++)
+    {
+        u32 end = cache->contour_ends[c];
+        for (u32 p = start; p < end; p += 2)
+        {
+            const vec2& p0 = cache->points[p];
+            const vec2& p1 = cache->points[p + 1];
+            const vec2& p2 = cache->points[p + 2 < end ? p + 2 : start];
+            float bend = length(p0 - p1 * 2.0f + p2);
+            int n = clamp((int)ceilf(sqrtf(bend / (4.0f * GLYPH_CACHE_FLATNESS))), 1, GLYPH_CACHE_MAX_CURVE_SEGMENTS);
+
+            vec2 previous = p0;
+            for (int i = 1; i <= n; i++)
+            {
+                vec2 next = i == n ? p2 : EvaluateQuadratic(p0, p1, p2, (float)i / n);
+                segments[segment_count * 2 + 0] = previous;
+                segments[segment_count * 2 + 1] = next;
+                segment_count++;
+                previous = next;
+            }
+        }
+
+        start = end;
+    }
+
+    return segment_count;
+}
+
+// Same mapping as the importer so dynamic glyphs match the atlas, distances are in glyph pixels,
+// positive inside by the non-zero rule and rows are flipped so that the top of the glyph is first
+static void RenderGlyph(GlyphRender& render)
+{
+    const GlyphCache* cache = render.cache;
+    const GlyphOutline& outline = cache->outlines[render.outline];
+    u32 segment_count = FlattenOutline(cache, outline);
+    const vec2* segments = g_glyph_cache->segments;
+
+    int bytes_per_texel = GetBytesPerTexel(cache);
+    int padding = cache->padding;
+    int w = render.size.x - padding * 2;
+    int h = render.size.y - padding * 2;
+    float scale = 1.0f / (cache->range * 2.0f);
+    for (int y = 0; y < h; y++)
+    {
+        u8* row = render.data + ((size_t)(h - y - 1 + padding) * render.size.x + padding) * bytes_per_texel;
+        for (int x = 0; x < w; x++)
+        {
+            vec2 p = vec2(x + 0.5f, y + 0.5f) / render.scale - outline.translate;
+            float distance_sqr = FLT_MAX;
+            int winding = 0;
+            for (u32 i = 0; i < segment_count; i++)
+            {
+                const vec2& a = segments[i * 2 + 0];
+                const vec2& b = segments[i * 2 + 1];
+                vec2 ab = b - a;
+                float ab_sqr = dot(ab, ab);
+                float t = ab_sqr > 0.0f ? clamp(dot(p - a, ab) / ab_sqr, 0.0f, 1.0f) : 0.0f;
+                vec2 d = p - (a + ab * t);
+                distance_sqr = min(distance_sqr, dot(d, d));
+
+                if ((a.y <= p.y) != (b.y <= p.y) && a.x + (p.y - a.y) * ab.x / ab.y > p.x)
+                    winding += ab.y > 0.0f ? 1 : -1;
+            }
+
+            float distance = sqrtf(distance_sqr) * (winding != 0 ? 1.0f : -1.0f);
+            u8 value = (u8)((clamp(distance * scale, -0.5f, 0.5f) + 0.5f) * 255.0f);
+
+            // Multi-channel fonts get the same distance in every channel, the median is unchanged
+            u8* texel = row + x * bytes_per_texel;
+            texel[0] = value;
+            if (bytes_per_texel == 4)
+            {
+                texel[1] = value;
+                texel[2] = value;
+                texel[3] = cache->type == FONT_TYPE_MTSDF ? value : 255;
+            }
+        }
+    }
+}
+
+static int GlyphCacheThread(void* user_data)
+{
+    (void)user_data;
+
+    SDL_LockMutex(g_glyph_cache->mutex);
+    while (!g_glyph_cache->quit)
+    {
+        GlyphRender* render = nullptr;
+        for (int i = 0; !render && i < GLYPH_CACHE_MAX_RENDERS; i++)
+            if (g_glyph_cache->renders[i].state == glyph_render_queued)
+                render = &g_glyph_cache->renders[i];
+
+        if (!render)
+        {
+            SDL_WaitCondition(g_glyph_cache->condition, g_glyph_cache->mutex);
+            continue;
+        }
+
+        // Outlines never change and the cell of a queued glyph is never reused
+        render->state = glyph_render_rendering;
+        SDL_UnlockMutex(g_glyph_cache->mutex);
+        RenderGlyph(*render);
+        SDL_LockMutex(g_glyph_cache->mutex);
+        render->state = glyph_render_done;
+    }
+    SDL_UnlockMutex(g_glyph_cache->mutex);
+
+    return 0;
+}
+
+static int GetFreeRender()
+{
+    for (int i = 0; i < GLYPH_CACHE_MAX_RENDERS; i++)
+        if (g_glyph_cache->renders[i].state == glyph_render_free)
+            return i;
+
+    return -1;
+}
+
+// A free cell, or the least recently used glyph that was not drawn this frame
+static int AllocCell(GlyphCache* cache)
+{
+    int evict_index = -1;
+    for (int i = 0; i < cache->cell_count; i++)
+    {
+        GlyphCell& cell = cache->cells[i];
+        if (cell.state == glyph_cell_free)
+            return i;
+
+        if (cell.state != glyph_cell_ready || cell.last_used_frame >= g_glyph_cache->frame)
+            continue;
+
+        if (evict_index == -1 || cell.last_used_frame < cache->cells[evict_index].last_used_frame)
+            evict_index = i;
+    }
+
+    if (evict_index == -1)
+        return -1;
+
+    GlyphCell& cell = cache->cells[evict_index];
+    GlyphOutline& outline = cache->outlines[cell.outline];
+    outline.cell = GLYPH_CACHE_NO_CELL;
+    outline.glyph.uv_min = vec2(0.0f);
+    outline.glyph.uv_max = vec2(0.0f);
+    cell.state = glyph_cell_free;
+    cache->version++;
+    return evict_index;
+}
+
+// Same quad as the importer gives atlas glyphs, it covers the whole rectangle of the cell that is
+// uploaded so glyphs rendered at a smaller scale still show at their full size
+static void SetGlyphQuad(const GlyphCache* cache, GlyphOutline& outline, const vec2& scale, const ivec2& tile_size)
+{
+    float padding = (float)cache->padding;
+    float left = -padding / scale.x - outline.translate.x;
+    float right = (tile_size.x + padding) / scale.x - outline.translate.x;
+    float top = outline.translate.y - (tile_size.y + padding) / scale.y;
+    float bottom = outline.translate.y + padding / scale.y;
+    outline.glyph.bearing = vec2(left, top) / cache->font_size;
+    outline.glyph.size = vec2(right - left, bottom - top) / cache->font_size;
+}
+
+static void RequestGlyph(GlyphCache* cache, u32 outline_index)
+{
+    int render_index = GetFreeRender();
+    if (render_index == -1)
+        return;
+
+    int cell_index = AllocCell(cache);
+    if (cell_index == -1)
+        return;
+
+    // Glyphs larger than a cell are rendered at a smaller scale, quads keep their size
+    GlyphOutline& outline = cache->outlines[outline_index];
+    int available = cache->cell_size - cache->padding * 2;
+    float fit = min(1.0f, (float)available / (float)max(outline.tile_size.x, outline.tile_size.y));
+    ivec2 tile_size = ivec2(
+        clamp((int)(outline.tile_size.x * fit), 1, available),
+        clamp((int)(outline.tile_size.y * fit), 1, available));
+    ivec2 size = tile_size + ivec2(cache->padding * 2);
+
+    u8* data = (u8*)calloc((size_t)size.x * size.y, GetBytesPerTexel(cache));
+    if (!data)
+        return;
+
+    GlyphCell& cell = cache->cells[cell_index];
+    cell.state = glyph_cell_rendering;
+    cell.outline = outline_index;
+    cell.last_used_frame = g_glyph_cache->frame;
+    outline.cell = (u16)cell_index;
+
+    SDL_LockMutex(g_glyph_cache->mutex);
+    GlyphRender& render = g_glyph_cache->renders[render_index];
+    render.state = glyph_render_queued;
+    render.cache = cache;
+    render.outline = outline_index;
+    render.cell = (u16)cell_index;
+    render.scale = outline.scale * vec2(tile_size) / vec2(outline.tile_size);
+    render.size = size;
+    SetGlyphQuad(cache, outline, render.scale, tile_size);
+    render.data = data;
+    SDL_SignalCondition(g_glyph_cache->condition);
+    SDL_UnlockMutex(g_glyph_cache->mutex);
+}
+
+static bool UploadGlyph(GlyphRender& render)
+{
+    GlyphCache* cache = render.cache;
+    ivec2 position = cache->origin + ivec2(render.cell % cache->cells_per_row, render.cell / cache->cells_per_row) * cache->cell_size;
+    u32 size = (u32)(render.size.x * render.size.y * GetBytesPerTexel(cache));
+    void* staging = UploadToTextureRegionGPU(
+        GetGPUTexture(cache->texture),
+        0,
+        (u32)position.x,
+        (u32)position.y,
+        (u32)render.size.x,
+        (u32)render.size.y,
+        size);
+    if (!staging)
+        return false;
+
+    memcpy(staging, render.data, size);
+
+    GlyphOutline& outline = cache->outlines[render.outline];
+    outline.glyph.uv_min = vec2(position) / vec2(cache->texture_size);
+    outline.glyph.uv_max = vec2(position + render.size) / vec2(cache->texture_size);
+    cache->cells[render.cell].state = glyph_cell_ready;
+    cache->version++;
+    return true;
+}
+
+void UpdateGlyphCache()
+{
+    if (!g_glyph_cache)
+        return;
+
+    SDL_LockMutex(g_glyph_cache->mutex);
+    for (int i = 0; i < GLYPH_CACHE_MAX_RENDERS; i++)
+    {
+        GlyphRender& render = g_glyph_cache->renders[i];
+        if (render.state != glyph_render_done || !UploadGlyph(render))
+            continue;
+
+        free(render.data);
+        render = {};
+    }
+    SDL_UnlockMutex(g_glyph_cache->mutex);
+
+    g_glyph_cache->frame++;
+}
+
+const FontGlyph* GetCachedGlyph(GlyphCache* cache, u32 codepoint)
+{
+    u32 lo = 0;
+    u32 hi = cache->outline_count;
+    while (lo < hi)
+    {
+        u32 mid = (lo + hi) / 2;
+        if (cache->codepoints[mid] < codepoint)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo == cache->outline_count || cache->codepoints[lo] != codepoint)
+        return nullptr;
+
+    // Glyphs without contours only need their metrics
+    GlyphOutline& outline = cache->outlines[lo];
+    if (outline.contour_count == 0 || !cache->texture)
+        return &outline.glyph;
+
+    if (outline.cell == GLYPH_CACHE_NO_CELL)
+        RequestGlyph(cache, lo);
+    else
+        cache->cells[outline.cell].last_used_frame = g_glyph_cache->frame;
+
+    return &outline.glyph;
+}
+
+// Quads of cached glyphs start at the corner of their cell, anything else is a glyph of the atlas
+int GetGlyphCacheCell(GlyphCache* cache, const vec2& uv_min)
+{
+    if (!cache->texture)
+        return -1;
+
+    ivec2 position = ivec2(uv_min * vec2(cache->texture_size) + vec2(0.5f)) - cache->origin;
+    if (position.x < 0 || position.y < 0 || position.x % cache->cell_size != 0 || position.y % cache->cell_size != 0)
+        return -1;
+
+    int column = position.x / cache->cell_size;
+    int cell = position.y / cache->cell_size * cache->cells_per_row + column;
+    if (column >= cache->cells_per_row || cell >= cache->cell_count || cache->cells[cell].state != glyph_cell_ready)
+        return -1;
+
+    return cache->outlines[cache->cells[cell].outline].glyph.uv_min == uv_min ? cell : -1;
+}
+
+// Keeps a glyph that is drawn without being looked up, such as one baked into a mesh, from being
+// evicted this frame
+void TouchGlyphCacheCell(GlyphCache* cache, int cell)
+{
+    assert(cell >= 0 && cell < cache->cell_count);
+    cache->cells[cell].last_used_frame = g_glyph_cache->frame;
+}
+
+GlyphCache* LoadGlyphCache(Stream* stream, FontType type, float font_size)
+{
+    u32 outline_count = ReadU32(stream);
+    if (outline_count == 0)
+        return nullptr;
+
+    float range = ReadFloat(stream);
+    int padding = (int)ReadU32(stream);
+    u32 contour_total = ReadU32(stream);
+    u32 point_total = ReadU32(stream);
+    size_t end =
+        GetPosition(stream) +
+        outline_count * GLYPH_OUTLINE_RECORD_SIZE +
+        contour_total * sizeof(u32) +
+        point_total * sizeof(vec2);
+
+    // Without a cache the font only draws the glyphs of its atlas
+    if (!g_glyph_cache || g_glyph_cache->cache_count == g_glyph_cache->max_caches || end > GetSize(stream))
+    {
+        SetPosition(stream, end);
+        return nullptr;
+    }
+
+    size_t cache_size =
+        sizeof(GlyphCache) +
+        outline_count * sizeof(GlyphOutline) +
+        outline_count * sizeof(u32) +
+        contour_total * sizeof(u32) +
+        point_total * sizeof(vec2);
+
+    GlyphCache* cache = (GlyphCache*)calloc(1, cache_size);
+    if (!cache)
+    {
+        SetPosition(stream, end);
+        return nullptr;
+    }
+
+    cache->type = type;
+    cache->font_size = max(font_size, 1.0f);
+    cache->range = range;
+    cache->padding = padding;
+    cache->outline_count = outline_count;
+    cache->outlines = (GlyphOutline*)(cache + 1);
+    cache->codepoints = (u32*)(cache->outlines + outline_count);
+    cache->contour_ends = cache->codepoints + outline_count;
+    cache->points = (vec2*)(cache->contour_ends + contour_total);
+
+    bool valid = range > 0.0f && padding >= 0;
+    int largest = 1;
+    u32 contour = 0;
+    u32 point = 0;
+    for (u32 i = 0; valid && i < outline_count; i++)
+    {
+        cache->codepoints[i] = ReadU32(stream);
+        valid = i == 0 || cache->codepoints[i] > cache->codepoints[i - 1];
+
+        GlyphOutline& outline = cache->outlines[i];
+        outline.glyph.size.x = ReadFloat(stream);
+        outline.glyph.size.y = ReadFloat(stream);
+        outline.glyph.advance = ReadFloat(stream);
+        outline.glyph.bearing.x = ReadFloat(stream);
+        outline.glyph.bearing.y = ReadFloat(stream);
+        outline.scale.x = ReadFloat(stream);
+        outline.scale.y = ReadFloat(stream);
+        outline.translate.x = ReadFloat(stream);
+        outline.translate.y = ReadFloat(stream);
+        outline.tile_size.x = (int)ReadU32(stream);
+        outline.tile_size.y = (int)ReadU32(stream);
+        outline.first_contour = contour;
+        outline.contour_count = ReadU32(stream);
+        outline.cell = GLYPH_CACHE_NO_CELL;
+        valid = valid && contour + outline.contour_count <= contour_total;
+        if (outline.contour_count > 0)
+        {
+            valid = valid && outline.tile_size.x > 0 && outline.tile_size.y > 0 && outline.scale.x > 0.0f && outline.scale.y > 0.0f;
+            largest = max(largest, max(outline.tile_size.x, outline.tile_size.y) + padding * 2);
+        }
+
+        for (u32 c = 0; valid && c < outline.contour_count; c++)
+        {
+            u32 count = ReadU32(stream);
+            valid = count >= 2 && count % 2 == 0 && point + count <= point_total;
+            for (u32 p = 0; valid && p < count; p++, point++)
+            {
+                cache->points[point].x = ReadFloat(stream);
+                cache->points[point].y = ReadFloat(stream);
+            }
+
+            cache->contour_ends[contour++] = point;
+        }
+    }
+
+    SetPosition(stream, end);
+
+    // Cells fit the largest glyph unless that would leave too few of them
+    cache->cell_size = min(largest, g_glyph_cache->region_size / GLYPH_CACHE_MIN_CELLS);
+    cache->cells_per_row = cache->cell_size > 0 ? g_glyph_cache->region_size / cache->cell_size : 0;
+    cache->cell_count = min(cache->cells_per_row * cache->cells_per_row, (int)GLYPH_CACHE_NO_CELL);
+    cache->cells = valid && cache->cell_count > 0 ? (GlyphCell*)calloc(cache->cell_count, sizeof(GlyphCell)) : nullptr;
+    if (!cache->cells)
+    {
+        free(cache);
+        return nullptr;
+    }
+
+    g_glyph_cache->caches[g_glyph_cache->cache_count++] = cache;
+    return cache;
+}
+
+int GetGlyphCacheSize(GlyphCache* cache)
+{
+    (void)cache;
+    return g_glyph_cache->region_size;
+}
+
+// Changes whenever a cached glyph is uploaded or evicted, anything holding on to texture
+// coordinates of cached glyphs has to look them up again
+u32 GetGlyphCacheVersion(GlyphCache* cache)
+{
+    return cache->version;
+}
+
+void SetGlyphCacheTexture(GlyphCache* cache, Texture* texture, const ivec2& origin, const ivec2& texture_size)
+{
+    cache->texture = texture;
+    cache->origin = origin;
+    cache->texture_size = texture_size;
+}
+
+void InitGlyphCache(RendererTraits* traits)
+{
+    assert(!g_glyph_cache);
+
+    // A zero size keeps fonts to the glyphs of their atlas
+    if (traits->glyph_cache_size == 0)
+        return;
+
+    g_glyph_cache = (GlyphCacheSystem*)calloc(1, sizeof(GlyphCacheSystem));
+    if (!g_glyph_cache)
+    {
+        ExitOutOfMemory("glyph_cache");
+        return;
+    }
+
+    g_glyph_cache->region_size = (int)traits->glyph_cache_size;
+    g_glyph_cache->max_caches = (int)traits->max_fonts;
+    g_glyph_cache->caches = (GlyphCache**)calloc(traits->max_fonts, sizeof(GlyphCache*));
+    g_glyph_cache->mutex = SDL_CreateMutex();
+    g_glyph_cache->condition = SDL_CreateCondition();
+    if (!g_glyph_cache->caches || !g_glyph_cache->mutex || !g_glyph_cache->condition)
+    {
+        ExitOutOfMemory("glyph_cache");
+        return;
+    }
+
+    g_glyph_cache->thread = SDL_CreateThread(GlyphCacheThread, "glyph_cache", nullptr);
+    if (!g_glyph_cache->thread)
+        Exit(SDL_GetError());
+}
+
+void ShutdownGlyphCache()
+{
+    if (!g_glyph_cache)
+        return;
+
+    SDL_LockMutex(g_glyph_cache->mutex);
+    g_glyph_cache->quit = true;
+    SDL_SignalCondition(g_glyph_cache->condition);
+    SDL_UnlockMutex(g_glyph_cache->mutex);
+    SDL_WaitThread(g_glyph_cache->thread, nullptr);
+
+    for (int i = 0; i < GLYPH_CACHE_MAX_RENDERS; i++)
+        free(g_glyph_cache->renders[i].data);
+
+    for (int i = 0; i < g_glyph_cache->cache_count; i++)
+    {
+        free(g_glyph_cache->caches[i]->cells);
+        free(g_glyph_cache->caches[i]);
+    }
+
+    SDL_DestroyCondition(g_glyph_cache->condition);
+    SDL_DestroyMutex(g_glyph_cache->mutex);
+    free(g_glyph_cache->segments);
+    free(g_glyph_cache->caches);
+    free(g_glyph_cache);
+    g_glyph_cache = nullptr;
+}
@@ -8,14 +8,54 @@
 #include <noz/color.h>
 
 // @mesh
+enum VertexFormat
+{
+    VERTEX_FORMAT_FLOAT,        // 36 bytes, mesh_vertex
+    VERTEX_FORMAT_HALF,         // 16 bytes, mesh_vertex_compact with half float positions
+    VERTEX_FORMAT_UNORM16,      // 16 bytes, mesh_vertex_compact with positions normalized to the mesh bounds
+    VERTEX_FORMAT_COUNT
+};
+
+// Asset header flags of a mesh.  Meshes without a CPU copy only keep their bounds and clusters
+// resident once they are uploaded.
+constexpr u32 MESH_ASSET_FLAG_DISCARD_CPU_COPY = 1 << 0;
+
+// The bone index follows the position so every format can read both as one float4 attribute
 typedef struct mesh_vertex
 {
     vec3 position;
+    float bone;
     vec2 uv0;
     vec3 normal;
-    float bone;
 } mesh_vertex;
 
+// position.w holds the bone index, the normal is octahedral encoded
+typedef struct mesh_vertex_compact
+{
+    u16 position[4];
+    u16 uv0[2];
+    i16 normal[2];
+} mesh_vertex_compact;
+
+// Spatially coherent range of triangles with its own bounds so large meshes can be culled in
+// pieces.  Clusters of a mesh are stored in index order.
+struct MeshCluster
+{
+    bounds3 bounds;
+    u32 index_offset;
+    u32 index_count;
+};
+
+// Level of detail, a range of the mesh index buffer drawn with the shared vertices once the mesh
+// covers less than screen_size of the screen height.  Level 0 is the full detail mesh and the
+// only one split into clusters.
+struct MeshLod
+{
+    u32 index_offset;
+    u32 index_count;
+    float screen_size;
+};
+
 
 typedef struct bone_transform
 {
@@ -121,16 +161,48 @@ SDL_GPURenderPass* BeginGammaPassGPU();
 void EndRenderPassGPU();
 void BindTextureGPU(Texture* texture, SDL_GPUCommandBuffer* cb, int index);
 void BindShaderGPU(Shader* shader);
+void BindVertexFormatGPU(VertexFormat vertex_format);
 void BindMaterialGPU(Material* material, SDL_GPUCommandBuffer* cb);
 void BindDefaultTextureGPU(int texture_index);
 
 // @render_buffer
-void InitRenderBuffer(RendererTraits* traits);
+void InitRenderBuffer(RendererTraits* traits, SDL_GPUDevice* device);
 void ShutdownRenderBuffer();
 void BeginGammaPass();
 void ClearRenderCommands();
+void CullRenderCommands();
+void UploadRenderBufferGPU(SDL_GPUCommandBuffer* cb);
 void ExecuteRenderCommands(SDL_GPUCommandBuffer* cb);
 
+// @culling
+#define FRUSTUM_PLANE_COUNT 6
+
+struct Frustum
+{
+    vec4 planes[FRUSTUM_PLANE_COUNT];
+};
+
+Frustum ToFrustum(const mat4& view_projection);
+size_t CullBounds(const Frustum& frustum, const bounds3* bounds, size_t count, bool* visible);
+
+// @occlusion
+void InitOcclusion(RendererTraits* traits);
+void ShutdownOcclusion();
+bool IsOcclusionEnabled();
+void ClearOcclusion(const mat4& view_projection);
+void RasterizeOccluder(const mesh_vertex* vertices, size_t vertex_count, const void* indices, u32 index_size, size_t index_count, const mat4& transform);
+void BuildOcclusionHiZ();
+size_t CullOcclusion(const bounds3* bounds, size_t count, bool* visible);
+
+// @upload
+void InitUpload(RendererTraits* traits, SDL_GPUDevice* device);
+void ShutdownUpload();
+void* UploadToBufferGPU(SDL_GPUBuffer* buffer, u32 buffer_offset, u32 size);
+void* UploadToTextureGPU(SDL_GPUTexture* texture, u32 mip_level, u32 width, u32 height, u32 size);
+void* UploadToTextureRegionGPU(SDL_GPUTexture* texture, u32 mip_level, u32 x, u32 y, u32 width, u32 height, u32 size);
+void FlushUploads();
+void EndUploadFrame();
+
 // @sampler_factory
 void InitSamplerFactory(RendererTraits* traits, SDL_GPUDevice* device);
 void ShutdownSamplerFactory();
@@ -139,18 +211,99 @@ SDL_GPUSampler* GetGPUSampler(Texture* texture);
 // @pipeline_factory
 void InitPipelineFactory(RendererTraits* traits, SDL_Window* window, SDL_GPUDevice* device);
 void ShutdownPipelineFactory();
-SDL_GPUGraphicsPipeline* GetGPUPipeline(Shader* shader, bool msaa, bool shadow);
+SDL_GPUGraphicsPipeline* GetGPUPipeline(Shader* shader, VertexFormat vertex_format, bool msaa, bool shadow);
+void PrewarmSavedPipelines(Shader** shaders, size_t shader_count);
+
+// @mesh_heap
+struct MeshHeapAllocation
+{
+    u32 vertex_stride;
+    u32 vertex_offset;
+    u32 vertex_count;
+    u32 index_stride;
+    u32 index_offset;
+    u32 index_count;
+};
+
+void InitMeshHeap(RendererTraits* traits, SDL_GPUDevice* device);
+void ShutdownMeshHeap();
+int AllocMeshHeap(u32 vertex_stride, size_t vertex_count, u32 index_stride, size_t index_count);
+void FreeMeshHeap(int handle);
+void DefragMeshHeap();
+const MeshHeapAllocation& GetMeshHeapAllocation(int handle);
+SDL_GPUBuffer* GetMeshHeapVertexBuffer();
+SDL_GPUBuffer* GetMeshHeapIndexBuffer();
+void BindMeshHeapGPU(SDL_GPURenderPass* pass);
+void BindMeshHeapIndicesGPU(SDL_GPURenderPass* pass, u32 index_stride);
 
 // @mesh
 void InitMesh(RendererTraits* traits, SDL_GPUDevice* device);
 void ShutdownMesh();
-void DrawMeshGPU(Mesh* mesh, SDL_GPURenderPass* pass);
+void ReleaseDestroyedMeshes();
+void DrawMeshGPU(Mesh* mesh, SDL_GPURenderPass* pass, u32 draw_index, u32 first_index, u32 index_count);
+const mesh_vertex* GetVertices(Mesh* mesh);     // nullptr when the CPU copy was discarded
+const void* GetIndices(Mesh* mesh);             // nullptr when the CPU copy was discarded
+u32 GetIndexSize(Mesh* mesh);
+size_t GetClusterCount(Mesh* mesh);
+const MeshCluster* GetClusters(Mesh* mesh);
+size_t GetLodCount(Mesh* mesh);
+const MeshLod* GetLods(Mesh* mesh);
+size_t SelectLod(Mesh* mesh, float screen_size);
+VertexFormat GetVertexFormat(Mesh* mesh);
+u32 GetLoadedVertexFormats();
+void GetPositionDecode(Mesh* mesh, vec4* scale, vec4* offset);
+
+// @vertex_format
+u32 GetVertexStride(VertexFormat format);
+void EncodeVertices(VertexFormat format, const bounds3& bounds, const mesh_vertex* vertices, size_t count, void* output);
+void DecodeVertices(VertexFormat format, const bounds3& bounds, const void* data, size_t count, mesh_vertex* output);
+void GetPositionDecode(VertexFormat format, const bounds3& bounds, vec4* scale, vec4* offset);
+
+// @pixel_convert
+float SRGBToLinear(u8 value);
+u8 LinearToSRGB(float value);
+void ConvertSRGBToLinear(u8* pixels, size_t pixel_count, int channels);
+void ConvertLinearToSRGB(u8* pixels, size_t pixel_count, int channels);
+void ConvertRGBToRGBA(const u8* src, u8* dst, size_t pixel_count);
+void ConvertRGBAToRGB(const u8* src, u8* dst, size_t pixel_count);
+void ConvertGrayToRGBA(const u8* src, u8* dst, size_t pixel_count);
+void ConvertAlphaToRGBA(const u8* src, u8* dst, size_t pixel_count);
+void PremultiplyAlpha(u8* pixels, size_t pixel_count);
+void ConvertFloatToHalf(const float* src, u16* dst, size_t count);
 
 // @texture
+constexpr u32 MAX_TEXTURE_LEVELS = 16;
+
+// A mip level stored in a texture asset, offset is where its data starts in the file
+struct TextureLevel
+{
+    u32 width;
+    u32 height;
+    u32 size;
+    u32 offset;
+};
+
 void InitTexture(RendererTraits* traits, SDL_GPUDevice* device);
 void ShutdownTexture();
 SDL_GPUTexture* GetGPUTexture(Texture* texture);
 SamplerOptions GetSamplerOptions(Texture* texture);
+bool SetTextureLevels(Texture* texture, TextureFormat format, const TextureLevel* levels, u32 first_level, u32 level_count, const u8* data, const char* name);
+void RequestTextureDetail(Texture* texture, float screen_pixels);
+
+// @texture_streamer
+void InitTextureStreamer(RendererTraits* traits);
+void ShutdownTextureStreamer();
+void UpdateTextureStreaming();
+bool IsTextureStreamingEnabled();
+u32 GetStreamingTailLevel(const TextureLevel* levels, u32 level_count);
+int StreamTexture(Texture* texture, TextureFormat format, const char* name, const TextureLevel* levels, u32 level_count, u32 tail_level, u8* tail_data);
+void RequestStreamedTextureDetail(int index, float screen_pixels);
+
+// @material
+void RequestMaterialDetail(Material* material, float screen_pixels);
+
+// @asset
+std::filesystem::path GetAssetPath(const char* asset_name, asset_signature_t signature);
 
 // @shader
 struct ShaderUniformBuffer
@@ -162,6 +315,7 @@ struct ShaderUniformBuffer
 void InitShader(RendererTraits* traits, SDL_GPUDevice* device);
 void ShutdownShader();
 const char* GetGPUName(Shader* shader);
+u64 GetContentHash(Shader* shader);
 
 SDL_GPUShader* GetGPUVertexShader(Shader* shader);
 SDL_GPUShader* GetGPUFragmentShader(Shader* shader);
@@ -183,6 +337,27 @@ ShaderUniformBuffer GetFragmentUniformBuffer(Shader* shader, int index);
 void InitFont(RendererTraits* traits, SDL_GPUDevice* device);
 void ShutdownFont();
 Material* GetMaterial(Font* font);
+u32 GetFontSize(Font* font);
+u32 GetGlyphVersion(Font* font);
+int GetGlyphCell(Font* font, const vec2& uv_min);
+void TouchGlyphCell(Font* font, int cell);
+
+// @glyph_cache
+struct GlyphCache;
+void InitGlyphCache(RendererTraits* traits);
+void ShutdownGlyphCache();
+void UpdateGlyphCache();
+GlyphCache* LoadGlyphCache(Stream* stream, FontType type, float font_size);
+int GetGlyphCacheSize(GlyphCache* cache);
+u32 GetGlyphCacheVersion(GlyphCache* cache);
+void SetGlyphCacheTexture(GlyphCache* cache, Texture* texture, const ivec2& origin, const ivec2& texture_size);
+const FontGlyph* GetCachedGlyph(GlyphCache* cache, u32 codepoint);
+int GetGlyphCacheCell(GlyphCache* cache, const vec2& uv_min);
+void TouchGlyphCacheCell(GlyphCache* cache, int cell);
+
+// @text
+void InitText(RendererTraits* traits);
+void ShutdownText();
 
 
 // @animation
@@ -37,6 +37,7 @@ Material* CreateMaterial(Allocator* allocator, Shader* shader)
     impl->texture_count = texture_count;
     impl->textures = (Texture**)(impl + 1);
     impl->uniforms_data = (u8*)(impl->textures + texture_count);
+    memset(impl->textures, 0, textures_size);
     return (Material*)impl;
 }
 
@@ -52,6 +53,15 @@ void SetTexture(Material* material, Texture* texture, size_t index)
     impl->textures[index] = texture;
 }
 
+// Passes the size of a draw on to every texture so streamed ones can load the levels it needs
+void RequestMaterialDetail(Material* material, float screen_pixels)
+{
+    auto impl = Impl(material);
+    for (size_t i = 0, c = impl->texture_count; i < c; ++i)
+        if (impl->textures[i])
+            RequestTextureDetail(impl->textures[i], screen_pixels);
+}
+
 void BindMaterialGPU(Material* material, SDL_GPUCommandBuffer* cb)
 {
     auto impl = Impl(material);
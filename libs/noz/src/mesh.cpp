@@ -7,44 +7,111 @@ struct MeshImpl
     OBJECT_BASE;
     size_t vertex_count;
     size_t index_count;
-    SDL_GPUBuffer* vertex_buffer;
-    SDL_GPUBuffer* index_buffer;
-    SDL_GPUTransferBuffer* vertex_transfer;
-    SDL_GPUTransferBuffer* index_transfer;
+    size_t cluster_count;
+    size_t lod_count;
+    VertexFormat vertex_format;
+    u32 index_size;
+    int heap_handle;
     mesh_vertex* vertices;
-    uint16_t* indices;
+    void* indices;
+    MeshCluster* clusters;
+    MeshLod* lods;
     bounds3 bounds;
+    MeshImpl* next_destroyed;
 };
 
 static SDL_GPUDevice* g_device = nullptr;
+static MeshImpl* g_destroyed_meshes = nullptr;
+static u32 g_loaded_vertex_formats = 0;
 
 static void UploadMesh(MeshImpl* impl, const char* name);
-static void mesh_destroy_impl(MeshImpl* impl);
+static void BeginUploadMesh(MeshImpl* impl);
+static void* StageMeshVertices(MeshImpl* impl);
+static void* StageMeshIndices(MeshImpl* impl);
 static MeshImpl* Impl(void* s) { return (MeshImpl*)Cast((Object*)s, TYPE_MESH); }
 
-inline size_t GetMeshImplSize(size_t vertex_count, size_t index_count)
+inline size_t GetClusterOffset(size_t vertex_count, size_t index_count, u32 index_size)
+{
+    size_t offset = sizeof(MeshImpl) + sizeof(mesh_vertex) * vertex_count + index_size * index_count;
+    return (offset + alignof(MeshCluster) - 1) & ~(alignof(MeshCluster) - 1);
+}
+
+inline size_t GetLodOffset(size_t vertex_count, size_t index_count, u32 index_size, size_t cluster_count)
+{
+    static_assert(alignof(MeshLod) <= alignof(MeshCluster));
+    return GetClusterOffset(vertex_count, index_count, index_size) + sizeof(MeshCluster) * cluster_count;
+}
+
+inline size_t GetMeshImplSize(size_t vertex_count, size_t index_count, u32 index_size, size_t cluster_count, size_t lod_count)
 {
     return
-        sizeof(MeshImpl) +
-        sizeof(mesh_vertex) * vertex_count +
-        sizeof(uint16_t) * index_count;
+        GetLodOffset(vertex_count, index_count, index_size, cluster_count) +
+        sizeof(MeshLod) * lod_count;
 }
 
-static Mesh* CreateMesh(Allocator* allocator, size_t vertex_count, size_t index_count)
+// Indices only need 32 bits when a vertex can not be addressed with 16
+inline u32 ChooseIndexSize(size_t vertex_count)
 {
-    auto mesh = (Mesh*)CreateObject(allocator, GetMeshImplSize(vertex_count, index_count), TYPE_MESH);
+    return vertex_count > 65536 ? sizeof(u32) : sizeof(u16);
+}
+
+static Mesh* CreateMesh(
+    Allocator* allocator,
+    size_t vertex_count,
+    size_t index_count,
+    u32 index_size,
+    size_t cluster_count,
+    size_t lod_count,
+    bool cpu_copy)
+{
+    assert(index_size == sizeof(u16) || index_size == sizeof(u32));
+    assert(lod_count > 0);
+
+    // Without a CPU copy the vertices and indices only live in the mesh heap
+    size_t resident_vertex_count = cpu_copy ? vertex_count : 0;
+    size_t resident_index_count = cpu_copy ? index_count : 0;
+    auto mesh = (Mesh*)CreateObject(
+        allocator,
+        GetMeshImplSize(resident_vertex_count, resident_index_count, index_size, cluster_count, lod_count),
+        TYPE_MESH);
     if (!mesh)
         return nullptr;
 
     auto impl = Impl(mesh);
     impl->vertex_count = vertex_count;
     impl->index_count = index_count;
-    impl->vertices = (mesh_vertex*)((u8*)impl + sizeof(MeshImpl));
-    impl->indices = (uint16_t*)((u8*)impl->vertices + sizeof(mesh_vertex) * vertex_count);
+    impl->index_size = index_size;
+    impl->cluster_count = cluster_count;
+    impl->lod_count = lod_count;
+    impl->vertex_format = VERTEX_FORMAT_FLOAT;
+    impl->vertices = cpu_copy ? (mesh_vertex*)((u8*)impl + sizeof(MeshImpl)) : nullptr;
+    impl->indices = cpu_copy ? (u8*)impl->vertices + sizeof(mesh_vertex) * vertex_count : nullptr;
+    impl->clusters = (MeshCluster*)((u8*)impl + GetClusterOffset(resident_vertex_count, resident_index_count, index_size));
+    impl->lods = (MeshLod*)((u8*)impl + GetLodOffset(resident_vertex_count, resident_index_count, index_size, cluster_count));
+    impl->lods[0] = { 0, (u32)index_count, 0.0f };
+    impl->heap_handle = -1;
+    impl->next_destroyed = nullptr;
 
     return mesh;
 }
 
+static void SetVertices(MeshImpl* impl, vec3* positions, vec3* normals, vec2* uvs, u8* bone_indices)
+{
+    assert(positions);
+    assert(normals);
+    assert(uvs);
+
+    impl->bounds = to_bounds(positions, impl->vertex_count);
+
+    for (size_t i = 0; i < impl->vertex_count; i++)
+    {
+        impl->vertices[i].position = positions[i];
+        impl->vertices[i].normal = normals[i];
+        impl->vertices[i].uv0 = uvs[i];
+        impl->vertices[i].bone = bone_indices ? (float)bone_indices[i] : 0.0f;
+    }
+}
+
 Mesh* CreateMesh(
     Allocator* allocator,
     size_t vertex_count,
@@ -56,41 +123,80 @@ Mesh* CreateMesh(
     u16* indices,
     const char* name)
 {
-    assert(positions);
-    assert(normals);
-    assert(uvs);
     assert(indices);
 
-    auto mesh = CreateMesh(allocator, vertex_count, index_count);
+    auto mesh = CreateMesh(allocator, vertex_count, index_count, sizeof(u16), 0, 1, true);
+    if (!mesh)
+        return nullptr;
+
     auto impl = Impl(mesh);
-    impl->bounds = to_bounds(positions, vertex_count);
+    SetVertices(impl, positions, normals, uvs, bone_indices);
+    memcpy(impl->indices, indices, sizeof(u16) * index_count);
+    UploadMesh(impl, name);
+    return mesh;
+}
 
-    if (bone_indices)
-    {
-        for (size_t i = 0; i < vertex_count; i++)
-        {
-            impl->vertices[i].position = positions[i];
-            impl->vertices[i].normal = normals[i];
-            impl->vertices[i].uv0 = uvs[i];
-            impl->vertices[i].bone = (float)bone_indices[i];
-        }
-    }
+Mesh* CreateMesh(
+    Allocator* allocator,
+    size_t vertex_count,
+    vec3* positions,
+    vec3* normals,
+    vec2* uvs,
+    u8* bone_indices,
+    size_t index_count,
+    u32* indices,
+    const char* name)
+{
+    assert(indices);
+
+    u32 index_size = ChooseIndexSize(vertex_count);
+    auto mesh = CreateMesh(allocator, vertex_count, index_count, index_size, 0, 1, true);
+    if (!mesh)
+        return nullptr;
+
+    auto impl = Impl(mesh);
+    SetVertices(impl, positions, normals, uvs, bone_indices);
+
+    if (index_size == sizeof(u32))
+        memcpy(impl->indices, indices, sizeof(u32) * index_count);
     else
-    {
-        for (size_t i = 0; i < vertex_count; i++)
-        {
-            impl->vertices[i].position = positions[i];
-            impl->vertices[i].normal = normals[i];
-            impl->vertices[i].uv0 = uvs[i];
-            impl->vertices[i].bone = 0;
-        }
-    }
+        for (size_t i = 0; i < index_count; i++)
+            ((u16*)impl->indices)[i] = (u16)indices[i];
 
-    memcpy(impl->indices, indices, sizeof(uint16_t) * index_count);
     UploadMesh(impl, name);
     return mesh;
 }
 
+// Version 1 meshes stored the bone index after the normal
+static void ConvertLegacyVertices(MeshImpl* impl)
+{
+    struct LegacyVertex
+    {
+        vec3 position;
+        vec2 uv0;
+        vec3 normal;
+        float bone;
+    };
+
+    static_assert(sizeof(LegacyVertex) == sizeof(mesh_vertex));
+
+    for (size_t i = 0; i < impl->vertex_count; i++)
+    {
+        LegacyVertex legacy;
+        memcpy(&legacy, impl->vertices + i, sizeof(LegacyVertex));
+        impl->vertices[i] = { legacy.position, legacy.bone, legacy.uv0, legacy.normal };
+    }
+}
+
+// Reads data destined for the staging ring, skipping over it when it could not be staged
+static void ReadStagedBytes(Stream* stream, void* dest, size_t size)
+{
+    if (dest)
+        ReadBytes(stream, dest, size);
+    else
+        SetPosition(stream, GetPosition(stream) + size);
+}
+
 Object* LoadMesh(Allocator* allocator, Stream* stream, AssetHeader* header, const char* name)
 {
     // Read bounds
@@ -100,120 +206,163 @@ Object* LoadMesh(Allocator* allocator, Stream* stream, AssetHeader* header, cons
     // counts
     auto vertex_count = ReadU32(stream);
     auto index_count = ReadU32(stream);
+    auto vertex_format = header->version >= 2 ? (VertexFormat)ReadU8(stream) : VERTEX_FORMAT_FLOAT;
+    u32 index_size = header->version >= 3 ? ReadU8(stream) : sizeof(u16);
+    u32 cluster_count = header->version >= 3 ? ReadU32(stream) : 0;
+    u32 lod_count = header->version >= 4 ? ReadU32(stream) : 0;
+    if (vertex_format >= VERTEX_FORMAT_COUNT || (index_size != sizeof(u16) && index_size != sizeof(u32)))
+        return nullptr;
 
-    auto mesh = CreateMesh(allocator, vertex_count, index_count);
+    // Legacy vertices are converted on the CPU so version 1 meshes always keep their copy
+    bool cpu_copy = header->version < 2 || !(header->flags & MESH_ASSET_FLAG_DISCARD_CPU_COPY);
+    auto mesh = CreateMesh(allocator, vertex_count, index_count, index_size, cluster_count, max(lod_count, 1u), cpu_copy);
     if (!mesh)
         return nullptr;
 
     auto impl = Impl(mesh);
-    ReadBytes(stream, impl->vertices, sizeof(mesh_vertex) * impl->vertex_count);
-    ReadBytes(stream, impl->indices, sizeof(uint16_t) * impl->index_count);
-    UploadMesh(impl, name);
+    impl->bounds = bounds;
+    impl->vertex_format = vertex_format;
+    g_loaded_vertex_formats |= 1 << vertex_format;
+
+    BeginUploadMesh(impl);
+
+    size_t encoded_size = GetVertexStride(impl->vertex_format) * impl->vertex_count;
+    size_t indices_size = index_size * impl->index_count;
+    if (cpu_copy)
+    {
+        // Encoded vertices are read into the tail of the vertex array, staged as is and then
+        // decoded in place for the CPU copy
+        void* encoded = (u8*)impl->vertices + sizeof(mesh_vertex) * impl->vertex_count - encoded_size;
+        ReadBytes(stream, encoded, encoded_size);
+        ReadBytes(stream, impl->indices, indices_size);
+        if (header->version < 2)
+            ConvertLegacyVertices(impl);
+
+        if (void* vertex_data = StageMeshVertices(impl))
+            memcpy(vertex_data, encoded, encoded_size);
+        if (void* index_data = StageMeshIndices(impl))
+            memcpy(index_data, impl->indices, indices_size);
+
+        DecodeVertices(impl->vertex_format, impl->bounds, encoded, impl->vertex_count, impl->vertices);
+    }
+    else
+    {
+        // Without a CPU copy the data goes straight from the stream onto the staging ring and
+        // the allocator only pays for the mesh and its clusters
+        ReadStagedBytes(stream, StageMeshVertices(impl), encoded_size);
+        ReadStagedBytes(stream, StageMeshIndices(impl), indices_size);
+    }
+
+    ReadBytes(stream, impl->clusters, sizeof(MeshCluster) * impl->cluster_count);
+
+    // Meshes without levels of detail keep the single level covering all indices
+    if (lod_count > 0)
+        ReadBytes(stream, impl->lods, sizeof(MeshLod) * lod_count);
 
     return mesh;
 }
 
-#if 0
-static void mesh_destroy_impl(MeshImpl* impl)
+// Draws recorded earlier in the frame still reference the mesh and its heap ranges, so both are
+// released once the frame was submitted.  Uploads into a reused range are submitted after the
+// frame and run after it on the GPU.
+void Destroy(Mesh* mesh)
 {
-    if (impl->index_transfer)
-        SDL_ReleaseGPUTransferBuffer(g_device, impl->index_transfer);
-
-    if (impl->index_buffer)
-        SDL_ReleaseGPUBuffer(g_device, impl->index_buffer);
+    assert(mesh);
 
-    if (impl->vertex_transfer)
-        SDL_ReleaseGPUTransferBuffer(g_device, impl->vertex_transfer);
+    MeshImpl* impl = Impl(mesh);
+    impl->next_destroyed = g_destroyed_meshes;
+    g_destroyed_meshes = impl;
+}
 
-    if (impl->vertex_buffer)
-        SDL_ReleaseGPUBuffer(g_device, impl->vertex_buffer);    
+void ReleaseDestroyedMeshes()
+{
+    while (g_destroyed_meshes)
+    {
+        MeshImpl* impl = g_destroyed_meshes;
+        g_destroyed_meshes = impl->next_destroyed;
+        FreeMeshHeap(impl->heap_handle);
+        impl->heap_handle = -1;
+        Free(GetAllocator((Object*)impl), impl);
+    }
 }
-#endif
 
-void DrawMeshGPU(Mesh* mesh, SDL_GPURenderPass* pass)
+void DrawMeshGPU(Mesh* mesh, SDL_GPURenderPass* pass, u32 draw_index, u32 first_index, u32 index_count)
 {
     assert(pass);
 
     MeshImpl* impl = Impl(mesh);
-    if (!impl->vertex_buffer)
+    if (impl->heap_handle < 0 || index_count == 0)
         return;
 
-    SDL_GPUBufferBinding vertex_binding = {0};
-    vertex_binding.buffer = impl->vertex_buffer;
-    vertex_binding.offset = 0;
-    SDL_BindGPUVertexBuffers(pass, 0, &vertex_binding, 1);
+    BindVertexFormatGPU(impl->vertex_format);
+    BindMeshHeapIndicesGPU(pass, impl->index_size);
+
+    // The heap buffers are bound once per pass, the draw only selects the mesh ranges and
+    // first_instance selects the DrawInstance record bound to slot 1 by the render buffer
+    const MeshHeapAllocation& allocation = GetMeshHeapAllocation(impl->heap_handle);
+    assert(first_index + index_count <= allocation.index_count);
+    SDL_DrawGPUIndexedPrimitives(
+        pass,
+        index_count,
+        1,
+        allocation.index_offset + first_index,
+        (Sint32)allocation.vertex_offset,
+        draw_index);
+}
+
+static void BeginUploadMesh(MeshImpl* impl)
+{
+    assert(impl);
+    assert(impl->heap_handle == -1);
+    assert(g_device);
+
+    // A full heap leaves the mesh without a handle and DrawMeshGPU skips it
+    impl->heap_handle = AllocMeshHeap(
+        GetVertexStride(impl->vertex_format),
+        impl->vertex_count,
+        impl->index_size,
+        impl->index_count);
+}
 
-    SDL_GPUBufferBinding index_binding = {0};
-    index_binding.buffer = impl->index_buffer;
-    SDL_BindGPUIndexBuffer(pass, &index_binding, SDL_GPU_INDEXELEMENTSIZE_16BIT);
+// Reserves the vertex range on the staging ring, it goes out with the next flush.  Reserving can
+// flush and unmap earlier reservations, so the vertices must be written before the indices are
+// reserved.
+static void* StageMeshVertices(MeshImpl* impl)
+{
+    if (impl->heap_handle < 0)
+        return nullptr;
 
-    SDL_DrawGPUIndexedPrimitives(pass, (uint32_t)impl->index_count, 1, 0, 0, 0);
+    u32 vertex_stride = GetVertexStride(impl->vertex_format);
+    const MeshHeapAllocation& allocation = GetMeshHeapAllocation(impl->heap_handle);
+    return UploadToBufferGPU(
+        GetMeshHeapVertexBuffer(),
+        allocation.vertex_offset * vertex_stride,
+        (u32)(vertex_stride * impl->vertex_count));
+}
+
+static void* StageMeshIndices(MeshImpl* impl)
+{
+    if (impl->heap_handle < 0)
+        return nullptr;
+
+    const MeshHeapAllocation& allocation = GetMeshHeapAllocation(impl->heap_handle);
+    return UploadToBufferGPU(
+        GetMeshHeapIndexBuffer(),
+        allocation.index_offset * impl->index_size,
+        (u32)(impl->index_size * impl->index_count));
 }
 
 static void UploadMesh(MeshImpl* impl, const char* name)
 {
-    assert(impl);
-    assert(!impl->vertex_buffer);
-    assert(g_device);
+    assert(impl->vertices);
+    assert(impl->indices);
 
-    size_t vertex_count = impl->vertex_count;
-    size_t index_count = impl->index_count;
-
-    // Create vertex buffer
-    SDL_GPUBufferCreateInfo vertex_info = {0};
-    vertex_info.usage = SDL_GPU_BUFFERUSAGE_VERTEX;
-    vertex_info.size = (uint32_t)(sizeof(mesh_vertex) * vertex_count);
-    vertex_info.props = SDL_CreateProperties();
-    SDL_SetStringProperty(vertex_info.props, SDL_PROP_GPU_BUFFER_CREATE_NAME_STRING, name);
-    impl->vertex_buffer = SDL_CreateGPUBuffer(g_device, &vertex_info);
-    SDL_DestroyProperties(vertex_info.props);
-
-    SDL_GPUTransferBufferCreateInfo vertex_transfer_info = {};
-    vertex_transfer_info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
-    vertex_transfer_info.size = vertex_info.size;
-    vertex_transfer_info.props = 0;
-    impl->vertex_transfer = SDL_CreateGPUTransferBuffer(g_device, &vertex_transfer_info);
-
-    SDL_GPUTransferBufferLocation vertex_source = {impl->vertex_transfer, 0};
-    SDL_GPUBufferRegion vertex_dest = {impl->vertex_buffer, 0, vertex_info.size};
-    void* vertex_mapped = SDL_MapGPUTransferBuffer(g_device, impl->vertex_transfer, false);
-
-    SDL_memcpy(vertex_mapped, impl->vertices, vertex_info.size);
-    SDL_UnmapGPUTransferBuffer(g_device, impl->vertex_transfer);
-
-    SDL_GPUCommandBuffer* vertex_upload_cmd = SDL_AcquireGPUCommandBuffer(g_device);
-    SDL_GPUCopyPass* vertex_copy_pass = SDL_BeginGPUCopyPass(vertex_upload_cmd);
-    SDL_UploadToGPUBuffer(vertex_copy_pass, &vertex_source, &vertex_dest, false);
-    SDL_EndGPUCopyPass(vertex_copy_pass);
-    SDL_SubmitGPUCommandBuffer(vertex_upload_cmd);
-
-    // Create index buffer
-    SDL_GPUBufferCreateInfo index_info = {0};
-    index_info.usage = SDL_GPU_BUFFERUSAGE_INDEX;
-    index_info.size = (uint32_t)(sizeof(uint16_t) * index_count);
-    index_info.props = SDL_CreateProperties();
-    SDL_SetStringProperty(vertex_info.props, SDL_PROP_GPU_BUFFER_CREATE_NAME_STRING, name);
-    impl->index_buffer = SDL_CreateGPUBuffer(g_device, &index_info);
-    SDL_DestroyProperties(index_info.props);
-
-    SDL_GPUTransferBufferCreateInfo index_transfer_info = {};
-    index_transfer_info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
-    index_transfer_info.size = index_info.size;
-    index_transfer_info.props = 0;
-    impl->index_transfer = SDL_CreateGPUTransferBuffer(g_device, &index_transfer_info);
-
-    SDL_GPUTransferBufferLocation index_source = {impl->index_transfer, 0};
-    SDL_GPUBufferRegion index_dest = {impl->index_buffer, 0, index_info.size};
-    void* index_mapped = SDL_MapGPUTransferBuffer(g_device, impl->index_transfer, false);
-
-    SDL_memcpy(index_mapped, impl->indices, index_info.size);
-    SDL_UnmapGPUTransferBuffer(g_device, impl->index_transfer);
-
-    SDL_GPUCommandBuffer* index_upload_cmd = SDL_AcquireGPUCommandBuffer(g_device);
-    SDL_GPUCopyPass* index_copy_pass = SDL_BeginGPUCopyPass(index_upload_cmd);
-    SDL_UploadToGPUBuffer(index_copy_pass, &index_source, &index_dest, false);
-    SDL_EndGPUCopyPass(index_copy_pass);
-    SDL_SubmitGPUCommandBuffer(index_upload_cmd);
+    BeginUploadMesh(impl);
+
+    if (void* vertex_data = StageMeshVertices(impl))
+        EncodeVertices(impl->vertex_format, impl->bounds, impl->vertices, impl->vertex_count, vertex_data);
+    if (void* index_data = StageMeshIndices(impl))
+        memcpy(index_data, impl->indices, impl->index_size * impl->index_count);
 }
 
 size_t GetVertexCount(Mesh* mesh)
@@ -231,13 +380,77 @@ bounds3 GetBounds(Mesh* mesh)
     return Impl(mesh)->bounds;
 }
 
+const mesh_vertex* GetVertices(Mesh* mesh)
+{
+    return Impl(mesh)->vertices;
+}
+
+const void* GetIndices(Mesh* mesh)
+{
+    return Impl(mesh)->indices;
+}
+
+u32 GetIndexSize(Mesh* mesh)
+{
+    return Impl(mesh)->index_size;
+}
+
+size_t GetClusterCount(Mesh* mesh)
+{
+    return Impl(mesh)->cluster_count;
+}
+
+const MeshCluster* GetClusters(Mesh* mesh)
+{
+    return Impl(mesh)->clusters;
+}
+
+size_t GetLodCount(Mesh* mesh)
+{
+    return Impl(mesh)->lod_count;
+}
+
+const MeshLod* GetLods(Mesh* mesh)
+{
+    return Impl(mesh)->lods;
+}
+
+size_t SelectLod(Mesh* mesh, float screen_size)
+{
+    // Levels get coarser and their screen sizes smaller, use the coarsest one still large enough
+    MeshImpl* impl = Impl(mesh);
+    for (size_t lod = impl->lod_count - 1; lod > 0; lod--)
+        if (screen_size < impl->lods[lod].screen_size)
+            return lod;
+
+    return 0;
+}
+
+u32 GetLoadedVertexFormats()
+{
+    return g_loaded_vertex_formats;
+}
+
+VertexFormat GetVertexFormat(Mesh* mesh)
+{
+    return Impl(mesh)->vertex_format;
+}
+
+void GetPositionDecode(Mesh* mesh, vec4* scale, vec4* offset)
+{
+    MeshImpl* impl = Impl(mesh);
+    GetPositionDecode(impl->vertex_format, impl->bounds, scale, offset);
+}
+
 void InitMesh(RendererTraits* traits, SDL_GPUDevice* device)
 {
     g_device = device;
+    g_loaded_vertex_formats = 1 << VERTEX_FORMAT_FLOAT;     // procedural meshes
 }
 
 void ShutdownMesh()
 {
+    ReleaseDestroyedMeshes();
     g_device = nullptr;
 }
 
@@ -9,7 +9,7 @@ struct MeshBuilderImpl
     vec3* normals;
     vec2* uv0;
     uint8_t* bones;
-    uint16_t* indices;
+    uint32_t* indices;
     size_t vertex_count;
     size_t vertex_max;
     size_t index_count;
@@ -36,7 +36,7 @@ MeshBuilder* CreateMeshBuilder(Allocator* allocator, int max_vertices, int max_i
     impl->normals = (vec3*)Alloc(allocator, sizeof(vec3) * max_vertices);
     impl->uv0 = (vec2*)Alloc(allocator, sizeof(vec2) * max_vertices);
     impl->bones = (uint8_t*)Alloc(allocator, sizeof(uint8_t) * max_vertices);
-    impl->indices = (uint16_t*)Alloc(allocator, sizeof(uint16_t) * max_indices);
+    impl->indices = (uint32_t*)Alloc(allocator, sizeof(uint32_t) * max_indices);
     
     if (!impl->positions || !impl->normals || !impl->uv0 || !impl->bones || !impl->indices) {
         free(impl->positions);
@@ -97,7 +97,7 @@ uint8_t* GetBoneIndices(MeshBuilder* builder)
     return Impl(builder)->bones;
 }
 
-uint16_t* GetIndices(MeshBuilder* builder)
+uint32_t* GetIndices(MeshBuilder* builder)
 {
     return Impl(builder)->indices;
 }
@@ -132,7 +132,7 @@ void AddVertex(
     impl->bones[index] = bone_index;
 }
 
-void AddIndex(MeshBuilder* builder, uint16_t index)
+void AddIndex(MeshBuilder* builder, uint32_t index)
 {
     MeshBuilderImpl* impl = Impl(builder);
     impl->is_full = impl->is_full && impl->index_count + 1 >= impl->index_max;
@@ -143,7 +143,7 @@ void AddIndex(MeshBuilder* builder, uint16_t index)
     impl->index_count++;    
 }
 
-void AddTriangle(MeshBuilder* builder, uint16_t a, uint16_t b, uint16_t c)
+void AddTriangle(MeshBuilder* builder, uint32_t a, uint32_t b, uint32_t c)
 {
     MeshBuilderImpl* impl = Impl(builder);
     impl->is_full = impl->is_full && impl->index_count + 3 >= impl->index_max;
@@ -169,7 +169,7 @@ void AddTriangle(
     vec3 normal = normalize(cross(v2, v1));
 
     // Add vertices with computed normal
-    uint16_t vertex_index = (uint16_t)Impl(builder)->vertex_count;
+    uint32_t vertex_index = (uint32_t)Impl(builder)->vertex_count;
     AddVertex(builder, a, normal, { 0.0f, 0.0f }, bone_index);
     AddVertex(builder, a, normal, { 1.0f, 0.0f }, bone_index);
     AddVertex(builder, a, normal, { 0.5f, 1.0f }, bone_index);
@@ -206,7 +206,7 @@ void AddQuad(
     vec3 normal,
     uint8_t bone_index)
 {
-    uint16_t base_index = (uint16_t)Impl(builder)->vertex_count;
+    uint32_t base_index = (uint32_t)Impl(builder)->vertex_count;
 
     // Add vertices
     AddVertex(builder, a, normal, uv_color, bone_index);
@@ -219,6 +219,29 @@ void AddQuad(
     AddTriangle(builder, base_index, base_index + 2, base_index + 3);
 }
 
+// a is the top left corner and the rest follow clockwise, used for atlas images and glyphs
+void AddQuad(
+    MeshBuilder* builder,
+    vec3 a,
+    vec3 b,
+    vec3 c,
+    vec3 d,
+    vec2 uv_min,
+    vec2 uv_max,
+    vec3 normal,
+    uint8_t bone_index)
+{
+    uint32_t base_index = (uint32_t)Impl(builder)->vertex_count;
+
+    AddVertex(builder, a, normal, uv_min, bone_index);
+    AddVertex(builder, b, normal, vec2(uv_max.x, uv_min.y), bone_index);
+    AddVertex(builder, c, normal, uv_max, bone_index);
+    AddVertex(builder, d, normal, vec2(uv_min.x, uv_max.y), bone_index);
+
+    AddTriangle(builder, base_index, base_index + 1, base_index + 2);
+    AddTriangle(builder, base_index, base_index + 2, base_index + 3);
+}
+
 
 void AddPyramid(MeshBuilder* builder, vec3 start, vec3 end, float size, uint8_t bone_index)
 {
@@ -297,7 +320,7 @@ void AddRaw(
 
     for (size_t i = 0; i < index_count; ++i)
     {
-        impl->indices[impl->index_count] = indices[i] + (uint16_t)vertex_start;
+        impl->indices[impl->index_count] = indices[i] + (uint32_t)vertex_start;
         impl->index_count++;
     }
 }
@@ -664,6 +687,47 @@ void mesh_builder::add_cone(
 }
 #endif
 
+bool AddMesh(MeshBuilder* builder, Mesh* mesh, const mat4& transform)
+{
+    assert(builder);
+    assert(mesh);
+
+    // Only the full detail level is merged and the mesh must have kept its CPU copy
+    MeshBuilderImpl* impl = Impl(builder);
+    const mesh_vertex* vertices = GetVertices(mesh);
+    const void* indices = GetIndices(mesh);
+    size_t vertex_count = GetVertexCount(mesh);
+    size_t index_count = GetLods(mesh)->index_count;
+    if (!vertices || !indices)
+        return false;
+
+    if (impl->vertex_count + vertex_count > impl->vertex_max || impl->index_count + index_count > impl->index_max)
+        return false;
+
+    mat3 normal_transform = transpose(inverse(mat3(transform)));
+    size_t base_vertex = impl->vertex_count;
+    for (size_t i = 0; i < vertex_count; i++)
+    {
+        const mesh_vertex& v = vertices[i];
+        size_t index = base_vertex + i;
+        impl->positions[index] = vec3(transform * vec4(v.position, 1.0f));
+        impl->normals[index] = normalize(normal_transform * v.normal);
+        impl->uv0[index] = v.uv0;
+        impl->bones[index] = 0;
+    }
+
+    u32 index_size = GetIndexSize(mesh);
+    for (size_t i = 0; i < index_count; i++)
+    {
+        u32 index = index_size == sizeof(u32) ? ((const u32*)indices)[i] : ((const u16*)indices)[i];
+        impl->indices[impl->index_count + i] = (u32)(base_vertex + index);
+    }
+
+    impl->vertex_count += vertex_count;
+    impl->index_count += index_count;
+    return true;
+}
+
 Mesh* CreateMesh(Allocator* allocator, MeshBuilder* builder, const char* name)
 {
     assert(builder);
@@ -0,0 +1,444 @@
+//
+//  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
+//
+//  All mesh geometry lives in one shared vertex buffer and one shared index buffer.  Meshes own
+//  a handle to a range of each, ranges are handed out first fit from a sorted free list and
+//  coalesced on free.  When a request does not fit the heap is rebuilt into new buffers, packing
+//  every live range to the front (defragmentation) and growing the capacity when needed.
+//
+//  Meshes of different vertex formats and index sizes share the buffers, so ranges are measured
+//  in bytes and start on a multiple of the mesh vertex stride or index size.  That keeps the
+//  offsets passed to the draw a whole number of vertices and indices.
+//
+
+#define MESH_HEAP_INVALID_OFFSET 0xFFFFFFFF
+
+struct HeapRange
+{
+    u32 offset;
+    u32 count;
+};
+
+struct RangeAllocator
+{
+    HeapRange* ranges;
+    size_t range_count;
+    size_t range_max;
+    u32 capacity;
+    u32 used;
+};
+
+struct MeshHeapEntry
+{
+    MeshHeapAllocation allocation;
+    bool used;
+};
+
+struct MeshHeap
+{
+    SDL_GPUBuffer* vertex_buffer;
+    SDL_GPUBuffer* index_buffer;
+    RangeAllocator vertices;
+    RangeAllocator indices;
+    MeshHeapEntry* entries;
+    size_t entry_count;
+    size_t rebuild_count;
+    u32 bound_index_stride;
+};
+
+static SDL_GPUDevice* g_device = nullptr;
+static MeshHeap g_mesh_heap = {};
+
+static void ResetRanges(RangeAllocator& allocator, u32 capacity, u32 used)
+{
+    allocator.capacity = capacity;
+    allocator.used = used;
+    allocator.range_count = 0;
+    if (used < capacity)
+        allocator.ranges[allocator.range_count++] = { used, capacity - used };
+}
+
+static u32 AlignOffset(u32 offset, u32 alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+static u32 FindRange(const RangeAllocator& allocator, u32 count, u32 alignment)
+{
+    for (size_t i = 0; i < allocator.range_count; i++)
+    {
+        const HeapRange& range = allocator.ranges[i];
+        u32 aligned = AlignOffset(range.offset, alignment);
+        if (aligned + count <= range.offset + range.count)
+            return (u32)i;
+    }
+
+    return MESH_HEAP_INVALID_OFFSET;
+}
+
+static u32 AllocRange(RangeAllocator& allocator, u32 count, u32 alignment)
+{
+    u32 range_index = FindRange(allocator, count, alignment);
+    if (range_index == MESH_HEAP_INVALID_OFFSET)
+        return MESH_HEAP_INVALID_OFFSET;
+
+    u32 start = allocator.ranges[range_index].offset;
+    u32 end = start + allocator.ranges[range_index].count;
+    u32 offset = AlignOffset(start, alignment);
+    u32 padding = offset - start;
+
+    // Padding in front of an aligned allocation stays free when there is room to track it,
+    // otherwise it is lost until the next rebuild
+    if (padding > 0 && allocator.range_count < allocator.range_max)
+    {
+        memmove(
+            allocator.ranges + range_index + 1,
+            allocator.ranges + range_index,
+            (allocator.range_count - range_index) * sizeof(HeapRange));
+        allocator.ranges[range_index] = { start, padding };
+        allocator.range_count++;
+        range_index++;
+    }
+    else
+        allocator.used += padding;
+
+    HeapRange& tail = allocator.ranges[range_index];
+    tail.offset = offset + count;
+    tail.count = end - tail.offset;
+
+    if (tail.count == 0)
+    {
+        memmove(
+            allocator.ranges + range_index,
+            allocator.ranges + range_index + 1,
+            (allocator.range_count - range_index - 1) * sizeof(HeapRange));
+        allocator.range_count--;
+    }
+
+    allocator.used += count;
+    return offset;
+}
+
+static void FreeRange(RangeAllocator& allocator, u32 offset, u32 count)
+{
+    if (count == 0)
+        return;
+
+    // Ranges are kept sorted by offset so neighbours can be merged
+    size_t insert = 0;
+    while (insert < allocator.range_count && allocator.ranges[insert].offset < offset)
+        insert++;
+
+    bool merge_prev = insert > 0 &&
+        allocator.ranges[insert - 1].offset + allocator.ranges[insert - 1].count == offset;
+    bool merge_next = insert < allocator.range_count &&
+        offset + count == allocator.ranges[insert].offset;
+
+    if (merge_prev && merge_next)
+    {
+        allocator.ranges[insert - 1].count += count + allocator.ranges[insert].count;
+        memmove(
+            allocator.ranges + insert,
+            allocator.ranges + insert + 1,
+            (allocator.range_count - insert - 1) * sizeof(HeapRange));
+        allocator.range_count--;
+    }
+    else if (merge_prev)
+        allocator.ranges[insert - 1].count += count;
+    else if (merge_next)
+    {
+        allocator.ranges[insert].offset = offset;
+        allocator.ranges[insert].count += count;
+    }
+    else
+    {
+        // A full range table only loses the ability to reuse this hole until the next rebuild
+        if (allocator.range_count < allocator.range_max)
+        {
+            memmove(
+                allocator.ranges + insert + 1,
+                allocator.ranges + insert,
+                (allocator.range_count - insert) * sizeof(HeapRange));
+            allocator.ranges[insert] = { offset, count };
+            allocator.range_count++;
+        }
+    }
+
+    allocator.used -= count;
+}
+
+static SDL_GPUBuffer* CreateHeapBuffer(SDL_GPUBufferUsageFlags usage, size_t size, const char* name)
+{
+    SDL_GPUBufferCreateInfo info = {};
+    info.usage = usage;
+    info.size = (u32)size;
+    info.props = SDL_CreateProperties();
+    SDL_SetStringProperty(info.props, SDL_PROP_GPU_BUFFER_CREATE_NAME_STRING, name);
+    SDL_GPUBuffer* buffer = SDL_CreateGPUBuffer(g_device, &info);
+    SDL_DestroyProperties(info.props);
+
+    if (!buffer)
+        Exit(SDL_GetError());
+
+    return buffer;
+}
+
+// Copy every live range into new buffers of the given capacity in bytes, packed from offset zero
+static void RebuildMeshHeap(u32 vertex_capacity, u32 index_capacity)
+{
+    // Queued uploads still target the old buffers so they must land before the copy
+    FlushUploads();
+
+    SDL_GPUBuffer* vertex_buffer = CreateHeapBuffer(
+        SDL_GPU_BUFFERUSAGE_VERTEX,
+        vertex_capacity,
+        "mesh_vertices");
+    SDL_GPUBuffer* index_buffer = CreateHeapBuffer(
+        SDL_GPU_BUFFERUSAGE_INDEX,
+        index_capacity,
+        "mesh_indices");
+
+    SDL_GPUCommandBuffer* cb = SDL_AcquireGPUCommandBuffer(g_device);
+    if (!cb)
+        Exit(SDL_GetError());
+
+    SDL_GPUCopyPass* copy_pass = SDL_BeginGPUCopyPass(cb);
+    u32 vertex_offset = 0;
+    u32 index_offset = 0;
+    for (size_t i = 0; i < g_mesh_heap.entry_count; i++)
+    {
+        MeshHeapEntry& entry = g_mesh_heap.entries[i];
+        if (!entry.used)
+            continue;
+
+        MeshHeapAllocation& allocation = entry.allocation;
+        vertex_offset = AlignOffset(vertex_offset, allocation.vertex_stride);
+        if (allocation.vertex_count > 0)
+        {
+            SDL_GPUBufferLocation source = {g_mesh_heap.vertex_buffer, allocation.vertex_offset * allocation.vertex_stride};
+            SDL_GPUBufferLocation dest = {vertex_buffer, vertex_offset};
+            SDL_CopyGPUBufferToBuffer(copy_pass, &source, &dest, allocation.vertex_count * allocation.vertex_stride, false);
+        }
+
+        index_offset = AlignOffset(index_offset, allocation.index_stride);
+        if (allocation.index_count > 0)
+        {
+            SDL_GPUBufferLocation source = {g_mesh_heap.index_buffer, allocation.index_offset * allocation.index_stride};
+            SDL_GPUBufferLocation dest = {index_buffer, index_offset};
+            SDL_CopyGPUBufferToBuffer(copy_pass, &source, &dest, allocation.index_count * allocation.index_stride, false);
+        }
+
+        allocation.vertex_offset = vertex_offset / allocation.vertex_stride;
+        allocation.index_offset = index_offset / allocation.index_stride;
+        vertex_offset += allocation.vertex_count * allocation.vertex_stride;
+        index_offset += allocation.index_count * allocation.index_stride;
+    }
+    SDL_EndGPUCopyPass(copy_pass);
+    SDL_SubmitGPUCommandBuffer(cb);
+
+    // Released buffers stay alive until the copy above and any frame in flight are done
+    if (g_mesh_heap.vertex_buffer)
+        SDL_ReleaseGPUBuffer(g_device, g_mesh_heap.vertex_buffer);
+    if (g_mesh_heap.index_buffer)
+        SDL_ReleaseGPUBuffer(g_device, g_mesh_heap.index_buffer);
+
+    g_mesh_heap.vertex_buffer = vertex_buffer;
+    g_mesh_heap.index_buffer = index_buffer;
+    ResetRanges(g_mesh_heap.vertices, vertex_capacity, vertex_offset);
+    ResetRanges(g_mesh_heap.indices, index_capacity, index_offset);
+    g_mesh_heap.rebuild_count++;
+}
+
+// Size of the vertex and index data once every live range is packed, including alignment padding
+static void GetPackedSize(u32* vertex_size, u32* index_size)
+{
+    *vertex_size = 0;
+    *index_size = 0;
+    for (size_t i = 0; i < g_mesh_heap.entry_count; i++)
+    {
+        const MeshHeapEntry& entry = g_mesh_heap.entries[i];
+        if (!entry.used)
+            continue;
+
+        const MeshHeapAllocation& allocation = entry.allocation;
+        *vertex_size = AlignOffset(*vertex_size, allocation.vertex_stride) + allocation.vertex_count * allocation.vertex_stride;
+        *index_size = AlignOffset(*index_size, allocation.index_stride) + allocation.index_count * allocation.index_stride;
+    }
+}
+
+// Defragmenting is enough when the packed data and the request fit the current capacity
+static u32 GetRequiredCapacity(u32 capacity, u32 required)
+{
+    if (required <= capacity)
+        return capacity;
+
+    return (u32)noz::NextPowerOf2(required);
+}
+
+int AllocMeshHeap(u32 vertex_stride, size_t vertex_count, u32 index_stride, size_t index_count)
+{
+    assert(vertex_stride > 0);
+    assert(index_stride > 0);
+
+    int handle = -1;
+    for (size_t i = 0; i < g_mesh_heap.entry_count; i++)
+    {
+        if (!g_mesh_heap.entries[i].used)
+        {
+            handle = (int)i;
+            break;
+        }
+    }
+
+    if (handle == -1)
+        return -1;
+
+    u32 vertex_size = (u32)vertex_count * vertex_stride;
+    u32 index_size = (u32)index_count * index_stride;
+    if (FindRange(g_mesh_heap.vertices, vertex_size, vertex_stride) == MESH_HEAP_INVALID_OFFSET ||
+        FindRange(g_mesh_heap.indices, index_size, index_stride) == MESH_HEAP_INVALID_OFFSET)
+    {
+        u32 packed_vertex_size;
+        u32 packed_index_size;
+        GetPackedSize(&packed_vertex_size, &packed_index_size);
+        RebuildMeshHeap(
+            GetRequiredCapacity(g_mesh_heap.vertices.capacity, AlignOffset(packed_vertex_size, vertex_stride) + vertex_size),
+            GetRequiredCapacity(g_mesh_heap.indices.capacity, AlignOffset(packed_index_size, index_stride) + index_size));
+    }
+
+    MeshHeapEntry& entry = g_mesh_heap.entries[handle];
+    entry.used = true;
+    entry.allocation.vertex_stride = vertex_stride;
+    entry.allocation.vertex_count = (u32)vertex_count;
+    entry.allocation.vertex_offset = 0;
+    entry.allocation.index_stride = index_stride;
+    entry.allocation.index_count = (u32)index_count;
+    entry.allocation.index_offset = 0;
+
+    if (vertex_count > 0)
+    {
+        u32 vertex_offset = AllocRange(g_mesh_heap.vertices, vertex_size, vertex_stride);
+        assert(vertex_offset != MESH_HEAP_INVALID_OFFSET);
+        entry.allocation.vertex_offset = vertex_offset / vertex_stride;
+    }
+
+    if (index_count > 0)
+    {
+        u32 index_offset = AllocRange(g_mesh_heap.indices, index_size, index_stride);
+        assert(index_offset != MESH_HEAP_INVALID_OFFSET);
+        entry.allocation.index_offset = index_offset / index_stride;
+    }
+
+    return handle;
+}
+
+void FreeMeshHeap(int handle)
+{
+    if (handle < 0 || handle >= (int)g_mesh_heap.entry_count)
+        return;
+
+    MeshHeapEntry& entry = g_mesh_heap.entries[handle];
+    if (!entry.used)
+        return;
+
+    const MeshHeapAllocation& allocation = entry.allocation;
+    FreeRange(
+        g_mesh_heap.vertices,
+        allocation.vertex_offset * allocation.vertex_stride,
+        allocation.vertex_count * allocation.vertex_stride);
+    FreeRange(
+        g_mesh_heap.indices,
+        allocation.index_offset * allocation.index_stride,
+        allocation.index_count * allocation.index_stride);
+    entry = {};
+}
+
+void DefragMeshHeap()
+{
+    if (g_mesh_heap.vertices.range_count <= 1 && g_mesh_heap.indices.range_count <= 1)
+        return;
+
+    RebuildMeshHeap(g_mesh_heap.vertices.capacity, g_mesh_heap.indices.capacity);
+}
+
+const MeshHeapAllocation& GetMeshHeapAllocation(int handle)
+{
+    assert(handle >= 0 && handle < (int)g_mesh_heap.entry_count);
+    return g_mesh_heap.entries[handle].allocation;
+}
+
+SDL_GPUBuffer* GetMeshHeapVertexBuffer()
+{
+    return g_mesh_heap.vertex_buffer;
+}
+
+SDL_GPUBuffer* GetMeshHeapIndexBuffer()
+{
+    return g_mesh_heap.index_buffer;
+}
+
+void BindMeshHeapGPU(SDL_GPURenderPass* pass)
+{
+    SDL_GPUBufferBinding vertex_binding = {g_mesh_heap.vertex_buffer, 0};
+    SDL_BindGPUVertexBuffers(pass, 0, &vertex_binding, 1);
+
+    // The index buffer is bound by the first draw since its element size depends on the mesh
+    g_mesh_heap.bound_index_stride = 0;
+}
+
+void BindMeshHeapIndicesGPU(SDL_GPURenderPass* pass, u32 index_stride)
+{
+    if (g_mesh_heap.bound_index_stride == index_stride)
+        return;
+
+    SDL_GPUBufferBinding index_binding = {g_mesh_heap.index_buffer, 0};
+    SDL_BindGPUIndexBuffer(
+        pass,
+        &index_binding,
+        index_stride == sizeof(u32) ? SDL_GPU_INDEXELEMENTSIZE_32BIT : SDL_GPU_INDEXELEMENTSIZE_16BIT);
+    g_mesh_heap.bound_index_stride = index_stride;
+}
+
+void InitMeshHeap(RendererTraits* traits, SDL_GPUDevice* device)
+{
+    assert(!g_device);
+
+    g_device = device;
+
+    // Every live allocation can split a free range in two and leave alignment padding in front
+    // of it, so 2 * max_meshes + 1 ranges is enough
+    size_t range_max = traits->max_meshes * 2 + 1;
+    size_t memory_size =
+        sizeof(MeshHeapEntry) * traits->max_meshes +
+        sizeof(HeapRange) * range_max * 2;
+
+    u8* memory = (u8*)calloc(1, memory_size);
+    if (!memory)
+    {
+        ExitOutOfMemory("mesh_heap");
+        return;
+    }
+
+    g_mesh_heap.entries = (MeshHeapEntry*)memory;
+    g_mesh_heap.entry_count = traits->max_meshes;
+    g_mesh_heap.vertices.ranges = (HeapRange*)(g_mesh_heap.entries + traits->max_meshes);
+    g_mesh_heap.vertices.range_max = range_max;
+    g_mesh_heap.indices.ranges = g_mesh_heap.vertices.ranges + range_max;
+    g_mesh_heap.indices.range_max = range_max;
+
+    RebuildMeshHeap(
+        (u32)(traits->mesh_heap_vertices * sizeof(mesh_vertex)),
+        (u32)(traits->mesh_heap_indices * sizeof(u16)));
+    g_mesh_heap.rebuild_count = 0;
+}
+
+void ShutdownMeshHeap()
+{
+    assert(g_device);
+
+    SDL_ReleaseGPUBuffer(g_device, g_mesh_heap.vertex_buffer);
+    SDL_ReleaseGPUBuffer(g_device, g_mesh_heap.index_buffer);
+    free(g_mesh_heap.entries);
+    g_mesh_heap = {};
+    g_device = nullptr;
+}
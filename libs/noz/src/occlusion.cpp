@@ -0,0 +1,348 @@
+//
+//  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
+//
+//  CPU occlusion culling.  Occluder triangles are rasterized into a small depth buffer that
+//  holds the nearest clip space depth per pixel, a hierarchical-Z chain is built by taking the
+//  farthest depth of each 2x2 block, and boxes are occluded when their nearest depth is behind
+//  every texel of the hierarchical-Z level that covers them.  Nothing here touches the GPU.
+//
+
+#include <float.h>
+#include <math.h>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define NOZ_OCCLUSION_SSE 1
+#endif
+
+#define OCCLUSION_MAX_LEVELS 16
+#define OCCLUSION_NEAR_W 0.0001f
+
+struct OcclusionLevel
+{
+    float* depth;
+    int width;
+    int height;
+};
+
+struct Occlusion
+{
+    float* memory;
+    OcclusionLevel levels[OCCLUSION_MAX_LEVELS];
+    int level_count;
+    mat4 view_projection;
+    bool has_occluders;
+};
+
+static Occlusion g_occlusion = {};
+
+struct OcclusionVertex
+{
+    float x;
+    float y;
+    float z;
+};
+
+static bool ToScreen(const vec4& clip, OcclusionVertex& out)
+{
+    if (clip.w <= OCCLUSION_NEAR_W)
+        return false;
+
+    float inv_w = 1.0f / clip.w;
+    const OcclusionLevel& level = g_occlusion.levels[0];
+    out.x = (clip.x * inv_w * 0.5f + 0.5f) * (float)level.width;
+    out.y = (clip.y * inv_w * 0.5f + 0.5f) * (float)level.height;
+    out.z = clip.z * inv_w;
+    return true;
+}
+
+static void RasterizeTriangle(OcclusionVertex v0, OcclusionVertex v1, OcclusionVertex v2)
+{
+    const OcclusionLevel& level = g_occlusion.levels[0];
+
+    // Occluders are rasterized regardless of winding
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (area < 0.0f)
+    {
+        OcclusionVertex t = v1;
+        v1 = v2;
+        v2 = t;
+        area = -area;
+    }
+
+    if (area < 1e-6f)
+        return;
+
+    int min_x = (int)floorf(min(v0.x, min(v1.x, v2.x)));
+    int max_x = (int)ceilf(max(v0.x, max(v1.x, v2.x)));
+    int min_y = (int)floorf(min(v0.y, min(v1.y, v2.y)));
+    int max_y = (int)ceilf(max(v0.y, max(v1.y, v2.y)));
+    min_x = max(min_x, 0) & ~3;
+    min_y = max(min_y, 0);
+    max_x = min(max_x, level.width - 1);
+    max_y = min(max_y, level.height - 1);
+    if (min_x > max_x || min_y > max_y)
+        return;
+
+    // Edge functions E(p) = a * x + b * y + c, positive inside for counter clockwise triangles
+    float a0 = v1.y - v2.y, b0 = v2.x - v1.x, c0 = -(a0 * v1.x + b0 * v1.y);
+    float a1 = v2.y - v0.y, b1 = v0.x - v2.x, c1 = -(a1 * v2.x + b1 * v2.y);
+    float a2 = v0.y - v1.y, b2 = v1.x - v0.x, c2 = -(a2 * v0.x + b2 * v0.y);
+
+    // Depth is affine in screen space so it can be evaluated as a plane as well
+    float inv_area = 1.0f / area;
+    float za = (a0 * v0.z + a1 * v1.z + a2 * v2.z) * inv_area;
+    float zb = (b0 * v0.z + b1 * v1.z + b2 * v2.z) * inv_area;
+    float zc = (c0 * v0.z + c1 * v1.z + c2 * v2.z) * inv_area;
+
+#if NOZ_OCCLUSION_SSE
+    const __m128 lane = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 step0 = _mm_set1_ps(a0 * 4.0f);
+    const __m128 step1 = _mm_set1_ps(a1 * 4.0f);
+    const __m128 step2 = _mm_set1_ps(a2 * 4.0f);
+    const __m128 stepz = _mm_set1_ps(za * 4.0f);
+
+    for (int y = min_y; y <= max_y; y++)
+    {
+        float py = (float)y + 0.5f;
+        __m128 px = _mm_add_ps(_mm_set1_ps((float)min_x), lane);
+        __m128 w0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a0), px), _mm_set1_ps(b0 * py + c0));
+        __m128 w1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a1), px), _mm_set1_ps(b1 * py + c1));
+        __m128 w2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a2), px), _mm_set1_ps(b2 * py + c2));
+        __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(za), px), _mm_set1_ps(zb * py + zc));
+
+        float* row = level.depth + (size_t)y * level.width;
+        for (int x = min_x; x <= max_x; x += 4)
+        {
+            __m128 inside = _mm_and_ps(
+                _mm_cmpge_ps(w0, zero),
+                _mm_and_ps(_mm_cmpge_ps(w1, zero), _mm_cmpge_ps(w2, zero)));
+
+            if (_mm_movemask_ps(inside))
+            {
+                __m128 depth = _mm_loadu_ps(row + x);
+                __m128 nearest = _mm_min_ps(depth, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, depth)));
+            }
+
+            w0 = _mm_add_ps(w0, step0);
+            w1 = _mm_add_ps(w1, step1);
+            w2 = _mm_add_ps(w2, step2);
+            z = _mm_add_ps(z, stepz);
+        }
+    }
+#else
+    for (int y = min_y; y <= max_y; y++)
+    {
+        float py = (float)y + 0.5f;
+        float* row = level.depth + (size_t)y * level.width;
+        for (int x = min_x; x <= max_x; x++)
+        {
+            float px = (float)x + 0.5f;
+            if (a0 * px + b0 * py + c0 < 0.0f ||
+                a1 * px + b1 * py + c1 < 0.0f ||
+                a2 * px + b2 * py + c2 < 0.0f)
+                continue;
+
+            float z = za * px + zb * py + zc;
+            row[x] = min(row[x], z);
+        }
+    }
+#endif
+}
+
+void ClearOcclusion(const mat4& view_projection)
+{
+    if (!g_occlusion.memory)
+        return;
+
+    const OcclusionLevel& level = g_occlusion.levels[0];
+    size_t count = (size_t)level.width * level.height;
+    for (size_t i = 0; i < count; i++)
+        level.depth[i] = FLT_MAX;
+
+    g_occlusion.view_projection = view_projection;
+    g_occlusion.has_occluders = false;
+}
+
+static u32 GetIndex(const void* indices, u32 index_size, size_t index)
+{
+    return index_size == sizeof(u32) ? ((const u32*)indices)[index] : ((const u16*)indices)[index];
+}
+
+void RasterizeOccluder(const mesh_vertex* vertices, size_t vertex_count, const void* indices, u32 index_size, size_t index_count, const mat4& transform)
+{
+    if (!g_occlusion.memory || !vertices || !indices)
+        return;
+
+    mat4 mvp = g_occlusion.view_projection * transform;
+    for (size_t i = 0; i + 2 < index_count; i += 3)
+    {
+        u32 i0 = GetIndex(indices, index_size, i + 0);
+        u32 i1 = GetIndex(indices, index_size, i + 1);
+        u32 i2 = GetIndex(indices, index_size, i + 2);
+        if (i0 >= vertex_count || i1 >= vertex_count || i2 >= vertex_count)
+            continue;
+
+        // Triangles crossing the near plane are skipped rather than clipped, dropping occluder
+        // coverage only ever makes the test more conservative.
+        OcclusionVertex s0, s1, s2;
+        if (!ToScreen(mvp * vec4(vertices[i0].position, 1.0f), s0) ||
+            !ToScreen(mvp * vec4(vertices[i1].position, 1.0f), s1) ||
+            !ToScreen(mvp * vec4(vertices[i2].position, 1.0f), s2))
+            continue;
+
+        RasterizeTriangle(s0, s1, s2);
+    }
+
+    g_occlusion.has_occluders = true;
+}
+
+void BuildOcclusionHiZ()
+{
+    if (!g_occlusion.memory)
+        return;
+
+    for (int level_index = 1; level_index < g_occlusion.level_count; level_index++)
+    {
+        const OcclusionLevel& src = g_occlusion.levels[level_index - 1];
+        const OcclusionLevel& dst = g_occlusion.levels[level_index];
+        for (int y = 0; y < dst.height; y++)
+        {
+            int sy0 = min(y * 2, src.height - 1);
+            int sy1 = min(y * 2 + 1, src.height - 1);
+            const float* row0 = src.depth + (size_t)sy0 * src.width;
+            const float* row1 = src.depth + (size_t)sy1 * src.width;
+            float* out = dst.depth + (size_t)y * dst.width;
+            for (int x = 0; x < dst.width; x++)
+            {
+                int sx0 = min(x * 2, src.width - 1);
+                int sx1 = min(x * 2 + 1, src.width - 1);
+                out[x] = max(max(row0[sx0], row0[sx1]), max(row1[sx0], row1[sx1]));
+            }
+        }
+    }
+}
+
+static bool IsOccluded(const bounds3& bounds)
+{
+    const OcclusionLevel& base = g_occlusion.levels[0];
+
+    // Project the eight corners, anything touching the near plane is treated as visible
+    vec2 screen_min = { FLT_MAX, FLT_MAX };
+    vec2 screen_max = { -FLT_MAX, -FLT_MAX };
+    float nearest = FLT_MAX;
+    for (int i = 0; i < 8; i++)
+    {
+        vec3 corner = {
+            (i & 1) ? bounds.max.x : bounds.min.x,
+            (i & 2) ? bounds.max.y : bounds.min.y,
+            (i & 4) ? bounds.max.z : bounds.min.z };
+
+        OcclusionVertex screen;
+        if (!ToScreen(g_occlusion.view_projection * vec4(corner, 1.0f), screen))
+            return false;
+
+        screen_min = glm::min(screen_min, vec2(screen.x, screen.y));
+        screen_max = glm::max(screen_max, vec2(screen.x, screen.y));
+        nearest = min(nearest, screen.z);
+    }
+
+    int x0 = max((int)floorf(screen_min.x), 0);
+    int y0 = max((int)floorf(screen_min.y), 0);
+    int x1 = min((int)floorf(screen_max.x), base.width - 1);
+    int y1 = min((int)floorf(screen_max.y), base.height - 1);
+    if (x0 > x1 || y0 > y1)
+        return false;
+
+    // Pick the level where the rectangle covers at most 2x2 texels
+    int level_index = 0;
+    while (level_index + 1 < g_occlusion.level_count &&
+           ((x1 >> level_index) - (x0 >> level_index) > 1 || (y1 >> level_index) - (y0 >> level_index) > 1))
+        level_index++;
+
+    const OcclusionLevel& level = g_occlusion.levels[level_index];
+    int lx0 = min(x0 >> level_index, level.width - 1);
+    int ly0 = min(y0 >> level_index, level.height - 1);
+    int lx1 = min(x1 >> level_index, level.width - 1);
+    int ly1 = min(y1 >> level_index, level.height - 1);
+
+    float farthest = -FLT_MAX;
+    for (int y = ly0; y <= ly1; y++)
+        for (int x = lx0; x <= lx1; x++)
+            farthest = max(farthest, level.depth[(size_t)y * level.width + x]);
+
+    return nearest > farthest;
+}
+
+size_t CullOcclusion(const bounds3* bounds, size_t count, bool* visible)
+{
+    size_t visible_count = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        visible[i] = !g_occlusion.memory || !g_occlusion.has_occluders || !IsOccluded(bounds[i]);
+        visible_count += visible[i] ? 1 : 0;
+    }
+
+    return visible_count;
+}
+
+bool IsOcclusionEnabled()
+{
+    return g_occlusion.memory != nullptr;
+}
+
+void InitOcclusion(RendererTraits* traits)
+{
+    assert(!g_occlusion.memory);
+
+    if (!traits->occlusion_width || !traits->occlusion_height)
+        return;
+
+    // Width is padded to a multiple of four so the rasterizer can always write whole lanes
+    int width = ((int)traits->occlusion_width + 3) & ~3;
+    int height = (int)traits->occlusion_height;
+
+    size_t total = 0;
+    int level_width = width;
+    int level_height = height;
+    int level_count = 0;
+    while (level_count < OCCLUSION_MAX_LEVELS)
+    {
+        total += (size_t)level_width * level_height;
+        level_count++;
+        if (level_width == 1 && level_height == 1)
+            break;
+
+        level_width = max((level_width + 1) / 2, 1);
+        level_height = max((level_height + 1) / 2, 1);
+    }
+
+    g_occlusion.memory = (float*)malloc(total * sizeof(float));
+    if (!g_occlusion.memory)
+    {
+        ExitOutOfMemory("occlusion");
+        return;
+    }
+
+    float* depth = g_occlusion.memory;
+    level_width = width;
+    level_height = height;
+    for (int i = 0; i < level_count; i++)
+    {
+        g_occlusion.levels[i] = { depth, level_width, level_height };
+        depth += (size_t)level_width * level_height;
+        level_width = max((level_width + 1) / 2, 1);
+        level_height = max((level_height + 1) / 2, 1);
+    }
+
+    g_occlusion.level_count = level_count;
+    ClearOcclusion(identity<mat4>());
+}
+
+void ShutdownOcclusion()
+{
+    free(g_occlusion.memory);
+    g_occlusion = {};
+}
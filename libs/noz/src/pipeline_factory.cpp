@@ -4,35 +4,53 @@
 
 #define INITIAL_CACHE_SIZE 64
 
+constexpr const char* PIPELINE_CACHE_FILE = "pipelines.cache";
+constexpr const char* PIPELINE_CACHE_SIGNATURE = "NZPC";
+constexpr u32 PIPELINE_CACHE_VERSION = 1;
+
+// Everything a pipeline is created from besides the shader object itself, persisted between
+// launches so the pipelines used last time are created while loading
+struct PipelinePermutation
+{
+    u64 shader_hash;
+    VertexFormat vertex_format;
+    bool msaa;
+    bool shadow;
+};
+
 struct Pipeline
 {
     SDL_GPUGraphicsPipeline* gpu_pipeline;
+    PipelinePermutation permutation;
 };
 
 static Map g_cache = {};
 static u64* g_cache_keys = nullptr;
 static Pipeline* g_cache_pipelines = nullptr;
+static PipelinePermutation* g_saved_permutations = nullptr;
+static size_t g_saved_permutation_count = 0;
+static size_t g_max_pipelines = 0;
 static SDL_GPUDevice* g_device = nullptr;
 static SDL_Window* g_window = nullptr;
 
-static uint64_t MakeKey(Shader* shader, bool msaa, bool shadow)
+static uint64_t MakeKey(Shader* shader, VertexFormat vertex_format, bool msaa, bool shadow)
 {
-    struct {
-        void* shader_ptr;
-        bool msaa;
-        bool shadow;
-    } key_data = {shader, msaa, shadow};
-    
-    return Hash(&key_data, sizeof(key_data));
+    u64 key = GetContentHash(shader);
+    u8 options[3] = { (u8)vertex_format, (u8)msaa, (u8)shadow };
+    return Hash(options, sizeof(options), key);
 }
 
-static uint32_t GetVertexStride(const SDL_GPUVertexAttribute* attributes, size_t attribute_count)
+static uint32_t GetVertexStride(const SDL_GPUVertexAttribute* attributes, size_t attribute_count, uint32_t buffer_slot)
 {
-    if (attribute_count == 0) 
+    // Calculate stride based on the last attribute in the slot's offset + size
+    const SDL_GPUVertexAttribute* last_attr = nullptr;
+    for (size_t i = 0; i < attribute_count; i++)
+        if (attributes[i].buffer_slot == buffer_slot && (!last_attr || attributes[i].offset > last_attr->offset))
+            last_attr = &attributes[i];
+
+    if (!last_attr)
         return 0;
 
-    // Calculate stride based on the last attribute's offset + size
-    const SDL_GPUVertexAttribute* last_attr = &attributes[attribute_count - 1];
     uint32_t stride = last_attr->offset;
 
     // Add size based on attribute format
@@ -43,6 +61,7 @@ static uint32_t GetVertexStride(const SDL_GPUVertexAttribute* attributes, size_t
     default:
         stride += 4;
         break;
+    case SDL_GPU_VERTEXELEMENTFORMAT_UINT2:
     case SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2:
         stride += 8; // 2 * 4 bytes
         break;
@@ -50,6 +69,7 @@ static uint32_t GetVertexStride(const SDL_GPUVertexAttribute* attributes, size_t
         stride += 12; // 3 * 4 bytes
         break;
     case SDL_GPU_VERTEXELEMENTFORMAT_INT4:
+    case SDL_GPU_VERTEXELEMENTFORMAT_UINT4:
     case SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4:
         stride += 16; // 4 * 4 bytes
         break;
@@ -60,6 +80,7 @@ static uint32_t GetVertexStride(const SDL_GPUVertexAttribute* attributes, size_t
 
 static SDL_GPUGraphicsPipeline* CreateGPUPipeline(
     Shader* shader,
+    VertexFormat vertex_format,
     const SDL_GPUVertexAttribute* attributes,
     size_t attribute_count,
     bool msaa,
@@ -69,16 +90,18 @@ static SDL_GPUGraphicsPipeline* CreateGPUPipeline(
     assert(g_device);
     assert(shader);
 
-    // Create pipeline directly using the shader's compiled shaders
-    uint32_t vertexStride = GetVertexStride(attributes, attribute_count);
-
-    SDL_GPUVertexBufferDescription vertex_buffer_desc = {};
-    vertex_buffer_desc.pitch = vertexStride;
-    vertex_buffer_desc.input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX;
+    // Slot 0 is the mesh vertex buffer, slot 1 the per draw instance buffer owned by the render buffer
+    SDL_GPUVertexBufferDescription vertex_buffer_desc[2] = {};
+    vertex_buffer_desc[0].slot = 0;
+    vertex_buffer_desc[0].pitch = GetVertexStride(vertex_format);
+    vertex_buffer_desc[0].input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX;
+    vertex_buffer_desc[1].slot = 1;
+    vertex_buffer_desc[1].pitch = GetVertexStride(attributes, attribute_count, 1);
+    vertex_buffer_desc[1].input_rate = SDL_GPU_VERTEXINPUTRATE_INSTANCE;
 
     SDL_GPUVertexInputState vertex_input_state = {};
-    vertex_input_state.vertex_buffer_descriptions = &vertex_buffer_desc;
-    vertex_input_state.num_vertex_buffers = 1;
+    vertex_input_state.vertex_buffer_descriptions = vertex_buffer_desc;
+    vertex_input_state.num_vertex_buffers = 2;
     vertex_input_state.vertex_attributes = attributes;
     vertex_input_state.num_vertex_attributes = (uint32_t)attribute_count;
 
@@ -161,26 +184,45 @@ static SDL_GPUGraphicsPipeline* CreateGPUPipeline(
     return pipeline;
 }
 
-SDL_GPUGraphicsPipeline* GetGPUPipeline(Shader* shader, bool msaa, bool shadow)
+SDL_GPUGraphicsPipeline* GetGPUPipeline(Shader* shader, VertexFormat vertex_format, bool msaa, bool shadow)
 {
     assert(g_window);
     assert(g_device);
     assert(shader);
 
-    auto key = MakeKey(shader, msaa, shadow);
+    auto key = MakeKey(shader, vertex_format, msaa, shadow);
     auto* pipeline = (Pipeline*)GetValue(g_cache, key);
     if (pipeline != nullptr)
         return pipeline->gpu_pipeline;
 
-    // Create new pipeline
+    // Create new pipeline, every vertex format feeds the same shader inputs
     SDL_GPUVertexAttribute attributes[] = {
-        {0, 0, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3, 0},                 // position : POSITION (semantic 0)
-        {1, 0, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2, sizeof(float) * 3}, // uv0 : TEXCOORD1 (semantic 2)
-        {2, 0, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3, sizeof(float) * 5}, // normal : TEXCOORD2 (semantic 1)
-        {3, 0, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT, sizeof(float) * 8}   // bone_index : TEXCOORD3 (semantic 3)
+        {0, 0, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4, offsetof(mesh_vertex, position)},  // position + bone : POSITION
+        {1, 0, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2, offsetof(mesh_vertex, uv0)},       // uv0 : TEXCOORD0
+        {2, 0, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3, offsetof(mesh_vertex, normal)},    // normal : TEXCOORD1
+        {3, 1, SDL_GPU_VERTEXELEMENTFORMAT_UINT4, 0},                                 // draw : TEXCOORD2 (transform index, bone offset, vertex format)
+        {4, 1, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4, sizeof(u32) * 4},                  // position_scale : TEXCOORD3
+        {5, 1, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4, sizeof(u32) * 4 + sizeof(vec4)}    // position_offset : TEXCOORD4
     };
 
-    SDL_GPUGraphicsPipeline* gpu_pipeline = CreateGPUPipeline(shader, attributes, 4, msaa, shadow);
+    if (vertex_format != VERTEX_FORMAT_FLOAT)
+    {
+        attributes[0] = {0, 0,
+            vertex_format == VERTEX_FORMAT_UNORM16
+                ? SDL_GPU_VERTEXELEMENTFORMAT_USHORT4_NORM
+                : SDL_GPU_VERTEXELEMENTFORMAT_HALF4,
+            offsetof(mesh_vertex_compact, position)};
+        attributes[1] = {1, 0, SDL_GPU_VERTEXELEMENTFORMAT_HALF2, offsetof(mesh_vertex_compact, uv0)};
+        attributes[2] = {2, 0, SDL_GPU_VERTEXELEMENTFORMAT_SHORT2_NORM, offsetof(mesh_vertex_compact, normal)};
+    }
+
+    SDL_GPUGraphicsPipeline* gpu_pipeline = CreateGPUPipeline(
+        shader,
+        vertex_format,
+        attributes,
+        sizeof(attributes) / sizeof(SDL_GPUVertexAttribute),
+        msaa,
+        shadow);
     if (!gpu_pipeline)
         return nullptr;
 
@@ -189,9 +231,88 @@ SDL_GPUGraphicsPipeline* GetGPUPipeline(Shader* shader, bool msaa, bool shadow)
         ExitOutOfMemory("pipeline limit exceeded");
 
     pipeline->gpu_pipeline = gpu_pipeline;
+    pipeline->permutation = { GetContentHash(shader), vertex_format, msaa, shadow };
     return pipeline->gpu_pipeline;
 }
 
+void PrewarmSavedPipelines(Shader** shaders, size_t shader_count)
+{
+    for (size_t i = 0; i < g_saved_permutation_count; i++)
+    {
+        const PipelinePermutation& permutation = g_saved_permutations[i];
+        for (size_t shader_index = 0; shader_index < shader_count; shader_index++)
+        {
+            Shader* shader = shaders[shader_index];
+            if (!shader || GetContentHash(shader) != permutation.shader_hash)
+                continue;
+
+            GetGPUPipeline(shader, permutation.vertex_format, permutation.msaa, permutation.shadow);
+            break;
+        }
+    }
+}
+
+static std::filesystem::path GetPipelineCachePath()
+{
+    const char* base_path = SDL_GetBasePath();
+    std::filesystem::path path = base_path ? base_path : "";
+    return path / PIPELINE_CACHE_FILE;
+}
+
+// Permutations of shaders that changed since the cache was written no longer match any shader
+// hash and are skipped while prewarming
+static void LoadPipelineCache()
+{
+    g_saved_permutation_count = 0;
+
+    std::filesystem::path path = GetPipelineCachePath();
+    if (!std::filesystem::exists(path))
+        return;
+
+    Stream* stream = LoadStream(nullptr, path);
+    if (!stream)
+        return;
+
+    if (ReadFileSignature(stream, PIPELINE_CACHE_SIGNATURE, 4) && ReadU32(stream) == PIPELINE_CACHE_VERSION)
+    {
+        size_t count = min((size_t)ReadU32(stream), g_max_pipelines);
+        for (size_t i = 0; i < count && !IsEOS(stream); i++)
+        {
+            PipelinePermutation& permutation = g_saved_permutations[g_saved_permutation_count];
+            permutation.shader_hash = ReadU64(stream);
+            permutation.vertex_format = (VertexFormat)ReadU8(stream);
+            permutation.msaa = ReadBool(stream);
+            permutation.shadow = ReadBool(stream);
+            if (permutation.vertex_format < VERTEX_FORMAT_COUNT)
+                g_saved_permutation_count++;
+        }
+    }
+
+    Destroy(stream);
+}
+
+static void SavePipelineCache()
+{
+    Stream* stream = CreateStream(nullptr, 1024);
+    if (!stream)
+        return;
+
+    WriteFileSignature(stream, PIPELINE_CACHE_SIGNATURE, 4);
+    WriteU32(stream, PIPELINE_CACHE_VERSION);
+    WriteU32(stream, (u32)g_cache.count);
+    for (size_t i = 0; i < g_cache.count; i++)
+    {
+        const PipelinePermutation& permutation = g_cache_pipelines[i].permutation;
+        WriteU64(stream, permutation.shader_hash);
+        WriteU8(stream, (u8)permutation.vertex_format);
+        WriteBool(stream, permutation.msaa);
+        WriteBool(stream, permutation.shadow);
+    }
+
+    SaveStream(stream, GetPipelineCachePath());
+    Destroy(stream);
+}
+
 void InitPipelineFactory(RendererTraits* traits, SDL_Window* win, SDL_GPUDevice* dev)
 {
     assert(!g_device);
@@ -201,13 +322,20 @@ void InitPipelineFactory(RendererTraits* traits, SDL_Window* win, SDL_GPUDevice*
     g_cache_keys = (u64*)Alloc(nullptr, sizeof(u64) * traits->max_pipelines);
     g_cache_pipelines = (Pipeline*)Alloc(nullptr, sizeof(Pipeline) * traits->max_pipelines);
     g_cache = CreateMap(g_cache_keys, traits->max_pipelines, g_cache_pipelines, sizeof(Pipeline));
+    g_max_pipelines = traits->max_pipelines;
+    g_saved_permutations = (PipelinePermutation*)Alloc(nullptr, sizeof(PipelinePermutation) * traits->max_pipelines);
+    LoadPipelineCache();
 }
 
 void ShutdownPipelineFactory()
 {
     assert(g_device);
+    SavePipelineCache();
     Free(nullptr, g_cache_keys);
     Free(nullptr, g_cache_pipelines);
+    Free(nullptr, g_saved_permutations);
+    g_saved_permutations = nullptr;
+    g_saved_permutation_count = 0;
     g_cache = {};
     g_window = nullptr;
     g_device = nullptr;
@@ -0,0 +1,265 @@
+//
+//  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
+//
+//  Pixel format conversion kernels shared by texture uploads and the importer.  Destinations are
+//  usually mapped staging memory, so every kernel writes each output byte exactly once and never
+//  reads it back.
+//
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define NOZ_PIXEL_SSE2 1
+#endif
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#include <tmmintrin.h>
+#define NOZ_PIXEL_SSSE3 1
+#endif
+
+#if defined(__F16C__) || defined(__AVX2__)
+#include <immintrin.h>
+#define NOZ_PIXEL_F16C 1
+#endif
+
+float SRGBToLinear(u8 value)
+{
+    float v = value / 255.0f;
+    return v <= 0.04045f ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+}
+
+u8 LinearToSRGB(float value)
+{
+    float v = clamp(value, 0.0f, 1.0f);
+    float srgb = v <= 0.0031308f ? v * 12.92f : 1.055f * powf(v, 1.0f / 2.4f) - 0.055f;
+    return (u8)(srgb * 255.0f + 0.5f);
+}
+
+struct SRGBTables
+{
+    u8 to_linear[256];
+    u8 to_srgb[256];
+
+    SRGBTables()
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            to_linear[i] = (u8)(SRGBToLinear((u8)i) * 255.0f + 0.5f);
+            to_srgb[i] = LinearToSRGB(i / 255.0f);
+        }
+    }
+};
+
+static const SRGBTables& GetSRGBTables()
+{
+    static const SRGBTables tables;
+    return tables;
+}
+
+static void ConvertWithTable(u8* pixels, size_t pixel_count, int channels, const u8* table)
+{
+    // Alpha is always linear
+    int color_channels = channels == 4 ? 3 : channels;
+    for (size_t i = 0; i < pixel_count; i++, pixels += channels)
+        for (int c = 0; c < color_channels; c++)
+            pixels[c] = table[pixels[c]];
+}
+
+void ConvertSRGBToLinear(u8* pixels, size_t pixel_count, int channels)
+{
+    ConvertWithTable(pixels, pixel_count, channels, GetSRGBTables().to_linear);
+}
+
+void ConvertLinearToSRGB(u8* pixels, size_t pixel_count, int channels)
+{
+    ConvertWithTable(pixels, pixel_count, channels, GetSRGBTables().to_srgb);
+}
+
+void ConvertRGBToRGBA(const u8* src, u8* dst, size_t pixel_count)
+{
+    size_t i = 0;
+
+#if NOZ_PIXEL_SSSE3
+    // Each load reads 16 bytes but only consumes 12, stop while the overread is still in bounds
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    for (; i + 6 <= pixel_count; i += 4)
+    {
+        __m128i rgb = _mm_loadu_si128((const __m128i*)(src + i * 3));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+    }
+#endif
+
+    // Four pixels at a time as three 32 bit words, little endian
+    for (; i + 4 <= pixel_count; i += 4)
+    {
+        u32 w[3];
+        memcpy(w, src + i * 3, sizeof(w));
+        u32 p[4];
+        p[0] = (w[0] & 0x00FFFFFF) | 0xFF000000;
+        p[1] = (w[0] >> 24) | ((w[1] & 0x0000FFFF) << 8) | 0xFF000000;
+        p[2] = (w[1] >> 16) | ((w[2] & 0x000000FF) << 16) | 0xFF000000;
+        p[3] = (w[2] >> 8) | 0xFF000000;
+        memcpy(dst + i * 4, p, sizeof(p));
+    }
+
+    for (; i < pixel_count; i++)
+    {
+        dst[i * 4 + 0] = src[i * 3 + 0];
+        dst[i * 4 + 1] = src[i * 3 + 1];
+        dst[i * 4 + 2] = src[i * 3 + 2];
+        dst[i * 4 + 3] = 255;
+    }
+}
+
+void ConvertRGBAToRGB(const u8* src, u8* dst, size_t pixel_count)
+{
+    size_t i = 0;
+    for (; i + 4 <= pixel_count; i += 4)
+    {
+        u32 p[4];
+        memcpy(p, src + i * 4, sizeof(p));
+        u32 w[3];
+        w[0] = (p[0] & 0x00FFFFFF) | (p[1] << 24);
+        w[1] = ((p[1] >> 8) & 0x0000FFFF) | (p[2] << 16);
+        w[2] = ((p[2] >> 16) & 0x000000FF) | (p[3] << 8);
+        memcpy(dst + i * 3, w, sizeof(w));
+    }
+
+    for (; i < pixel_count; i++)
+    {
+        dst[i * 3 + 0] = src[i * 4 + 0];
+        dst[i * 3 + 1] = src[i * 4 + 1];
+        dst[i * 3 + 2] = src[i * 4 + 2];
+    }
+}
+
+// (x * a + 128 + ((x * a + 128) >> 8)) >> 8 is x * a / 255 rounded to nearest
+void PremultiplyAlpha(u8* pixels, size_t pixel_count)
+{
+    size_t i = 0;
+
+#if NOZ_PIXEL_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi16(128);
+    const __m128i alpha_mask = _mm_set1_epi32((int)0xFF000000);
+    for (; i + 4 <= pixel_count; i += 4)
+    {
+        __m128i rgba = _mm_loadu_si128((const __m128i*)(pixels + i * 4));
+        __m128i lo = _mm_unpacklo_epi8(rgba, zero);
+        __m128i hi = _mm_unpackhi_epi8(rgba, zero);
+        __m128i alpha_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xFF), 0xFF);
+        __m128i alpha_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xFF), 0xFF);
+        lo = _mm_add_epi16(_mm_mullo_epi16(lo, alpha_lo), half);
+        hi = _mm_add_epi16(_mm_mullo_epi16(hi, alpha_hi), half);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        __m128i result = _mm_packus_epi16(lo, hi);
+        result = _mm_or_si128(_mm_andnot_si128(alpha_mask, result), _mm_and_si128(alpha_mask, rgba));
+        _mm_storeu_si128((__m128i*)(pixels + i * 4), result);
+    }
+#endif
+
+    for (; i < pixel_count; i++)
+    {
+        u8* p = pixels + i * 4;
+        u32 a = p[3];
+        for (int c = 0; c < 3; c++)
+        {
+            u32 t = p[c] * a + 128;
+            p[c] = (u8)((t + (t >> 8)) >> 8);
+        }
+    }
+}
+
+// Single channel to (r, r, r, 255)
+void ConvertGrayToRGBA(const u8* src, u8* dst, size_t pixel_count)
+{
+    size_t i = 0;
+
+#if NOZ_PIXEL_SSE2
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    for (; i + 16 <= pixel_count; i += 16)
+    {
+        __m128i gray = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i lo = _mm_unpacklo_epi8(gray, gray);
+        __m128i hi = _mm_unpackhi_epi8(gray, gray);
+        _mm_storeu_si128((__m128i*)(dst + i * 4 + 0), _mm_or_si128(_mm_unpacklo_epi16(lo, lo), alpha));
+        _mm_storeu_si128((__m128i*)(dst + i * 4 + 16), _mm_or_si128(_mm_unpackhi_epi16(lo, lo), alpha));
+        _mm_storeu_si128((__m128i*)(dst + i * 4 + 32), _mm_or_si128(_mm_unpacklo_epi16(hi, hi), alpha));
+        _mm_storeu_si128((__m128i*)(dst + i * 4 + 48), _mm_or_si128(_mm_unpackhi_epi16(hi, hi), alpha));
+    }
+#endif
+
+    for (; i < pixel_count; i++)
+    {
+        u32 p = src[i] * 0x00010101u | 0xFF000000;
+        memcpy(dst + i * 4, &p, sizeof(p));
+    }
+}
+
+// Single channel to (255, 255, 255, r), used for coverage masks such as glyphs
+void ConvertAlphaToRGBA(const u8* src, u8* dst, size_t pixel_count)
+{
+    size_t i = 0;
+
+#if NOZ_PIXEL_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i white = _mm_set1_epi32(0x00FFFFFF);
+    for (; i + 16 <= pixel_count; i += 16)
+    {
+        __m128i alpha = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i lo = _mm_unpacklo_epi8(zero, alpha);
+        __m128i hi = _mm_unpackhi_epi8(zero, alpha);
+        _mm_storeu_si128((__m128i*)(dst + i * 4 + 0), _mm_or_si128(_mm_unpacklo_epi16(zero, lo), white));
+        _mm_storeu_si128((__m128i*)(dst + i * 4 + 16), _mm_or_si128(_mm_unpackhi_epi16(zero, lo), white));
+        _mm_storeu_si128((__m128i*)(dst + i * 4 + 32), _mm_or_si128(_mm_unpacklo_epi16(zero, hi), white));
+        _mm_storeu_si128((__m128i*)(dst + i * 4 + 48), _mm_or_si128(_mm_unpackhi_epi16(zero, hi), white));
+    }
+#endif
+
+    for (; i < pixel_count; i++)
+    {
+        u32 p = ((u32)src[i] << 24) | 0x00FFFFFF;
+        memcpy(dst + i * 4, &p, sizeof(p));
+    }
+}
+
+// Round to nearest even, overflow goes to infinity and NaN stays NaN
+static u16 FloatToHalf(float value)
+{
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    u32 sign = (bits >> 16) & 0x8000;
+    u32 magnitude = bits & 0x7FFFFFFF;
+
+    if (magnitude >= 0x7F800000)
+        return (u16)(sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x0200 : 0));
+
+    if (magnitude >= 0x477FF000)
+        return (u16)(sign | 0x7C00);
+
+    // Subnormal halves are multiples of 2^-24
+    if (magnitude < 0x38800000)
+    {
+        float f;
+        memcpy(&f, &magnitude, sizeof(f));
+        return (u16)(sign | (u32)lrintf(f * 16777216.0f));
+    }
+
+    magnitude -= 112u << 23;
+    magnitude += 0x0FFF + ((magnitude >> 13) & 1);
+    return (u16)(sign | (magnitude >> 13));
+}
+
+void ConvertFloatToHalf(const float* src, u16* dst, size_t count)
+{
+    size_t i = 0;
+
+#if NOZ_PIXEL_F16C
+    for (; i + 4 <= count; i += 4)
+        _mm_storel_epi64((__m128i*)(dst + i), _mm_cvtps_ph(_mm_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+
+    for (; i < count; i++)
+        dst[i] = FloatToHalf(src[i]);
+}
@@ -2,15 +2,11 @@
 //  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
 //
 
-// todo: we can build a single bone buffer to upload and just add bone_offset to the model buffer for each mesh
-
 enum RenderCommandType
 {
     command_type_bind_material,
     command_type_bind_light,
-    command_type_bind_transform,
     command_type_bind_camera,
-    command_type_bind_bones,
     command_type_bind_default_texture,
     command_type_bind_color,
     command_type_set_viewport,
@@ -27,11 +23,6 @@ struct BindMaterialData
     Material* material;
 };
 
-struct BindTransformData
-{
-    mat4 transform;
-};
-
 struct BindCameraData
 {
     mat4 view;
@@ -40,12 +31,6 @@ struct BindCameraData
     mat4 light_view_projection;
 };
 
-struct BindBonesData
-{
-    size_t count;
-    size_t offset;
-};
-
 struct BindLightData
 {
     vec3 ambient_color;
@@ -71,9 +56,41 @@ struct BindColorData
     color_t color;
 };
 
+struct RenderCamera
+{
+    mat4 view_projection;
+    Frustum frustum;
+    float lod_scale;
+    bool has_occluders;
+};
+
+struct DrawCull
+{
+    bounds3 bounds;
+    RenderCamera* camera;
+    bool visible;
+};
+
+struct OccluderData
+{
+    Mesh* mesh;
+    mat4 transform;
+    RenderCamera* camera;
+};
+
+// Clustered meshes carry one cull record per cluster, stored contiguously.  Unclustered draws
+// carry a single cull record and the index range of the selected level of detail.  The material
+// is only set on draws that request texture detail once they survived culling.
 struct DrawMeshData
 {
     Mesh* mesh;
+    Material* material;
+    float screen_pixels;
+    u32 draw_index;
+    u32 first_index;
+    u32 index_count;
+    u32 cull_count;
+    DrawCull* cull;
 };
 
 struct BeginPassData
@@ -95,10 +112,8 @@ struct RenderCommand
     union 
     {
         BindMaterialData bind_material;
-        BindTransformData bind_transform;
         BindCameraData bind_camera;
         BindLightData bind_light;
-        BindBonesData bind_bones;
         BindColorData bind_color;
         BindDefaultTextureData bind_default_texture;
         SetViewportData set_viewport;
@@ -108,40 +123,230 @@ struct RenderCommand
     } data;
 };
 
+// Per draw instance data read by the vertex shader through the instance rate vertex buffer
+// in slot 1.  The transform index and bone offset index into the frame transform buffer, the
+// vertex format and position decode undo the mesh vertex encoding.
+struct DrawInstance
+{
+    u32 transform_index;
+    u32 bone_offset;
+    u32 vertex_format;
+    u32 padding;
+    vec4 position_scale;
+    vec4 position_offset;
+};
+
+// Commands, transforms and draws are stored in chains of chunks allocated from the frame
+// arena so the buffer can grow during a frame without reallocating or moving anything.
+struct RenderChunk
+{
+    RenderChunk* next;
+    size_t count;
+    size_t capacity;
+};
+
+struct RenderChunkList
+{
+    RenderChunk* first;
+    RenderChunk* last;
+    size_t count;
+    size_t element_size;
+    size_t chunk_capacity;
+};
+
 struct RenderBuffer
 {
-    RenderCommand* commands;
-    size_t command_count;
-    mat4* transforms;
-    size_t transform_count;
-    size_t command_count_max;
-    size_t transform_count_max;
+    Allocator* arena;
+    RenderChunkList commands;
+    RenderChunkList transforms;
+    RenderChunkList draws;
+    RenderChunkList culls;
+    RenderChunkList cameras;
+    RenderChunkList occluders;
+    RenderBufferStats stats;
+    size_t chunk_count;
+    size_t memory_used;
+    size_t dropped_command_count;
+    size_t tested_draw_count;
+    size_t culled_draw_count;
+    size_t occluded_draw_count;
+    size_t triangle_count;
+    size_t lod_saved_triangle_count;
+    mat4 transform;
+    RenderCamera* camera;
+    Material* material;
+    u32 transform_index;
+    u32 bone_offset;
+    bool is_skinned;
     bool is_shadow_pass;
     bool is_full;
+
+    // gpu
+    SDL_GPUDevice* device;
+    SDL_GPUBuffer* transform_buffer;
+    SDL_GPUBuffer* draw_buffer;
+    SDL_GPUTransferBuffer* transfer_buffer;
+    size_t gpu_transform_capacity;
+    size_t gpu_draw_capacity;
 };
 
+#define CAMERA_CHUNK_SIZE 16
+#define OCCLUDER_CHUNK_SIZE 64
+#define CULL_BATCH_SIZE 64
+
 static RenderBuffer* g_render_buffer = nullptr;
 
+static void* GetChunkData(RenderChunk* chunk)
+{
+    return chunk + 1;
+}
+
+static void InitChunkList(RenderChunkList& list, size_t element_size, size_t chunk_capacity)
+{
+    list = {};
+    list.element_size = element_size;
+    list.chunk_capacity = chunk_capacity;
+}
+
+static void ResetChunkList(RenderChunkList& list)
+{
+    list.first = nullptr;
+    list.last = nullptr;
+    list.count = 0;
+}
+
+// Reserve count contiguous elements at the end of the list, chaining a new chunk from the
+// frame arena when the last one is full.  Returns nullptr when the arena is exhausted.
+static void* AppendChunkList(RenderChunkList& list, size_t count)
+{
+    RenderChunk* chunk = list.last;
+    if (!chunk || chunk->count + count > chunk->capacity)
+    {
+        size_t capacity = max(list.chunk_capacity, count);
+        size_t chunk_size = sizeof(RenderChunk) + capacity * list.element_size;
+        chunk = (RenderChunk*)Alloc(g_render_buffer->arena, chunk_size);
+        if (!chunk)
+            return nullptr;
+
+        chunk->next = nullptr;
+        chunk->count = 0;
+        chunk->capacity = capacity;
+
+        if (list.last)
+            list.last->next = chunk;
+        else
+            list.first = chunk;
+
+        list.last = chunk;
+        g_render_buffer->chunk_count++;
+        g_render_buffer->memory_used += chunk_size;
+    }
+
+    void* data = (u8*)GetChunkData(chunk) + chunk->count * list.element_size;
+    chunk->count += count;
+    list.count += count;
+    return data;
+}
+
+// Copy every element of the list into a contiguous destination
+static void CopyChunkList(const RenderChunkList& list, void* dst)
+{
+    u8* write = (u8*)dst;
+    for (RenderChunk* chunk = list.first; chunk; chunk = chunk->next)
+    {
+        size_t size = chunk->count * list.element_size;
+        memcpy(write, GetChunkData(chunk), size);
+        write += size;
+    }
+}
+
+static u32 AddTransforms(const mat4* transforms, size_t count)
+{
+    if (g_render_buffer->is_full)
+        return UINT32_MAX;
+
+    auto index = (u32)g_render_buffer->transforms.count;
+    auto dst = (mat4*)AppendChunkList(g_render_buffer->transforms, count);
+    if (!dst)
+    {
+        g_render_buffer->is_full = true;
+        return UINT32_MAX;
+    }
+
+    memcpy(dst, transforms, count * sizeof(mat4));
+    return index;
+}
+
 static void AddRenderCommand(RenderCommand* cmd)
 {
     // don't add the command if we are full
     if (g_render_buffer->is_full)
+    {
+        g_render_buffer->dropped_command_count++;
+        return;
+    }
+
+    auto dst = (RenderCommand*)AppendChunkList(g_render_buffer->commands, 1);
+    if (!dst)
+    {
+        g_render_buffer->is_full = true;
+        g_render_buffer->dropped_command_count++;
         return;
+    }
 
-    g_render_buffer->commands[g_render_buffer->command_count++] = *cmd;
-    g_render_buffer->is_full = g_render_buffer->command_count == g_render_buffer->command_count_max;
+    *dst = *cmd;
 }
 
 void ClearRenderCommands()
 {
-    g_render_buffer->command_count = 0;
-    g_render_buffer->transform_count = 0;
+    // record the stats of the frame that just finished before resetting
+    RenderBufferStats& stats = g_render_buffer->stats;
+    stats.command_count = g_render_buffer->commands.count;
+    stats.transform_count = g_render_buffer->transforms.count;
+    stats.draw_count = g_render_buffer->draws.count;
+    stats.chunk_count = g_render_buffer->chunk_count;
+    stats.memory_used = g_render_buffer->memory_used;
+    stats.dropped_command_count = g_render_buffer->dropped_command_count;
+    stats.tested_draw_count = g_render_buffer->tested_draw_count;
+    stats.culled_draw_count = g_render_buffer->culled_draw_count;
+    stats.occluded_draw_count = g_render_buffer->occluded_draw_count;
+    stats.triangle_count = g_render_buffer->triangle_count;
+    stats.lod_saved_triangle_count = g_render_buffer->lod_saved_triangle_count;
+    stats.peak_command_count = max(stats.peak_command_count, stats.command_count);
+    stats.peak_transform_count = max(stats.peak_transform_count, stats.transform_count);
+
+    Clear(g_render_buffer->arena);
+    ResetChunkList(g_render_buffer->commands);
+    ResetChunkList(g_render_buffer->transforms);
+    ResetChunkList(g_render_buffer->draws);
+    ResetChunkList(g_render_buffer->culls);
+    ResetChunkList(g_render_buffer->cameras);
+    ResetChunkList(g_render_buffer->occluders);
+    g_render_buffer->chunk_count = 0;
+    g_render_buffer->memory_used = 0;
+    g_render_buffer->dropped_command_count = 0;
+    g_render_buffer->tested_draw_count = 0;
+    g_render_buffer->culled_draw_count = 0;
+    g_render_buffer->occluded_draw_count = 0;
+    g_render_buffer->triangle_count = 0;
+    g_render_buffer->lod_saved_triangle_count = 0;
+    g_render_buffer->transform = glm::identity<mat4>();
+    g_render_buffer->camera = nullptr;
+    g_render_buffer->material = nullptr;
+    g_render_buffer->transform_index = 0;
+    g_render_buffer->bone_offset = 0;
+    g_render_buffer->is_skinned = false;
     g_render_buffer->is_shadow_pass = false;
     g_render_buffer->is_full = false;
     
     // add identity transform by default for all meshes with no bones
-    g_render_buffer->transforms[0] = identity<mat4>();
-    g_render_buffer->transform_count = 1;
+    mat4 identity = glm::identity<mat4>();
+    AddTransforms(&identity, 1);
+}
+
+RenderBufferStats GetRenderBufferStats()
+{
+    return g_render_buffer->stats;
 }
 
 void BeginRenderPass(bool clear, color_t clear_color, bool msaa, Texture* target)
@@ -194,6 +399,18 @@ void BindCamera(Camera* camera)
 void BindCamera(const mat4& view, const mat4& projection)
 {
     mat4 view_projection = projection * view;
+
+    // draws recorded after this are culled against the camera
+    auto camera = (RenderCamera*)AppendChunkList(g_render_buffer->cameras, 1);
+    if (camera)
+    {
+        camera->view_projection = view_projection;
+        camera->frustum = ToFrustum(view_projection);
+        camera->lod_scale = projection[1][1];
+        camera->has_occluders = false;
+    }
+    g_render_buffer->camera = camera;
+
     RenderCommand cmd = {
         .type = command_type_bind_camera,
         .data = {
@@ -209,6 +426,8 @@ void BindMaterial(Material* material)
 {
     assert(material);
 
+    g_render_buffer->material = material;
+
     RenderCommand cmd = {
         .type = command_type_bind_material,
         .data = {
@@ -220,12 +439,15 @@ void BindMaterial(Material* material)
 
 void BindTransform(const mat4& transform)
 {
-    RenderCommand cmd = {
-        .type = command_type_bind_transform,
-        .data = {
-            .bind_transform = {
-                .transform = transform}} };
-    AddRenderCommand(&cmd);
+    auto index = AddTransforms(&transform, 1);
+    if (index == UINT32_MAX)
+        return;
+
+    // Bones belong to the transform they were bound with
+    g_render_buffer->transform_index = index;
+    g_render_buffer->transform = transform;
+    g_render_buffer->bone_offset = 0;
+    g_render_buffer->is_skinned = false;
 }
 
 void BindBoneTransforms(const mat4* bones, size_t bone_count)
@@ -233,26 +455,18 @@ void BindBoneTransforms(const mat4* bones, size_t bone_count)
     if (bone_count == 0)
         return;
 
-    if (g_render_buffer->command_count + bone_count > g_render_buffer->transform_count_max)
-    {
-        g_render_buffer->is_full = true;
+    auto offset = AddTransforms(bones, bone_count);
+    if (offset == UINT32_MAX)
         return;
-    }   
-
-    RenderCommand cmd = {
-        .type = command_type_bind_bones,
-        .data = {
-            .bind_bones = {
-                .count = bone_count,
-                .offset = g_render_buffer->transform_count}} };
 
-    memcpy(
-        g_render_buffer->transforms + g_render_buffer->transform_count,
-        bones,
-        bone_count * sizeof(mat4));
-    g_render_buffer->transform_count += bone_count;
+    g_render_buffer->bone_offset = offset;
+    g_render_buffer->is_skinned = true;
+}
 
-    AddRenderCommand(&cmd);
+void UnbindBoneTransforms()
+{
+    g_render_buffer->bone_offset = 0;
+    g_render_buffer->is_skinned = false;
 }
 
 void BindColor(color_t color)
@@ -265,104 +479,520 @@ void BindColor(color_t color)
     AddRenderCommand(&cmd);
 }
 
+// Height of the bounds on screen as a fraction of the viewport height.  lod_scale is the
+// projection y scale so this works for perspective and orthographic cameras alike.
+static float GetProjectedSize(RenderCamera* camera, const bounds3& bounds)
+{
+    vec3 center = (bounds.min + bounds.max) * 0.5f;
+    float radius = length(bounds.max - bounds.min) * 0.5f;
+    float w = (camera->view_projection * vec4(center, 1.0f)).w;
+    if (w <= 0.0f)
+        return FLT_MAX;
+
+    return radius * camera->lod_scale / w;
+}
+
 void DrawMesh(Mesh* mesh)
 {
     assert(mesh);
+
+    if (g_render_buffer->is_full)
+    {
+        g_render_buffer->dropped_command_count++;
+        return;
+    }
+
+    // transform and bones are resolved now so the draw only carries an index into the frame buffers
+    auto draw_index = (u32)g_render_buffer->draws.count;
+    auto draw = (DrawInstance*)AppendChunkList(g_render_buffer->draws, 1);
+    if (!draw)
+    {
+        g_render_buffer->is_full = true;
+        g_render_buffer->dropped_command_count++;
+        return;
+    }
+
+    *draw = {
+        .transform_index = g_render_buffer->transform_index,
+        .bone_offset = g_render_buffer->bone_offset,
+        .vertex_format = (u32)GetVertexFormat(mesh) };
+    GetPositionDecode(mesh, &draw->position_scale, &draw->position_offset);
+
+    // Skinned draws move vertices outside the bind pose bounds so they are never culled and
+    // always drawn at full detail
+    RenderCamera* camera = g_render_buffer->is_skinned ? nullptr : g_render_buffer->camera;
+    bounds3 bounds = camera ? transform(GetBounds(mesh), g_render_buffer->transform) : bounds3{};
+    float projected_size = camera ? GetProjectedSize(camera, bounds) : FLT_MAX;
+    size_t lod = camera ? SelectLod(mesh, projected_size) : 0;
+    const MeshLod* lods = GetLods(mesh);
+    g_render_buffer->triangle_count += lods[lod].index_count / 3;
+    g_render_buffer->lod_saved_triangle_count += (lods[0].index_count - lods[lod].index_count) / 3;
+
+    // Shadow draws don't sample the material textures and draws without a camera have no size
+    // on screen, so neither requests texture detail.  Skinned draws use their bind pose size.
+    RenderCamera* detail_camera = g_render_buffer->is_shadow_pass ? nullptr : g_render_buffer->camera;
+    Material* detail_material = detail_camera ? g_render_buffer->material : nullptr;
+    float screen_pixels = 0.0f;
+    if (detail_material)
+    {
+        float detail_size = camera
+            ? projected_size
+            : GetProjectedSize(detail_camera, transform(GetBounds(mesh), g_render_buffer->transform));
+        screen_pixels = detail_size == FLT_MAX ? FLT_MAX : detail_size * (float)GetScreenSize().y;
+    }
+
+    // Clusters only cover the full detail level
+    size_t cluster_count = camera && lod == 0 ? GetClusterCount(mesh) : 0;
+    auto cull = (DrawCull*)AppendChunkList(g_render_buffer->culls, max(cluster_count, (size_t)1));
+    if (!cull)
+    {
+        g_render_buffer->is_full = true;
+        g_render_buffer->dropped_command_count++;
+        return;
+    }
+
+    if (cluster_count > 0)
+    {
+        const MeshCluster* clusters = GetClusters(mesh);
+        for (size_t i = 0; i < cluster_count; i++)
+        {
+            cull[i].visible = true;
+            cull[i].camera = camera;
+            cull[i].bounds = transform(clusters[i].bounds, g_render_buffer->transform);
+        }
+    }
+    else
+    {
+        cull->visible = true;
+        cull->camera = camera;
+        cull->bounds = bounds;
+    }
+
     RenderCommand cmd = {
         .type = command_type_draw_mesh,
         .data = {
             .draw_mesh = {
-                .mesh = mesh}} };
+                .mesh = mesh,
+                .material = detail_material,
+                .screen_pixels = screen_pixels,
+                .draw_index = draw_index,
+                .first_index = lods[lod].index_offset,
+                .index_count = lods[lod].index_count,
+                .cull_count = (u32)max(cluster_count, (size_t)1),
+                .cull = cull}} };
     AddRenderCommand(&cmd);
 }
 
-void ExecuteRenderCommands(SDL_GPUCommandBuffer* cb)
+void DrawOccluder(Mesh* mesh)
 {
-    SDL_GPURenderPass* pass = nullptr;
+    assert(mesh);
+
+    if (!IsOcclusionEnabled() || !g_render_buffer->camera || g_render_buffer->is_full)
+        return;
 
-    RenderCommand* commands = g_render_buffer->commands;
-    size_t command_count = g_render_buffer->command_count;
-    for (size_t command_index=0; command_index < command_count; ++command_index)
+    // Occluders are rasterized from the CPU copy
+    if (!GetVertices(mesh))
+        return;
+
+    auto occluder = (OccluderData*)AppendChunkList(g_render_buffer->occluders, 1);
+    if (!occluder)
     {
-        RenderCommand* command = commands + command_index;
-        switch (command->type)
+        g_render_buffer->is_full = true;
+        return;
+    }
+
+    occluder->mesh = mesh;
+    occluder->transform = g_render_buffer->transform;
+    occluder->camera = g_render_buffer->camera;
+    occluder->camera->has_occluders = true;
+}
+
+struct CullBatch
+{
+    DrawCull* draws[CULL_BATCH_SIZE];
+    bounds3 bounds[CULL_BATCH_SIZE];
+    bool visible[CULL_BATCH_SIZE];
+    size_t count;
+};
+
+static void AddCullBatch(CullBatch& batch, DrawCull* cull)
+{
+    batch.draws[batch.count] = cull;
+    batch.bounds[batch.count] = cull->bounds;
+    batch.count++;
+}
+
+static void FlushFrustumBatch(CullBatch& batch, const RenderCamera* camera)
+{
+    if (batch.count == 0)
+        return;
+
+    size_t visible_count = CullBounds(camera->frustum, batch.bounds, batch.count, batch.visible);
+    for (size_t i = 0; i < batch.count; i++)
+        batch.draws[i]->visible = batch.visible[i];
+
+    g_render_buffer->tested_draw_count += batch.count;
+    g_render_buffer->culled_draw_count += batch.count - visible_count;
+    batch.count = 0;
+}
+
+static void FlushOcclusionBatch(CullBatch& batch)
+{
+    if (batch.count == 0)
+        return;
+
+    size_t visible_count = CullOcclusion(batch.bounds, batch.count, batch.visible);
+    for (size_t i = 0; i < batch.count; i++)
+        batch.draws[i]->visible = batch.visible[i];
+
+    g_render_buffer->occluded_draw_count += batch.count - visible_count;
+    batch.count = 0;
+}
+
+static void CullFrustum()
+{
+    CullBatch batch;
+    batch.count = 0;
+    RenderCamera* batch_camera = nullptr;
+
+    // Gather runs of draws that share a camera into batches for the wide box test
+    for (RenderChunk* chunk = g_render_buffer->culls.first; chunk; chunk = chunk->next)
+    {
+        auto culls = (DrawCull*)GetChunkData(chunk);
+        for (size_t cull_index = 0; cull_index < chunk->count; cull_index++)
         {
-        case command_type_bind_material:
-            BindMaterialGPU(command->data.bind_material.material, cb);
-            break;
+            DrawCull* cull = culls + cull_index;
+            if (!cull->camera)
+                continue;
 
-        case command_type_bind_transform:
-            SDL_PushGPUVertexUniformData(cb, vertex_register_object, &command->data, sizeof(BindTransformData));
-            break;
+            if (cull->camera != batch_camera || batch.count == CULL_BATCH_SIZE)
+            {
+                FlushFrustumBatch(batch, batch_camera);
+                batch_camera = cull->camera;
+            }
 
-        case command_type_bind_camera:
+            AddCullBatch(batch, cull);
+        }
+    }
+
+    FlushFrustumBatch(batch, batch_camera);
+}
+
+static void CullOccluded(RenderCamera* camera)
+{
+    ClearOcclusion(camera->view_projection);
+
+    for (RenderChunk* chunk = g_render_buffer->occluders.first; chunk; chunk = chunk->next)
+    {
+        auto occluders = (OccluderData*)GetChunkData(chunk);
+        for (size_t occluder_index = 0; occluder_index < chunk->count; occluder_index++)
         {
-            SDL_PushGPUVertexUniformData(cb, vertex_register_camera, &command->data, sizeof(BindCameraData));
+            OccluderData* occluder = occluders + occluder_index;
+            if (occluder->camera != camera)
+                continue;
+
+            RasterizeOccluder(
+                GetVertices(occluder->mesh),
+                GetVertexCount(occluder->mesh),
+                GetIndices(occluder->mesh),
+                GetIndexSize(occluder->mesh),
+                GetLods(occluder->mesh)->index_count,
+                occluder->transform);
+        }
+    }
 
-            // Store for legacy compatibility (still needed by bindTransform for ObjectBuffer)
-            //_view = data.view;
-            //_view_projection = data.view_projection;
+    BuildOcclusionHiZ();
 
-            // if (_shadowPassActive)
-            //     _lightViewProjectionMatrix = _view_projection;
+    // Only draws that survived the frustum test need to be tested against the depth
+    CullBatch batch;
+    batch.count = 0;
+    for (RenderChunk* chunk = g_render_buffer->culls.first; chunk; chunk = chunk->next)
+    {
+        auto culls = (DrawCull*)GetChunkData(chunk);
+        for (size_t cull_index = 0; cull_index < chunk->count; cull_index++)
+        {
+            DrawCull* cull = culls + cull_index;
+            if (cull->camera != camera || !cull->visible)
+                continue;
 
-            break;
+            if (batch.count == CULL_BATCH_SIZE)
+                FlushOcclusionBatch(batch);
+
+            AddCullBatch(batch, cull);
         }
+    }
 
-        case command_type_bind_bones:
-            SDL_PushGPUVertexUniformData(
-                cb,
-                vertex_register_bone,
-                g_render_buffer->transforms + command->data.bind_bones.offset,
-                (Uint32)command->data.bind_bones.count);
-            break;
-
-        case command_type_bind_light:
-            SDL_PushGPUFragmentUniformData(cb, fragment_register_light, &command->data, sizeof(BindLightData));
-            break;
-
-        case command_type_bind_color:
-            SDL_PushGPUFragmentUniformData(cb, fragment_register_color, &command->data, sizeof(BindColorData));
-            break;
-
-        case command_type_draw_mesh:
-            DrawMeshGPU(command->data.draw_mesh.mesh, pass);
-            break;
-
-        case command_type_begin_pass:
-            pass = BeginPassGPU(
-                command->data.begin_pass.clear,
-                command->data.begin_pass.color,
-                command->data.begin_pass.msaa,
-                command->data.begin_pass.target);
-            break;
-
-        case command_type_bind_default_texture:
-            BindDefaultTextureGPU(command->data.bind_default_texture.index);
-            break;
-
-        case command_type_begin_gamma_pass:
-            pass = BeginGammaPassGPU();
-            break;
-
-        case command_type_end_pass:
-            EndRenderPassGPU();
-            pass = nullptr;
-            break;
-
-        case command_type_begin_shadow_pass:
-            pass = BeginShadowPassGPU();
-            break;
-
-        case command_type_set_viewport:
+    FlushOcclusionBatch(batch);
+}
+
+// Only draws that survived culling pull their textures in, the streamer picks the requests up
+// at the start of the next frame
+static void RequestVisibleDetail()
+{
+    for (RenderChunk* chunk = g_render_buffer->commands.first; chunk; chunk = chunk->next)
+    {
+        auto commands = (RenderCommand*)GetChunkData(chunk);
+        for (size_t command_index = 0; command_index < chunk->count; command_index++)
         {
-            SDL_SetGPUViewport(pass, &command->data.set_viewport.gpu_viewport);
-            break;
+            RenderCommand* command = commands + command_index;
+            if (command->type != command_type_draw_mesh || !command->data.draw_mesh.material)
+                continue;
+
+            const DrawMeshData& draw = command->data.draw_mesh;
+            for (u32 i = 0; i < draw.cull_count; i++)
+            {
+                if (!draw.cull[i].visible)
+                    continue;
+
+                RequestMaterialDetail(draw.material, draw.screen_pixels);
+                break;
+            }
         }
+    }
+}
+
+void CullRenderCommands()
+{
+    CullFrustum();
 
-        case command_type_set_scissor:
-            SDL_SetGPUScissor(pass, &command->data.set_scissor.rect);
-            break;
+    if (g_render_buffer->occluders.count > 0)
+    {
+        for (RenderChunk* chunk = g_render_buffer->cameras.first; chunk; chunk = chunk->next)
+        {
+            auto cameras = (RenderCamera*)GetChunkData(chunk);
+            for (size_t camera_index = 0; camera_index < chunk->count; camera_index++)
+                if (cameras[camera_index].has_occluders)
+                    CullOccluded(cameras + camera_index);
+        }
+    }
+
+    RequestVisibleDetail();
+}
+
+static SDL_GPUBuffer* CreateGPUBuffer(SDL_GPUBufferUsageFlags usage, size_t size, const char* name)
+{
+    SDL_GPUBufferCreateInfo info = {};
+    info.usage = usage;
+    info.size = (u32)size;
+    info.props = SDL_CreateProperties();
+    SDL_SetStringProperty(info.props, SDL_PROP_GPU_BUFFER_CREATE_NAME_STRING, name);
+    SDL_GPUBuffer* buffer = SDL_CreateGPUBuffer(g_render_buffer->device, &info);
+    SDL_DestroyProperties(info.props);
+
+    if (!buffer)
+        Exit(SDL_GetError());
+
+    return buffer;
+}
+
+// Grow the gpu side buffers to hold at least the given number of transforms and draws.  Old
+// buffers are released immediately, SDL defers the destroy until frames in flight are done.
+static void ReserveGPUBuffers(size_t transform_count, size_t draw_count)
+{
+    if (transform_count <= g_render_buffer->gpu_transform_capacity &&
+        draw_count <= g_render_buffer->gpu_draw_capacity)
+        return;
+
+    SDL_GPUDevice* device = g_render_buffer->device;
+
+    if (transform_count > g_render_buffer->gpu_transform_capacity)
+    {
+        if (g_render_buffer->transform_buffer)
+            SDL_ReleaseGPUBuffer(device, g_render_buffer->transform_buffer);
+
+        g_render_buffer->gpu_transform_capacity = noz::NextPowerOf2(transform_count);
+        g_render_buffer->transform_buffer = CreateGPUBuffer(
+            SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ,
+            g_render_buffer->gpu_transform_capacity * sizeof(mat4),
+            "transforms");
+    }
+
+    if (draw_count > g_render_buffer->gpu_draw_capacity)
+    {
+        if (g_render_buffer->draw_buffer)
+            SDL_ReleaseGPUBuffer(device, g_render_buffer->draw_buffer);
+
+        g_render_buffer->gpu_draw_capacity = noz::NextPowerOf2(draw_count);
+        g_render_buffer->draw_buffer = CreateGPUBuffer(
+            SDL_GPU_BUFFERUSAGE_VERTEX,
+            g_render_buffer->gpu_draw_capacity * sizeof(DrawInstance),
+            "draws");
+    }
+
+    if (g_render_buffer->transfer_buffer)
+        SDL_ReleaseGPUTransferBuffer(device, g_render_buffer->transfer_buffer);
+
+    SDL_GPUTransferBufferCreateInfo transfer_info = {};
+    transfer_info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+    transfer_info.size = (u32)(
+        g_render_buffer->gpu_transform_capacity * sizeof(mat4) +
+        g_render_buffer->gpu_draw_capacity * sizeof(DrawInstance));
+    g_render_buffer->transfer_buffer = SDL_CreateGPUTransferBuffer(device, &transfer_info);
+
+    if (!g_render_buffer->transfer_buffer)
+        Exit(SDL_GetError());
+}
+
+void UploadRenderBufferGPU(SDL_GPUCommandBuffer* cb)
+{
+    if (g_render_buffer->draws.count == 0)
+        return;
+
+    ReserveGPUBuffers(g_render_buffer->transforms.count, g_render_buffer->draws.count);
+
+    u32 transforms_size = (u32)(g_render_buffer->transforms.count * sizeof(mat4));
+    u32 draws_size = (u32)(g_render_buffer->draws.count * sizeof(DrawInstance));
+    u32 draws_offset = (u32)(g_render_buffer->gpu_transform_capacity * sizeof(mat4));
+
+    // cycle the transfer buffer so we never write over data a frame in flight is still reading
+    auto mapped = (u8*)SDL_MapGPUTransferBuffer(g_render_buffer->device, g_render_buffer->transfer_buffer, true);
+    if (!mapped)
+        return;
+
+    CopyChunkList(g_render_buffer->transforms, mapped);
+    CopyChunkList(g_render_buffer->draws, mapped + draws_offset);
+    SDL_UnmapGPUTransferBuffer(g_render_buffer->device, g_render_buffer->transfer_buffer);
+
+    SDL_GPUCopyPass* copy_pass = SDL_BeginGPUCopyPass(cb);
+    SDL_GPUTransferBufferLocation transform_source = {g_render_buffer->transfer_buffer, 0};
+    SDL_GPUBufferRegion transform_dest = {g_render_buffer->transform_buffer, 0, transforms_size};
+    SDL_UploadToGPUBuffer(copy_pass, &transform_source, &transform_dest, true);
+
+    SDL_GPUTransferBufferLocation draw_source = {g_render_buffer->transfer_buffer, draws_offset};
+    SDL_GPUBufferRegion draw_dest = {g_render_buffer->draw_buffer, 0, draws_size};
+    SDL_UploadToGPUBuffer(copy_pass, &draw_source, &draw_dest, true);
+    SDL_EndGPUCopyPass(copy_pass);
+}
+
+static void BindRenderBufferGPU(SDL_GPURenderPass* pass)
+{
+    if (!pass)
+        return;
+
+    SDL_BindGPUVertexStorageBuffers(pass, 0, &g_render_buffer->transform_buffer, 1);
+
+    SDL_GPUBufferBinding draw_binding = {g_render_buffer->draw_buffer, 0};
+    SDL_BindGPUVertexBuffers(pass, 1, &draw_binding, 1);
+
+    // All meshes share the heap buffers so they are bound once per pass
+    BindMeshHeapGPU(pass);
+}
+
+static void DrawMeshCommandGPU(const DrawMeshData& draw, SDL_GPURenderPass* pass)
+{
+    if (draw.cull_count == 1)
+    {
+        if (draw.cull->visible)
+            DrawMeshGPU(draw.mesh, pass, draw.draw_index, draw.first_index, draw.index_count);
+        return;
+    }
+
+    // Runs of visible clusters that are adjacent in the index buffer go out as a single draw
+    const MeshCluster* clusters = GetClusters(draw.mesh);
+    u32 first_index = 0;
+    u32 index_count = 0;
+    for (u32 i = 0; i < draw.cull_count; i++)
+    {
+        if (!draw.cull[i].visible)
+            continue;
+
+        const MeshCluster& cluster = clusters[i];
+        if (index_count > 0 && first_index + index_count == cluster.index_offset)
+        {
+            index_count += cluster.index_count;
+            continue;
+        }
+
+        if (index_count > 0)
+            DrawMeshGPU(draw.mesh, pass, draw.draw_index, first_index, index_count);
+
+        first_index = cluster.index_offset;
+        index_count = cluster.index_count;
+    }
+
+    if (index_count > 0)
+        DrawMeshGPU(draw.mesh, pass, draw.draw_index, first_index, index_count);
+}
+
+void ExecuteRenderCommands(SDL_GPUCommandBuffer* cb)
+{
+    SDL_GPURenderPass* pass = nullptr;
+
+    for (RenderChunk* chunk = g_render_buffer->commands.first; chunk; chunk = chunk->next)
+    {
+        for (size_t command_index=0; command_index < chunk->count; ++command_index)
+        {
+            RenderCommand* command = (RenderCommand*)GetChunkData(chunk) + command_index;
+            switch (command->type)
+            {
+            case command_type_bind_material:
+                BindMaterialGPU(command->data.bind_material.material, cb);
+                break;
+
+            case command_type_bind_camera:
+            {
+                SDL_PushGPUVertexUniformData(cb, vertex_register_camera, &command->data, sizeof(BindCameraData));
+
+                // Store for legacy compatibility (still needed by bindTransform for ObjectBuffer)
+                //_view = data.view;
+                //_view_projection = data.view_projection;
+
+                // if (_shadowPassActive)
+                //     _lightViewProjectionMatrix = _view_projection;
+
+                break;
+            }
+
+            case command_type_bind_light:
+                SDL_PushGPUFragmentUniformData(cb, fragment_register_light, &command->data, sizeof(BindLightData));
+                break;
+
+            case command_type_bind_color:
+                SDL_PushGPUFragmentUniformData(cb, fragment_register_color, &command->data, sizeof(BindColorData));
+                break;
+
+            case command_type_draw_mesh:
+                DrawMeshCommandGPU(command->data.draw_mesh, pass);
+                break;
+
+            case command_type_begin_pass:
+                pass = BeginPassGPU(
+                    command->data.begin_pass.clear,
+                    command->data.begin_pass.color,
+                    command->data.begin_pass.msaa,
+                    command->data.begin_pass.target);
+                BindRenderBufferGPU(pass);
+                break;
+
+            case command_type_bind_default_texture:
+                BindDefaultTextureGPU(command->data.bind_default_texture.index);
+                break;
+
+            case command_type_begin_gamma_pass:
+                pass = BeginGammaPassGPU();
+                BindRenderBufferGPU(pass);
+                break;
+
+            case command_type_end_pass:
+                EndRenderPassGPU();
+                pass = nullptr;
+                break;
+
+            case command_type_begin_shadow_pass:
+                pass = BeginShadowPassGPU();
+                BindRenderBufferGPU(pass);
+                break;
+
+            case command_type_set_viewport:
+            {
+                SDL_SetGPUViewport(pass, &command->data.set_viewport.gpu_viewport);
+                break;
+            }
+
+            case command_type_set_scissor:
+                SDL_SetGPUScissor(pass, &command->data.set_scissor.rect);
+                break;
+            }
         }
     }
 }
@@ -410,29 +1040,41 @@ void ExecuteRenderCommands(SDL_GPUCommandBuffer* cb)
 
 #endif
 
-void InitRenderBuffer(RendererTraits* traits)
+void InitRenderBuffer(RendererTraits* traits, SDL_GPUDevice* device)
 {
-    size_t commands_size = traits->max_frame_commands * sizeof(RenderCommand);
-    size_t transforms_size = traits->max_frame_transforms * sizeof(mat4);
-    size_t buffer_size = sizeof(RenderBuffer) + commands_size + transforms_size;
-    
-    g_render_buffer = (RenderBuffer*)malloc(buffer_size);
+    g_render_buffer = (RenderBuffer*)calloc(1, sizeof(RenderBuffer));
     if (!g_render_buffer)
     {
         ExitOutOfMemory();
         return;
     }        
 
-    memset(g_render_buffer, 0, buffer_size);
-    g_render_buffer->commands = (RenderCommand*)((char*)g_render_buffer + sizeof(RenderBuffer));
-    g_render_buffer->transforms = (mat4*)((char*)g_render_buffer->commands + commands_size);
-    g_render_buffer->command_count_max = traits->max_frame_commands;
-    g_render_buffer->transform_count_max = traits->max_frame_transforms;
+    g_render_buffer->arena = CreateArenaAllocator(traits->frame_memory_size, "frame");
+    if (!g_render_buffer->arena)
+    {
+        ExitOutOfMemory("frame");
+        return;
+    }
+
+    // The traits size a single chunk, frames that need more chain additional chunks
+    InitChunkList(g_render_buffer->commands, sizeof(RenderCommand), traits->max_frame_commands);
+    InitChunkList(g_render_buffer->transforms, sizeof(mat4), traits->max_frame_transforms);
+    InitChunkList(g_render_buffer->draws, sizeof(DrawInstance), traits->max_frame_commands);
+    InitChunkList(g_render_buffer->culls, sizeof(DrawCull), traits->max_frame_commands);
+    InitChunkList(g_render_buffer->cameras, sizeof(RenderCamera), CAMERA_CHUNK_SIZE);
+    InitChunkList(g_render_buffer->occluders, sizeof(OccluderData), OCCLUDER_CHUNK_SIZE);
+    g_render_buffer->device = device;
+
+    ReserveGPUBuffers(traits->max_frame_transforms, traits->max_frame_commands);
 }
 
 void ShutdownRenderBuffer()
 {
     assert(g_render_buffer);
+    SDL_ReleaseGPUTransferBuffer(g_render_buffer->device, g_render_buffer->transfer_buffer);
+    SDL_ReleaseGPUBuffer(g_render_buffer->device, g_render_buffer->draw_buffer);
+    SDL_ReleaseGPUBuffer(g_render_buffer->device, g_render_buffer->transform_buffer);
+    Destroy(g_render_buffer->arena);
     free(g_render_buffer);
     g_render_buffer = nullptr;
 }
@@ -44,6 +44,8 @@ struct Renderer
     bool shadow_pass;
     bool msaa;
     SDL_GPUGraphicsPipeline* pipeline;
+    Shader* shader;
+    VertexFormat vertex_format;
 };
 
 static Renderer g_renderer = {};
@@ -88,6 +90,8 @@ void InitShadowPass(const RendererTraits* traits)
 
 void BeginRenderFrame()
 {
+    UpdateTextureStreaming();
+    UpdateGlyphCache();
     ClearRenderCommands();
     UpdateBackBuffer();
 
@@ -206,11 +210,20 @@ void EndRenderFrame()
     assert(!g_renderer.render_pass);
 
     if (!g_renderer.command_buffer)
+    {
+        ReleaseDestroyedMeshes();
         return;
+    }
+
+    // pending mesh and texture uploads are submitted ahead of the frame so it can use them
+    EndUploadFrame();
 
     RenderGammaPass();
+    CullRenderCommands();
+    UploadRenderBufferGPU(g_renderer.command_buffer);
     ExecuteRenderCommands(g_renderer.command_buffer);
     SDL_SubmitGPUCommandBuffer(g_renderer.command_buffer);
+    ReleaseDestroyedMeshes();
 
     g_renderer.command_buffer = nullptr;
     g_renderer.render_pass = nullptr;
@@ -329,14 +342,16 @@ void BindTextureGPU(Texture* texture, SDL_GPUCommandBuffer* cb, int index)
     SDL_BindGPUFragmentSamplers(g_renderer.render_pass, index, &binding, 1);
 }
 
-void BindShaderGPU(Shader* shader)
+static void BindPipelineGPU()
 {
-    assert(shader);
+    if (!g_renderer.shader)
+        return;
 
     SDL_GPUGraphicsPipeline* pipeline = GetGPUPipeline(
         g_renderer.shadow_pass
             ? g_renderer.shadow_shader
-            : shader,
+            : g_renderer.shader,
+        g_renderer.vertex_format,
         g_renderer.msaa,
         g_renderer.shadow_pass);
     if (!pipeline)
@@ -350,25 +365,22 @@ void BindShaderGPU(Shader* shader)
     g_renderer.pipeline = pipeline;
 }
 
-void BindTransformGPU(const mat4* transform)
+void BindShaderGPU(Shader* shader)
 {
-    SDL_PushGPUVertexUniformData(
-        g_renderer.command_buffer,
-        vertex_register_object,
-        transform,
-        sizeof(mat4));
+    assert(shader);
+
+    g_renderer.shader = shader;
+    BindPipelineGPU();
 }
 
-void BindBoneTransformsGPU(const mat4* bones, int count)
+// Meshes pick the vertex layout of the pipeline, the shader stays the same
+void BindVertexFormatGPU(VertexFormat vertex_format)
 {
-    assert(bones);
-    assert(count > 0);
-
-    SDL_PushGPUVertexUniformData(
-        g_renderer.command_buffer,
-        vertex_register_bone,
-        bones,
-        (Uint32)(count * sizeof(mat4)));
+    if (g_renderer.vertex_format == vertex_format)
+        return;
+
+    g_renderer.vertex_format = vertex_format;
+    BindPipelineGPU();
 }
 
 SDL_GPURenderPass* BeginShadowPassGPU()
@@ -395,9 +407,7 @@ static void ResetRenderState()
 {
     // Reset all state tracking variables to force rebinding
     g_renderer.pipeline = nullptr;
-
-    static mat4 identity = glm::identity<mat4>();
-    BindBoneTransformsGPU(&identity, 1);
+    g_renderer.shader = nullptr;
 
     for (int i = 0; i < (int)(sampler_register_count); i++)
         BindTextureGPU(g_renderer.default_texture, g_renderer.command_buffer, i);
@@ -445,6 +455,30 @@ void SetShadowPassShader(Shader* shader)
     g_renderer.shadow_shader = shader;
 }
 
+// Pipelines are otherwise created the first time a draw needs them, which stalls that frame.
+// Every shader gets the non multisampled pipelines of the vertex formats loaded so far, the shadow
+// shader its shadow pipelines and the permutations saved by the last launch are created as well.
+void PrewarmPipelines(Shader** shaders, size_t shader_count)
+{
+    assert(shaders);
+
+    u32 vertex_formats = GetLoadedVertexFormats();
+    for (int format = 0; format < VERTEX_FORMAT_COUNT; format++)
+    {
+        if (!(vertex_formats & (1 << format)))
+            continue;
+
+        for (size_t i = 0; i < shader_count; i++)
+            if (shaders[i])
+                GetGPUPipeline(shaders[i], (VertexFormat)format, false, false);
+
+        if (g_renderer.shadow_shader)
+            GetGPUPipeline(g_renderer.shadow_shader, (VertexFormat)format, false, true);
+    }
+
+    PrewarmSavedPipelines(shaders, shader_count);
+}
+
 SDL_GPURenderPass* BeginGammaPassGPU()
 {
     if (!g_renderer.gamma_material)
@@ -482,11 +516,17 @@ void InitRenderer(RendererTraits* traits, SDL_Window* window)
         Exit(SDL_GetError());
     }
 
+    InitUpload(traits, g_renderer.device);
     InitTexture(traits, g_renderer.device);
+    InitTextureStreamer(traits);
     InitShader(traits, g_renderer.device);
     InitFont(traits, g_renderer.device);
+    InitGlyphCache(traits);
+    InitText(traits);
+    InitMeshHeap(traits, g_renderer.device);
     InitMesh(traits, g_renderer.device);
-    InitRenderBuffer(traits);
+    InitRenderBuffer(traits, g_renderer.device);
+    InitOcclusion(traits);
     InitSamplerFactory(traits, g_renderer.device);
     InitPipelineFactory(traits, window, g_renderer.device);
     InitGammaPass();
@@ -502,11 +542,17 @@ void ShutdownRenderer()
 
     ShutdownPipelineFactory();
     ShutdownSamplerFactory();
+    ShutdownOcclusion();
     ShutdownRenderBuffer();
     ShutdownMesh();
+    ShutdownMeshHeap();
+    ShutdownText();
+    ShutdownGlyphCache();
     ShutdownFont();
     ShutdownShader();
+    ShutdownTextureStreamer();
     ShutdownTexture();
+    ShutdownUpload();
 
     // g_renderer.gamma_mesh = nullptr; // TODO: implement proper cleanup
 
@@ -68,6 +68,7 @@ SDL_GPUSampler* GetGPUSampler(Texture* texture)
     sampler_info.mipmap_mode = (options.min_filter == TEXTURE_FILTER_NEAREST)
         ? SDL_GPU_SAMPLERMIPMAPMODE_NEAREST
         : SDL_GPU_SAMPLERMIPMAPMODE_LINEAR;
+    sampler_info.max_lod = 1000.0f;     // a zero max lod would pin sampling to the top level
     sampler_info.address_mode_u = ToSDL(options.clamp_u);
     sampler_info.address_mode_v = ToSDL(options.clamp_v);
     sampler_info.address_mode_w = ToSDL(options.clamp_w);
@@ -17,6 +17,7 @@ struct ShaderImpl
     SDL_GPUBlendFactor dst_blend;
     SDL_GPUCullMode cull;
     const char* name;
+    u64 hash;
     size_t uniform_data_size;
     ShaderUniformBuffer* uniforms;
 };
@@ -91,6 +92,15 @@ Object* LoadShader(Allocator* allocator, Stream* stream, AssetHeader* header, co
     impl->src_blend = (SDL_GPUBlendFactor)ReadU32(stream);
     impl->dst_blend = (SDL_GPUBlendFactor)ReadU32(stream);
     impl->cull = (SDL_GPUCullMode)ReadU32(stream);
+
+    // Pipelines are identified by the shader content so they can be matched across launches
+    impl->hash = Hash(vertex_bytecode, vertex_bytecode_length);
+    impl->hash = Hash(fragment_bytecode, fragment_bytecode_length, impl->hash);
+    impl->hash = Hash(&impl->flags, sizeof(impl->flags), impl->hash);
+    impl->hash = Hash(&impl->src_blend, sizeof(impl->src_blend), impl->hash);
+    impl->hash = Hash(&impl->dst_blend, sizeof(impl->dst_blend), impl->hash);
+    impl->hash = Hash(&impl->cull, sizeof(impl->cull), impl->hash);
+
     impl->uniforms = (ShaderUniformBuffer*)(impl + 1);
 
     ReadBytes(stream, impl->uniforms, (impl->vertex_uniform_count + impl->fragment_uniform_count) * sizeof(ShaderUniformBuffer));
@@ -130,7 +140,7 @@ Object* LoadShader(Allocator* allocator, Stream* stream, AssetHeader* header, co
     vertex_create_info.entrypoint = "vs";
     vertex_create_info.num_samplers = 0;
     vertex_create_info.num_storage_textures = 0;
-    vertex_create_info.num_storage_buffers = 0;
+    vertex_create_info.num_storage_buffers = 1;
     vertex_create_info.num_uniform_buffers = impl->vertex_uniform_count + (u32)vertex_register_user0;
     vertex_create_info.props = SDL_CreateProperties();
 
@@ -147,6 +157,11 @@ Object* LoadShader(Allocator* allocator, Stream* stream, AssetHeader* header, co
     return shader;
 }
 
+u64 GetContentHash(Shader* shader)
+{
+    return Impl(shader)->hash;
+}
+
 SDL_GPUShader* GetGPUVertexShader(Shader* shader)
 {
     return Impl(shader)->vertex;
@@ -0,0 +1,303 @@
+//
+//  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
+//
+//  Static instances are bucketed into square chunks on the XZ plane and each chunk is baked into
+//  one mesh per material and color, so a grid of tiles costs a few draws per chunk instead of one
+//  per tile.  Adding or removing an instance only rebakes its own chunk.
+//
+
+constexpr int STATIC_BATCH_MAX_CHUNK_MESHES = 16;
+constexpr int STATIC_BATCH_MAX_VERTICES = 65536;    // keeps the baked meshes on 16 bit indices
+constexpr int STATIC_BATCH_MAX_INDICES = STATIC_BATCH_MAX_VERTICES * 3;
+
+struct StaticInstance
+{
+    Mesh* mesh;
+    Material* material;
+    mat4 transform;
+    color_t color;
+    int chunk;
+    int next;
+    bool used;
+    bool processed;
+    bool baked;
+};
+
+struct StaticChunkMesh
+{
+    Mesh* mesh;
+    Material* material;
+    color_t color;
+};
+
+struct StaticChunk
+{
+    StaticChunkMesh meshes[STATIC_BATCH_MAX_CHUNK_MESHES];
+    int mesh_count;
+    int first_instance;
+    int unbaked_count;
+    bool dirty;
+};
+
+struct StaticBatchImpl
+{
+    OBJECT_BASE;
+    bounds3 bounds;
+    float chunk_size;
+    int chunk_count_x;
+    int chunk_count_z;
+    StaticChunk* chunks;
+    StaticInstance* instances;
+    int instance_count;
+    int max_instances;
+    int free_instance;
+    MeshBuilder* builder;
+    bool dirty;
+};
+
+static StaticBatchImpl* Impl(StaticBatch* b) { return (StaticBatchImpl*)Cast(b, TYPE_STATIC_BATCH); }
+
+StaticBatch* CreateStaticBatch(Allocator* allocator, const bounds3& bounds, float chunk_size, int max_instances)
+{
+    assert(chunk_size > 0.0f);
+    assert(max_instances > 0);
+
+    vec3 size = bounds.max - bounds.min;
+    int chunk_count_x = max(1, (int)ceil(size.x / chunk_size));
+    int chunk_count_z = max(1, (int)ceil(size.z / chunk_size));
+    size_t chunk_count = (size_t)(chunk_count_x * chunk_count_z);
+
+    auto batch = (StaticBatch*)CreateObject(
+        allocator,
+        sizeof(StaticBatchImpl) + sizeof(StaticChunk) * chunk_count + sizeof(StaticInstance) * max_instances,
+        TYPE_STATIC_BATCH);
+    if (!batch)
+        return nullptr;
+
+    auto impl = Impl(batch);
+    impl->bounds = bounds;
+    impl->chunk_size = chunk_size;
+    impl->chunk_count_x = chunk_count_x;
+    impl->chunk_count_z = chunk_count_z;
+    impl->chunks = (StaticChunk*)(impl + 1);
+    impl->instances = (StaticInstance*)(impl->chunks + chunk_count);
+    impl->instance_count = 0;
+    impl->max_instances = max_instances;
+    impl->free_instance = -1;
+    impl->dirty = false;
+    memset(impl->chunks, 0, sizeof(StaticChunk) * chunk_count);
+    memset(impl->instances, 0, sizeof(StaticInstance) * max_instances);
+    for (size_t i = 0; i < chunk_count; i++)
+        impl->chunks[i].first_instance = -1;
+
+    impl->builder = CreateMeshBuilder(allocator, STATIC_BATCH_MAX_VERTICES, STATIC_BATCH_MAX_INDICES);
+    if (!impl->builder)
+    {
+        Free(allocator, batch);
+        return nullptr;
+    }
+
+    return batch;
+}
+
+static int GetChunkIndex(StaticBatchImpl* impl, const mat4& transform)
+{
+    vec3 position = vec3(transform[3]);
+    int x = clamp((int)floor((position.x - impl->bounds.min.x) / impl->chunk_size), 0, impl->chunk_count_x - 1);
+    int z = clamp((int)floor((position.z - impl->bounds.min.z) / impl->chunk_size), 0, impl->chunk_count_z - 1);
+    return z * impl->chunk_count_x + x;
+}
+
+static void MarkDirty(StaticBatchImpl* impl, int chunk_index)
+{
+    impl->chunks[chunk_index].dirty = true;
+    impl->dirty = true;
+}
+
+int AddStaticInstance(StaticBatch* batch, Mesh* mesh, Material* material, const mat4& transform, color_t color)
+{
+    assert(mesh);
+    assert(material);
+
+    StaticBatchImpl* impl = Impl(batch);
+    int index = impl->free_instance;
+    if (index != -1)
+        impl->free_instance = impl->instances[index].next;
+    else if (impl->instance_count < impl->max_instances)
+        index = impl->instance_count++;
+    else
+        return -1;
+
+    int chunk_index = GetChunkIndex(impl, transform);
+    StaticChunk& chunk = impl->chunks[chunk_index];
+    StaticInstance& instance = impl->instances[index];
+    instance = {};
+    instance.mesh = mesh;
+    instance.material = material;
+    instance.transform = transform;
+    instance.color = color;
+    instance.chunk = chunk_index;
+    instance.next = chunk.first_instance;
+    instance.used = true;
+    chunk.first_instance = index;
+
+    MarkDirty(impl, chunk_index);
+    return index;
+}
+
+void RemoveStaticInstance(StaticBatch* batch, int index)
+{
+    StaticBatchImpl* impl = Impl(batch);
+    if (index < 0 || index >= impl->instance_count || !impl->instances[index].used)
+        return;
+
+    StaticInstance& instance = impl->instances[index];
+    StaticChunk& chunk = impl->chunks[instance.chunk];
+    int* link = &chunk.first_instance;
+    while (*link != index)
+        link = &impl->instances[*link].next;
+    *link = instance.next;
+
+    MarkDirty(impl, instance.chunk);
+
+    instance.used = false;
+    instance.next = impl->free_instance;
+    impl->free_instance = index;
+}
+
+static bool FlushChunkMesh(StaticBatchImpl* impl, StaticChunk& chunk, Material* material, color_t color)
+{
+    if (GetVertexCount(impl->builder) == 0)
+        return true;
+
+    assert(chunk.mesh_count < STATIC_BATCH_MAX_CHUNK_MESHES);
+    Mesh* mesh = CreateMesh(ALLOCATOR_DEFAULT, impl->builder, "static_batch");
+    Clear(impl->builder);
+    if (!mesh)
+        return false;
+
+    chunk.meshes[chunk.mesh_count++] = { mesh, material, color };
+    return true;
+}
+
+static void BakeChunk(StaticBatchImpl* impl, StaticChunk& chunk)
+{
+    for (int i = 0; i < chunk.mesh_count; i++)
+        Destroy(chunk.meshes[i].mesh);
+
+    chunk.mesh_count = 0;
+    chunk.unbaked_count = 0;
+    chunk.dirty = false;
+
+    for (int i = chunk.first_instance; i != -1; i = impl->instances[i].next)
+    {
+        impl->instances[i].processed = false;
+        impl->instances[i].baked = false;
+    }
+
+    // Each pass bakes every instance sharing the material and color of the first one left.
+    // Instances that can not be merged, because their mesh has no CPU copy or the chunk ran out
+    // of meshes, are drawn on their own.
+    for (int first = chunk.first_instance; first != -1; first = impl->instances[first].next)
+    {
+        StaticInstance& key = impl->instances[first];
+        if (key.processed)
+            continue;
+
+        if (chunk.mesh_count >= STATIC_BATCH_MAX_CHUNK_MESHES)
+        {
+            key.processed = true;
+            continue;
+        }
+
+        Clear(impl->builder);
+        for (int i = first; i != -1; i = impl->instances[i].next)
+        {
+            StaticInstance& instance = impl->instances[i];
+            if (instance.processed || instance.material != key.material || !color_equals(&instance.color, &key.color))
+                continue;
+
+            instance.processed = true;
+            instance.baked = AddMesh(impl->builder, instance.mesh, instance.transform);
+
+            // A full builder becomes a mesh of its own as long as one mesh slot is left for the
+            // rest of the group
+            if (!instance.baked &&
+                GetVertexCount(impl->builder) > 0 &&
+                chunk.mesh_count + 1 < STATIC_BATCH_MAX_CHUNK_MESHES &&
+                FlushChunkMesh(impl, chunk, key.material, key.color))
+                instance.baked = AddMesh(impl->builder, instance.mesh, instance.transform);
+        }
+
+        FlushChunkMesh(impl, chunk, key.material, key.color);
+    }
+
+    for (int i = chunk.first_instance; i != -1; i = impl->instances[i].next)
+        if (!impl->instances[i].baked)
+            chunk.unbaked_count++;
+}
+
+void UpdateStaticBatch(StaticBatch* batch)
+{
+    StaticBatchImpl* impl = Impl(batch);
+    if (!impl->dirty)
+        return;
+
+    int chunk_count = impl->chunk_count_x * impl->chunk_count_z;
+    for (int i = 0; i < chunk_count; i++)
+        if (impl->chunks[i].dirty)
+            BakeChunk(impl, impl->chunks[i]);
+
+    impl->dirty = false;
+}
+
+// Dirty chunks are rebaked first, the old chunk meshes stay alive until the frame was submitted
+// so draws of the batch recorded earlier in the frame remain valid
+void DrawStaticBatch(StaticBatch* batch)
+{
+    UpdateStaticBatch(batch);
+
+    StaticBatchImpl* impl = Impl(batch);
+    Material* bound_material = nullptr;
+    color_t bound_color = {};
+    int chunk_count = impl->chunk_count_x * impl->chunk_count_z;
+
+    // Baked meshes are already in world space
+    BindTransform(identity<mat4>());
+    for (int c = 0; c < chunk_count; c++)
+    {
+        StaticChunk& chunk = impl->chunks[c];
+        for (int i = 0; i < chunk.mesh_count; i++)
+        {
+            StaticChunkMesh& chunk_mesh = chunk.meshes[i];
+            if (chunk_mesh.material != bound_material || !color_equals(&chunk_mesh.color, &bound_color))
+            {
+                BindColor(chunk_mesh.color);
+                BindMaterial(chunk_mesh.material);
+                bound_material = chunk_mesh.material;
+                bound_color = chunk_mesh.color;
+            }
+
+            DrawMesh(chunk_mesh.mesh);
+        }
+    }
+
+    for (int c = 0; c < chunk_count; c++)
+    {
+        StaticChunk& chunk = impl->chunks[c];
+        if (chunk.unbaked_count == 0)
+            continue;
+
+        for (int i = chunk.first_instance; i != -1; i = impl->instances[i].next)
+        {
+            StaticInstance& instance = impl->instances[i];
+            if (instance.baked)
+                continue;
+
+            BindColor(instance.color);
+            BindMaterial(instance.material);
+            BindTransform(instance.transform);
+            DrawMesh(instance.mesh);
+        }
+    }
+}
@@ -0,0 +1,358 @@
+//
+//  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
+//
+//  Text is laid out into runs of glyph quads with kerning, word wrapping and alignment applied.
+//  Runs are cached by font, size, text, width and alignment so text that does not change is only
+//  laid out once.  A run stores the glyph version of its font and is laid out again once glyphs
+//  from the glyph cache were uploaded or evicted.
+//
+
+constexpr u32 TEXT_REPLACEMENT_CHARACTER = 0xFFFD;
+
+struct TextRunKey
+{
+    Font* font;
+    float font_size;
+    float max_width;
+    TextAlign align;
+};
+
+struct TextRunEntry
+{
+    u64 key;
+    Font* font;
+    char* text;
+    int text_capacity;
+    u32 glyph_version;
+    u64 last_used;
+    int quad_capacity;
+    TextRun run;
+};
+
+struct TextLine
+{
+    int first_quad;
+    float width;
+};
+
+struct TextSystem
+{
+    TextRunEntry* entries;
+    int entry_count;
+    u64 use_count;
+    TextLine* lines;
+    int line_capacity;
+};
+
+static TextSystem* g_text = nullptr;
+
+// Invalid sequences decode to the replacement character one byte at a time
+static u32 DecodeUtf8(const char*& text)
+{
+    const u8* p = (const u8*)text;
+    u32 c = p[0];
+    int length;
+    u32 min_value;
+    if (c < 0x80)
+    {
+        text++;
+        return c;
+    }
+
+    if ((c & 0xE0) == 0xC0)
+    {
+        length = 2;
+        min_value = 0x80;
+        c &= 0x1F;
+    }
+    else if ((c & 0xF0) == 0xE0)
+    {
+        length = 3;
+        min_value = 0x800;
+        c &= 0x0F;
+    }
+    else if ((c & 0xF8) == 0xF0)
+    {
+        length = 4;
+        min_value = 0x10000;
+        c &= 0x07;
+    }
+    else
+    {
+        text++;
+        return TEXT_REPLACEMENT_CHARACTER;
+    }
+
+    for (int i = 1; i < length; i++)
+    {
+        if ((p[i] & 0xC0) != 0x80)
+        {
+            text++;
+            return TEXT_REPLACEMENT_CHARACTER;
+        }
+
+        c = (c << 6) | (p[i] & 0x3F);
+    }
+
+    text += length;
+    if (c < min_value || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF))
+        return TEXT_REPLACEMENT_CHARACTER;
+
+    return c;
+}
+
+static bool IsBreak(u32 codepoint)
+{
+    return codepoint == ' ' || codepoint == '\t';
+}
+
+static bool AddLine(int first_quad, float width, int* line_count)
+{
+    if (*line_count == g_text->line_capacity)
+    {
+        int capacity = max(16, g_text->line_capacity * 2);
+        TextLine* lines = (TextLine*)realloc(g_text->lines, capacity * sizeof(TextLine));
+        if (!lines)
+            return false;
+
+        g_text->lines = lines;
+        g_text->line_capacity = capacity;
+    }
+
+    g_text->lines[(*line_count)++] = { first_quad, width };
+    return true;
+}
+
+// Lines break at the last space that fits, or before the glyph that does not fit when the line
+// has no space, which keeps text without spaces such as CJK wrapping.  Broken lines are laid out
+// again from the break so kerning across the break is dropped.
+static void Layout(TextRunEntry& entry, Font* font, float font_size, const char* text, float max_width, TextAlign align)
+{
+    TextRun& run = entry.run;
+    run.quad_count = 0;
+    run.line_count = 0;
+    run.size = VEC2_ZERO;
+
+    int capacity = (int)strlen(text);
+    if (capacity > entry.quad_capacity)
+    {
+        TextQuad* quads = (TextQuad*)realloc(entry.run.quads, capacity * sizeof(TextQuad));
+        if (!quads)
+            return;
+
+        entry.run.quads = quads;
+        entry.quad_capacity = capacity;
+    }
+
+    float kerning_scale = font_size / (float)max(GetFontSize(font), 1u);
+    float line_height = GetLineHeight(font) * font_size;
+    float baseline = GetBaseline(font) * font_size;
+
+    int line_count = 0;
+    int line_start = 0;
+    float pen = 0.0f;
+    float line_width = 0.0f;
+    float widest = 0.0f;
+    u32 previous = 0;
+    const char* break_text = nullptr;
+    int break_quad = 0;
+    float break_width = 0.0f;
+
+    const char* p = text;
+    while (*p)
+    {
+        const char* start = p;
+        u32 codepoint = DecodeUtf8(p);
+
+        if (codepoint == '\n')
+        {
+            AddLine(line_start, line_width, &line_count);
+            widest = max(widest, line_width);
+            line_start = run.quad_count;
+            pen = line_width = 0.0f;
+            previous = 0;
+            break_text = nullptr;
+            continue;
+        }
+
+        const FontGlyph* glyph = GetGlyph(font, codepoint);
+        float x = pen;
+        if (previous)
+            x += GetKerning(font, previous, codepoint) * kerning_scale;
+
+        if (max_width > 0.0f && !IsBreak(codepoint) && run.quad_count > line_start &&
+            x + glyph->advance * font_size > max_width)
+        {
+            if (break_text)
+            {
+                run.quad_count = break_quad;
+                p = break_text;
+                line_width = break_width;
+            }
+            else
+                p = start;
+
+            AddLine(line_start, line_width, &line_count);
+            widest = max(widest, line_width);
+            line_start = run.quad_count;
+            pen = line_width = 0.0f;
+            previous = 0;
+            break_text = nullptr;
+            continue;
+        }
+
+        // Spaces and glyphs that are still being rasterized only move the pen
+        if (glyph->uv_min != glyph->uv_max)
+        {
+            TextQuad& quad = run.quads[run.quad_count++];
+            float y = line_count * line_height + baseline;
+            quad.position_min = vec2(x, y) + glyph->bearing * font_size;
+            quad.position_max = quad.position_min + glyph->size * font_size;
+            quad.uv_min = glyph->uv_min;
+            quad.uv_max = glyph->uv_max;
+        }
+
+        pen = x + glyph->advance * font_size;
+        previous = codepoint;
+        if (IsBreak(codepoint))
+        {
+            break_text = p;
+            break_quad = run.quad_count;
+            break_width = line_width;
+        }
+        else
+            line_width = pen;
+    }
+
+    AddLine(line_start, line_width, &line_count);
+    widest = max(widest, line_width);
+
+    // Lines align within the wrap width, or within the widest line when text does not wrap
+    float box_width = max_width > 0.0f ? max_width : widest;
+    if (align != TEXT_ALIGN_LEFT)
+    {
+        for (int i = 0; i < line_count; i++)
+        {
+            const TextLine& line = g_text->lines[i];
+            int end = i + 1 < line_count ? g_text->lines[i + 1].first_quad : run.quad_count;
+            float offset = box_width - line.width;
+            if (align == TEXT_ALIGN_CENTER)
+                offset *= 0.5f;
+
+            for (int q = line.first_quad; q < end; q++)
+            {
+                run.quads[q].position_min.x += offset;
+                run.quads[q].position_max.x += offset;
+            }
+        }
+    }
+
+    run.line_count = line_count;
+    run.size = vec2(box_width, line_count * line_height);
+}
+
+const TextRun* LayoutText(Font* font, float font_size, const char* text, float max_width, TextAlign align)
+{
+    assert(g_text);
+    assert(font);
+    assert(text);
+
+    TextRunKey run_key;
+    memset(&run_key, 0, sizeof(run_key));
+    run_key.font = font;
+    run_key.font_size = font_size;
+    run_key.max_width = max_width;
+    run_key.align = align;
+    u64 key = Hash(&run_key, sizeof(run_key), Hash(text));
+    u32 glyph_version = GetGlyphVersion(font);
+
+    // Reuse the run with the same key and text, otherwise the least recently used one.  The text
+    // is compared as well so two strings that hash the same never share a run.
+    TextRunEntry* entry = nullptr;
+    bool found = false;
+    for (int i = 0; i < g_text->entry_count; i++)
+    {
+        TextRunEntry& candidate = g_text->entries[i];
+        if (candidate.key == key && candidate.font == font && candidate.text && strcmp(candidate.text, text) == 0)
+        {
+            entry = &candidate;
+            found = true;
+            break;
+        }
+
+        if (!entry || candidate.last_used < entry->last_used)
+            entry = &candidate;
+    }
+
+    entry->last_used = ++g_text->use_count;
+    if (found && entry->glyph_version == glyph_version)
+        return &entry->run;
+
+    if (!found)
+    {
+        int text_size = (int)strlen(text) + 1;
+        if (text_size > entry->text_capacity)
+        {
+            char* entry_text = (char*)realloc(entry->text, text_size);
+            if (!entry_text)
+            {
+                entry->key = 0;
+                entry->font = nullptr;
+                entry->run.quad_count = 0;
+                entry->run.line_count = 0;
+                entry->run.size = VEC2_ZERO;
+                return &entry->run;
+            }
+
+            entry->text = entry_text;
+            entry->text_capacity = text_size;
+        }
+
+        memcpy(entry->text, text, text_size);
+    }
+
+    entry->key = key;
+    entry->font = font;
+    entry->glyph_version = glyph_version;
+    Layout(*entry, font, font_size, text, max_width, align);
+    return &entry->run;
+}
+
+vec2 MeasureText(Font* font, float font_size, const char* text, float max_width)
+{
+    return LayoutText(font, font_size, text, max_width, TEXT_ALIGN_LEFT)->size;
+}
+
+void InitText(RendererTraits* traits)
+{
+    assert(!g_text);
+    assert(traits->max_text_runs > 0);
+
+    g_text = (TextSystem*)calloc(1, sizeof(TextSystem));
+    if (!g_text)
+    {
+        ExitOutOfMemory("text");
+        return;
+    }
+
+    g_text->entry_count = (int)traits->max_text_runs;
+    g_text->entries = (TextRunEntry*)calloc(g_text->entry_count, sizeof(TextRunEntry));
+    if (!g_text->entries)
+        ExitOutOfMemory("text");
+}
+
+void ShutdownText()
+{
+    assert(g_text);
+
+    for (int i = 0; i < g_text->entry_count; i++)
+    {
+        free(g_text->entries[i].run.quads);
+        free(g_text->entries[i].text);
+    }
+
+    free(g_text->entries);
+    free(g_text->lines);
+    free(g_text);
+    g_text = nullptr;
+}
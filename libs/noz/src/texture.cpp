@@ -11,6 +11,7 @@ struct TextureImpl
     SDL_GPUTexture* handle;
     SamplerOptions sampler_options;
     ivec2 size;
+    int stream_index;
 };
 
 static SDL_GPUDevice* g_device = nullptr;
@@ -30,18 +31,52 @@ SDL_GPUTextureFormat ToSDL(const TextureFormat format)
         return SDL_GPU_TEXTUREFORMAT_R16G16B16A16_FLOAT;
     case TEXTURE_FORMAT_R8:
         return SDL_GPU_TEXTUREFORMAT_R8_UNORM;
+    case TEXTURE_FORMAT_BC1:
+        return SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM;
+    case TEXTURE_FORMAT_BC3:
+        return SDL_GPU_TEXTUREFORMAT_BC3_RGBA_UNORM;
+    case TEXTURE_FORMAT_BC4:
+        return SDL_GPU_TEXTUREFORMAT_BC4_R_UNORM;
+    case TEXTURE_FORMAT_BC5:
+        return SDL_GPU_TEXTUREFORMAT_BC5_RG_UNORM;
+    case TEXTURE_FORMAT_BC7:
+        return SDL_GPU_TEXTUREFORMAT_BC7_RGBA_UNORM;
     default:
         return SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
     }
 }
 
+static bool CreateGPUTexture(
+    TextureImpl* impl,
+    SDL_GPUTextureFormat format,
+    u32 width,
+    u32 height,
+    u32 level_count,
+    const char* name)
+{
+    SDL_GPUTextureCreateInfo texture_info = {};
+    texture_info.type = SDL_GPU_TEXTURETYPE_2D;
+    texture_info.format = format;
+    texture_info.usage = SDL_GPU_TEXTUREUSAGE_SAMPLER;
+    texture_info.width = width;
+    texture_info.height = height;
+    texture_info.layer_count_or_depth = 1;
+    texture_info.num_levels = level_count;
+    texture_info.sample_count = SDL_GPU_SAMPLECOUNT_1;
+    texture_info.props = SDL_CreateProperties();
+    SDL_SetStringProperty(texture_info.props, SDL_PROP_GPU_TEXTURE_CREATE_NAME_STRING, name);
+
+    impl->handle = SDL_CreateGPUTexture(g_device, &texture_info);
+    SDL_DestroyProperties(texture_info.props);
+    return impl->handle != nullptr;
+}
+
 static void CreateTexture(
     TextureImpl* impl,
     void* data,
     size_t width,
     size_t height,
     int channels,
-    bool generate_mipmaps,
     const char* name)
 {
     assert(impl);
@@ -50,129 +85,189 @@ static void CreateTexture(
     assert(height > 0);
     assert(channels > 0);
 
-    // Handle different channel formats
-    uint8_t* rgba_data = nullptr;
-    bool allocated_rgba = false;
+    if (channels != 1 && channels != 3 && channels != 4)
+        return;
 
-    if (channels == 1)
-    {
-        // Single channel - use as-is for R8_UNORM
-        // No conversion needed
-    }
-    // Convert RGB to RGBA
-    else if (channels == 3)
-    {
-        const uint8_t* rgb_src = (const uint8_t*)data;
-        // todo: use allocator
-        rgba_data = (uint8_t*)malloc(width * height * 4);
-        if (!rgba_data)
-            return;
+    // RGB is expanded to RGBA
+    SDL_GPUTextureFormat format = channels == 1 ? SDL_GPU_TEXTUREFORMAT_R8_UNORM : SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
+    if (!CreateGPUTexture(impl, format, (u32)width, (u32)height, 1, name))
+        return;
+
+    impl->size.x = (int)width;
+    impl->size.y = (int)height;
+
+    // Write the pixels straight into the staging ring, the copy goes out with the next flush
+    const size_t pixel_count = width * height;
+    const int gpu_channels = channels == 3 ? 4 : channels;
+    u8* staging = (u8*)UploadToTextureGPU(impl->handle, 0, (u32)width, (u32)height, (u32)(pixel_count * gpu_channels));
+    if (!staging)
+        return;
 
-        allocated_rgba = true;
+    if (channels == 3)
+        ConvertRGBToRGBA((const u8*)data, staging, pixel_count);
+    else
+        memcpy(staging, data, pixel_count * channels);
+}
+
+// Large mipped textures only upload their smallest levels here and keep them in memory, the
+// texture streamer reads the rest from the asset file once draws need them
+static bool LoadStreamedTexture(TextureImpl* impl, Stream* stream, TextureFormat format, u32 level_count, const char* name)
+{
+    if (!IsTextureStreamingEnabled() || level_count > MAX_TEXTURE_LEVELS)
+        return false;
 
-        for (size_t i = 0; i < width * height; ++i)
+    size_t start = GetPosition(stream);
+    TextureLevel levels[MAX_TEXTURE_LEVELS];
+    for (u32 level = 0; level < level_count; level++)
+    {
+        TextureLevel& l = levels[level];
+        l.width = ReadU32(stream);
+        l.height = ReadU32(stream);
+        l.size = ReadU32(stream);
+        l.offset = (u32)GetPosition(stream);
+        if (l.size != GetTextureLevelSize(format, l.width, l.height))
         {
-            rgba_data[i * 4 + 0] = rgb_src[i * 3 + 0]; // R
-            rgba_data[i * 4 + 1] = rgb_src[i * 3 + 1]; // G
-            rgba_data[i * 4 + 2] = rgb_src[i * 3 + 2]; // B
-            rgba_data[i * 4 + 3] = 255;                // A
+            SetPosition(stream, start);
+            return false;
         }
-        data = rgba_data;
-        channels = 4;
-    }
-    else if (channels != 4)
-    {
-        return;
+
+        SetPosition(stream, l.offset + l.size);
     }
 
-    // Create transfer buffer for pixel data
-    const size_t pitch = width * channels;
-    const size_t size = pitch * height;
+    u32 tail_level = GetStreamingTailLevel(levels, level_count);
+    u32 tail_size = 0;
+    for (u32 level = tail_level; level < level_count; level++)
+        tail_size += levels[level].size;
 
-    SDL_GPUTransferBufferCreateInfo transfer_info = {};
-    transfer_info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
-    transfer_info.size = (Uint32)size;
-    transfer_info.props = 0;
-    SDL_GPUTransferBuffer* transfer_buffer = SDL_CreateGPUTransferBuffer(g_device, &transfer_info);
-    if (!transfer_buffer)
+    u8* tail_data = tail_level > 0 ? (u8*)malloc(tail_size) : nullptr;
+    if (!tail_data)
     {
-        if (allocated_rgba)
-            free(rgba_data);
-        return;
+        SetPosition(stream, start);
+        return false;
     }
 
-    // Map transfer buffer and copy pixel data
-    void* mapped = SDL_MapGPUTransferBuffer(g_device, transfer_buffer, false);
-    if (!mapped)
+    u8* tail = tail_data;
+    for (u32 level = tail_level; level < level_count; level++)
     {
-        SDL_ReleaseGPUTransferBuffer(g_device, transfer_buffer);
-        if (allocated_rgba)
-            free(rgba_data);
-        return;
+        memcpy(tail, GetData(stream) + levels[level].offset, levels[level].size);
+        tail += levels[level].size;
     }
-    SDL_memcpy(mapped, data, size);
-    SDL_UnmapGPUTransferBuffer(g_device, transfer_buffer);
 
-    // Calculate number of mipmap levels if requested
-    uint32_t num_levels = 1;
-    if (generate_mipmaps)
+    impl->stream_index = StreamTexture((Texture*)impl, format, name, levels, level_count, tail_level, tail_data);
+    if (impl->stream_index != -1)
+        return true;
+
+    free(tail_data);
+    SetPosition(stream, start);
+    return false;
+}
+
+// Every stored level is read from the stream straight into the staging ring, so the whole mip
+// chain goes out with the next flush in a single copy pass.  Version 1 RGB levels are the only
+// ones that need a temporary buffer to be expanded to RGBA.
+static void LoadTextureLevels(
+    Allocator* allocator,
+    TextureImpl* impl,
+    Stream* stream,
+    TextureFormat format,
+    int channels,
+    bool mips,
+    const char* name)
+{
+    u32 width = (u32)impl->size.x;
+    u32 height = (u32)impl->size.y;
+    u32 level_count = mips ? ReadU32(stream) : 1;
+    if (level_count == 0)
+        return;
+
+    if (mips && channels != 3 && LoadStreamedTexture(impl, stream, format, level_count, name))
+        return;
+
+    if (!CreateGPUTexture(impl, ToSDL(format), width, height, level_count, name))
+        return;
+
+    for (u32 level = 0; level < level_count; level++)
     {
-        // Calculate maximum number of mipmap levels
-        size_t max_dim = (width > height) ? width : height;
-        num_levels = 1 + (u32)floor(log2((double)max_dim));
+        u32 level_width = width;
+        u32 level_height = height;
+        if (mips)
+        {
+            level_width = ReadU32(stream);
+            level_height = ReadU32(stream);
+        }
+
+        u32 data_size = ReadU32(stream);
+        u32 upload_size = GetTextureLevelSize(format, level_width, level_height);
+        u32 pixel_count = level_width * level_height;
+        if (data_size != (channels == 3 ? pixel_count * 3 : upload_size))
+            return;
+
+        u8* staging = (u8*)UploadToTextureGPU(impl->handle, level, level_width, level_height, upload_size);
+        if (!staging)
+        {
+            SetPosition(stream, GetPosition(stream) + data_size);
+            continue;
+        }
+
+        if (channels != 3)
+        {
+            ReadBytes(stream, staging, data_size);
+            continue;
+        }
+
+        if (u8* rgb = (u8*)Alloc(allocator, data_size))
+        {
+            ReadBytes(stream, rgb, data_size);
+            ConvertRGBToRGBA(rgb, staging, pixel_count);
+            Free(allocator, rgb);
+        }
+        else
+            SetPosition(stream, GetPosition(stream) + data_size);
     }
+}
 
-    // Create GPU texture with appropriate format based on channel count
-    SDL_GPUTextureCreateInfo texture_info = {};
-    texture_info.type = SDL_GPU_TEXTURETYPE_2D;
-    texture_info.format = (channels == 1) ? SDL_GPU_TEXTUREFORMAT_R8_UNORM : SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
-    texture_info.usage = SDL_GPU_TEXTUREUSAGE_SAMPLER;
-    texture_info.width = (int)width;
-    texture_info.height = (int)height;
-    texture_info.layer_count_or_depth = 1;
-    texture_info.num_levels = num_levels;
-    texture_info.sample_count = SDL_GPU_SAMPLECOUNT_1;
-    texture_info.props = SDL_CreateProperties();
-    SDL_SetStringProperty(texture_info.props, SDL_PROP_GPU_TEXTURE_CREATE_NAME_STRING, name);
+// Replaces the GPU texture with one that holds the levels from first_level down, data holds those
+// levels back to back.  The previous texture is released once the GPU is done with it.
+bool SetTextureLevels(
+    Texture* texture,
+    TextureFormat format,
+    const TextureLevel* levels,
+    u32 first_level,
+    u32 level_count,
+    const u8* data,
+    const char* name)
+{
+    assert(first_level < level_count);
+    assert(data);
 
-    impl->handle = SDL_CreateGPUTexture(g_device, &texture_info);
-    SDL_DestroyProperties(texture_info.props);
-    if (!impl->handle)
+    TextureImpl* impl = Impl(texture);
+    SDL_GPUTexture* previous = impl->handle;
+    const TextureLevel& top = levels[first_level];
+    if (!CreateGPUTexture(impl, ToSDL(format), top.width, top.height, level_count - first_level, name))
     {
-        SDL_ReleaseGPUTransferBuffer(g_device, transfer_buffer);
-        if (allocated_rgba)
-            free(rgba_data);
-        return;
+        impl->handle = previous;
+        return false;
     }
 
-    SDL_GPUCommandBuffer* cb = SDL_AcquireGPUCommandBuffer(g_device);
-    if (!cb)
+    for (u32 level = first_level; level < level_count; level++)
     {
-        SDL_ReleaseGPUTransferBuffer(g_device, transfer_buffer);
-        if (allocated_rgba)
-            free(rgba_data);
-        return;
+        const TextureLevel& l = levels[level];
+        if (void* staging = UploadToTextureGPU(impl->handle, level - first_level, l.width, l.height, l.size))
+            memcpy(staging, data, l.size);
+        data += l.size;
     }
 
-    // Upload pixel data to GPU texture
-    SDL_GPUCopyPass* copy_pass = SDL_BeginGPUCopyPass(cb);
-    SDL_GPUTextureTransferInfo source = {transfer_buffer, 0, (uint32_t)width, (uint32_t)height};
-    SDL_GPUTextureRegion destination = {0};
-    destination.texture = impl->handle;
-    destination.w = (uint32_t)width;
-    destination.h = (uint32_t)height;
-    destination.d = 1;
+    if (previous)
+        SDL_ReleaseGPUTexture(g_device, previous);
 
-    SDL_UploadToGPUTexture(copy_pass, &source, &destination, false);
-    SDL_EndGPUCopyPass(copy_pass);
-    SDL_SubmitGPUCommandBuffer(cb);
-    SDL_ReleaseGPUTransferBuffer(g_device, transfer_buffer);
-
-    impl->size.x = (int)width;
-    impl->size.y = (int)height;
+    return true;
+}
 
-    if (allocated_rgba)
-        free(rgba_data);
+void RequestTextureDetail(Texture* texture, float screen_pixels)
+{
+    TextureImpl* impl = Impl(texture);
+    if (impl->stream_index != -1)
+        RequestStreamedTextureDetail(impl->stream_index, screen_pixels);
 }
 
 Texture* CreateTexture(Allocator* allocator, int width, int height, TextureFormat format, const char* name)
@@ -189,6 +284,7 @@ Texture* CreateTexture(Allocator* allocator, int width, int height, TextureForma
     auto impl = Impl(texture);
     impl->size.x = width;
     impl->size.y = height;
+    impl->stream_index = -1;
 
     SDL_GPUTextureCreateInfo texture_info = {};
     texture_info.type = SDL_GPU_TEXTURETYPE_2D;
@@ -223,7 +319,8 @@ Texture* CreateTexture(
     if (!texture)
         return nullptr;
 
-    CreateTexture(Impl(texture), data, width, height, GetBytesPerPixel(format), false, name);
+    Impl(texture)->stream_index = -1;
+    CreateTexture(Impl(texture), data, width, height, GetBytesPerPixel(format), name);
     return texture;
 }
 
@@ -274,13 +371,26 @@ Object* LoadTexture(Allocator* allocator, Stream* stream, AssetHeader* header, c
     assert(name);
     assert(header);
 
-    // Read texture data
+    // Read texture data, version 1 stored 0 for RGB and 1 for RGBA, later versions a TextureFormat
     uint32_t format = ReadU32(stream);
     uint32_t width = ReadU32(stream);
     uint32_t height = ReadU32(stream);
 
-    // Validate format
-    if (format > 1)
+    // Validate format, RGB data is expanded to RGBA on upload
+    int channels = 4;
+    if (header->version < 2)
+    {
+        if (format > 1)
+            return nullptr;
+
+        channels = format == 1 ? 4 : 3;
+        format = TEXTURE_FORMAT_RGBA8;
+    }
+    else if (format != TEXTURE_FORMAT_RGBA8 && !IsBlockCompressed((TextureFormat)format))
+        return nullptr;
+
+    if (IsBlockCompressed((TextureFormat)format) &&
+        !SDL_GPUTextureSupportsFormat(g_device, ToSDL((TextureFormat)format), SDL_GPU_TEXTURETYPE_2D, SDL_GPU_TEXTUREUSAGE_SAMPLER))
         return nullptr;
 
     // Create texture object
@@ -292,6 +402,7 @@ Object* LoadTexture(Allocator* allocator, Stream* stream, AssetHeader* header, c
     impl->handle = nullptr;
     impl->size.x = width;
     impl->size.y = height;
+    impl->stream_index = -1;
 
     // Read sampler options
     impl->sampler_options.min_filter = (TextureFilter)ReadU8(stream);
@@ -301,53 +412,7 @@ Object* LoadTexture(Allocator* allocator, Stream* stream, AssetHeader* header, c
     impl->sampler_options.clamp_w = (TextureClamp)ReadU8(stream);
     bool mips = ReadBool(stream);
 
-    if (mips)
-    {
-        // Read number of mip levels
-        uint32_t num_mip_levels = ReadU32(stream);
-
-        // For now, just read the base level and let GPU handle mipmaps
-        // TODO: Upload all mip levels to GPU
-        for (uint32_t level = 0; level < num_mip_levels; ++level)
-        {
-            /*uint32_t mip_width =*/ReadU32(stream);
-            /*uint32_t mip_height = */ ReadU32(stream);
-            uint32_t mip_data_size = ReadU32(stream);
-
-            if (level == 0)
-            {
-                // todo: use allocator
-                u8* mip_data = (u8*)malloc(mip_data_size);
-                if (mip_data)
-                {
-                    ReadBytes(stream, mip_data, mip_data_size);
-                    CreateTexture(impl, mip_data, width, height, (format == 1) ? 4 : 3, true, name);
-                    free(mip_data);
-                }
-                else
-                {
-                    // Skip data if allocation failed
-                    SetPosition(stream, GetPosition(stream) + mip_data_size);
-                }
-            }
-            else
-            {
-                // Skip other mip levels for now
-                SetPosition(stream, GetPosition(stream) + mip_data_size);
-            }
-        }
-    }
-    else
-    {
-        const int channels = (format == 1) ? 4 : 3;
-        const size_t data_size = width * height * channels;
-        if (const auto texture_data = (u8*)malloc(data_size))
-        {
-            ReadBytes(stream, texture_data, data_size);
-            CreateTexture(impl, texture_data, width, height, channels, false, name);
-            free(texture_data);
-        }
-    }
+    LoadTextureLevels(allocator, impl, stream, (TextureFormat)format, channels, mips, name);
 
     return texture;
 }
@@ -368,6 +433,21 @@ int GetBytesPerPixel(TextureFormat format)
     }
 }
 
+bool IsBlockCompressed(TextureFormat format)
+{
+    return format >= TEXTURE_FORMAT_BC1 && format <= TEXTURE_FORMAT_BC7;
+}
+
+// Size of one level in bytes, block compressed levels round up to whole 4x4 blocks
+u32 GetTextureLevelSize(TextureFormat format, u32 width, u32 height)
+{
+    if (!IsBlockCompressed(format))
+        return width * height * GetBytesPerPixel(format);
+
+    u32 block_size = format == TEXTURE_FORMAT_BC1 || format == TEXTURE_FORMAT_BC4 ? 8 : 16;
+    return ((width + 3) / 4) * ((height + 3) / 4) * block_size;
+}
+
 void InitTexture(RendererTraits* traits, SDL_GPUDevice* device)
 {
     g_device = device;
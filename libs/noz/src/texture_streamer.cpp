@@ -0,0 +1,388 @@
+//
+//  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
+//
+//  Large mipped textures keep only their small tail levels resident.  Draws report how many
+//  pixels a texture covers and once per frame the streamer hands the missing levels to a worker
+//  thread that reads them from the asset file, finished reads are swapped in on the main thread.
+//  Upgrades that would exceed the memory budget first drop the least recently used textures back
+//  to their tail, which is kept in memory so that eviction never touches the disk.
+//
+
+constexpr u32 TEXTURE_STREAMING_TAIL_SIZE = 64;
+constexpr int TEXTURE_STREAMING_MAX_READS = 4;
+
+enum TextureReadState
+{
+    texture_read_free,
+    texture_read_queued,
+    texture_read_reading,
+    texture_read_done,
+    texture_read_failed
+};
+
+struct TextureRead
+{
+    TextureReadState state;
+    int texture_index;
+    u32 first_level;
+    size_t reserved_size;
+    u8* data;
+};
+
+struct StreamedTexture
+{
+    Texture* texture;
+    TextureFormat format;
+    char name[128];
+    char path[512];
+    TextureLevel levels[MAX_TEXTURE_LEVELS];
+    u32 level_count;
+    u32 tail_level;
+    u32 resident_level;
+    u32 requested_level;
+    u8* tail_data;
+    u64 last_used_frame;
+    int read;
+};
+
+struct TextureStreamer
+{
+    StreamedTexture* textures;
+    int texture_count;
+    int max_textures;
+    TextureRead reads[TEXTURE_STREAMING_MAX_READS];
+    size_t budget;
+    size_t resident_size;
+    size_t reserved_size;
+    u64 frame;
+    SDL_Thread* thread;
+    SDL_Mutex* mutex;
+    SDL_Condition* condition;
+    bool quit;
+    TextureStreamingStats stats;
+};
+
+static TextureStreamer* g_streamer = nullptr;
+
+// Bytes of the levels from first_level down to the smallest
+static size_t GetLevelsSize(const StreamedTexture& texture, u32 first_level)
+{
+    size_t size = 0;
+    for (u32 level = first_level; level < texture.level_count; level++)
+        size += texture.levels[level].size;
+    return size;
+}
+
+static bool ReadLevels(const StreamedTexture& texture, u32 first_level, u8* data)
+{
+    FILE* file = fopen(texture.path, "rb");
+    if (!file)
+        return false;
+
+    bool result = true;
+    for (u32 level = first_level; result && level < texture.tail_level; level++)
+    {
+        const TextureLevel& l = texture.levels[level];
+        result = fseek(file, (long)l.offset, SEEK_SET) == 0 && fread(data, 1, l.size, file) == l.size;
+        data += l.size;
+    }
+
+    fclose(file);
+
+    if (result)
+        memcpy(data, texture.tail_data, GetLevelsSize(texture, texture.tail_level));
+
+    return result;
+}
+
+static int StreamerThread(void* user_data)
+{
+    (void)user_data;
+
+    SDL_LockMutex(g_streamer->mutex);
+    while (!g_streamer->quit)
+    {
+        TextureRead* read = nullptr;
+        for (int i = 0; !read && i < TEXTURE_STREAMING_MAX_READS; i++)
+            if (g_streamer->reads[i].state == texture_read_queued)
+                read = &g_streamer->reads[i];
+
+        if (!read)
+        {
+            SDL_WaitCondition(g_streamer->condition, g_streamer->mutex);
+            continue;
+        }
+
+        // The texture table entry is never modified while a read is in flight
+        read->state = texture_read_reading;
+        SDL_UnlockMutex(g_streamer->mutex);
+        bool result = ReadLevels(g_streamer->textures[read->texture_index], read->first_level, read->data);
+        SDL_LockMutex(g_streamer->mutex);
+        read->state = result ? texture_read_done : texture_read_failed;
+    }
+    SDL_UnlockMutex(g_streamer->mutex);
+
+    return 0;
+}
+
+static bool SetResidentLevel(StreamedTexture& texture, u32 level, const u8* data)
+{
+    if (!SetTextureLevels(texture.texture, texture.format, texture.levels, level, texture.level_count, data, texture.name))
+        return false;
+
+    g_streamer->resident_size -= GetLevelsSize(texture, texture.resident_level);
+    g_streamer->resident_size += GetLevelsSize(texture, level);
+    texture.resident_level = level;
+    return true;
+}
+
+static void CompleteReads()
+{
+    SDL_LockMutex(g_streamer->mutex);
+    for (int i = 0; i < TEXTURE_STREAMING_MAX_READS; i++)
+    {
+        TextureRead& read = g_streamer->reads[i];
+        if (read.state != texture_read_done && read.state != texture_read_failed)
+            continue;
+
+        StreamedTexture& texture = g_streamer->textures[read.texture_index];
+        if (read.state == texture_read_done)
+            SetResidentLevel(texture, read.first_level, read.data);
+
+        free(read.data);
+        g_streamer->reserved_size -= read.reserved_size;
+        texture.read = -1;
+        read = {};
+    }
+    SDL_UnlockMutex(g_streamer->mutex);
+}
+
+// Drops the least recently used texture that was not drawn last frame back to its tail
+static bool EvictTexture(int keep_index)
+{
+    int evict_index = -1;
+    for (int i = 0; i < g_streamer->texture_count; i++)
+    {
+        StreamedTexture& texture = g_streamer->textures[i];
+        if (i == keep_index ||
+            texture.read != -1 ||
+            texture.resident_level >= texture.tail_level ||
+            texture.last_used_frame >= g_streamer->frame)
+            continue;
+
+        if (evict_index == -1 || texture.last_used_frame < g_streamer->textures[evict_index].last_used_frame)
+            evict_index = i;
+    }
+
+    if (evict_index == -1)
+        return false;
+
+    StreamedTexture& texture = g_streamer->textures[evict_index];
+    if (!SetResidentLevel(texture, texture.tail_level, texture.tail_data))
+        return false;
+
+    g_streamer->stats.evicted_count++;
+    return true;
+}
+
+static int GetFreeRead()
+{
+    for (int i = 0; i < TEXTURE_STREAMING_MAX_READS; i++)
+        if (g_streamer->reads[i].state == texture_read_free)
+            return i;
+
+    return -1;
+}
+
+static void RequestReads()
+{
+    for (int i = 0; i < g_streamer->texture_count; i++)
+    {
+        StreamedTexture& texture = g_streamer->textures[i];
+        if (texture.requested_level >= texture.resident_level || texture.read != -1)
+            continue;
+
+        int read_index = GetFreeRead();
+        if (read_index == -1)
+            return;
+
+        size_t size = GetLevelsSize(texture, texture.requested_level);
+        size_t reserved_size = size - GetLevelsSize(texture, texture.resident_level);
+        while (g_streamer->resident_size + g_streamer->reserved_size + reserved_size > g_streamer->budget && EvictTexture(i))
+        {
+        }
+
+        if (g_streamer->resident_size + g_streamer->reserved_size + reserved_size > g_streamer->budget)
+            continue;
+
+        u8* data = (u8*)malloc(size);
+        if (!data)
+            return;
+
+        SDL_LockMutex(g_streamer->mutex);
+        TextureRead& read = g_streamer->reads[read_index];
+        read.state = texture_read_queued;
+        read.texture_index = i;
+        read.first_level = texture.requested_level;
+        read.reserved_size = reserved_size;
+        read.data = data;
+        SDL_SignalCondition(g_streamer->condition);
+        SDL_UnlockMutex(g_streamer->mutex);
+
+        texture.read = read_index;
+        g_streamer->reserved_size += reserved_size;
+    }
+}
+
+void UpdateTextureStreaming()
+{
+    if (!g_streamer)
+        return;
+
+    CompleteReads();
+    RequestReads();
+
+    int pending_count = 0;
+    for (int i = 0; i < g_streamer->texture_count; i++)
+    {
+        StreamedTexture& texture = g_streamer->textures[i];
+        texture.requested_level = texture.level_count;
+        if (texture.read != -1)
+            pending_count++;
+    }
+
+    g_streamer->stats.resident_size = g_streamer->resident_size;
+    g_streamer->stats.budget = g_streamer->budget;
+    g_streamer->stats.texture_count = (size_t)g_streamer->texture_count;
+    g_streamer->stats.pending_count = (size_t)pending_count;
+    g_streamer->frame++;
+}
+
+// The smallest level that still has at least as many texels across as the draw covers pixels
+void RequestStreamedTextureDetail(int index, float screen_pixels)
+{
+    assert(g_streamer);
+    assert(index >= 0 && index < g_streamer->texture_count);
+
+    StreamedTexture& texture = g_streamer->textures[index];
+    texture.last_used_frame = g_streamer->frame;
+
+    u32 level = 0;
+    while (level + 1 < texture.level_count &&
+           (float)max(texture.levels[level + 1].width, texture.levels[level + 1].height) >= screen_pixels)
+        level++;
+
+    texture.requested_level = min(texture.requested_level, level);
+}
+
+u32 GetStreamingTailLevel(const TextureLevel* levels, u32 level_count)
+{
+    u32 level = 0;
+    while (level + 1 < level_count && max(levels[level].width, levels[level].height) > TEXTURE_STREAMING_TAIL_SIZE)
+        level++;
+
+    return level;
+}
+
+int StreamTexture(
+    Texture* texture,
+    TextureFormat format,
+    const char* name,
+    const TextureLevel* levels,
+    u32 level_count,
+    u32 tail_level,
+    u8* tail_data)
+{
+    assert(g_streamer);
+    assert(tail_level > 0 && tail_level < level_count);
+    assert(tail_data);
+
+    if (g_streamer->texture_count >= g_streamer->max_textures)
+        return -1;
+
+    int index = g_streamer->texture_count;
+    StreamedTexture& streamed = g_streamer->textures[index];
+    streamed = {};
+    streamed.texture = texture;
+    streamed.format = format;
+    SDL_strlcpy(streamed.name, name, sizeof(streamed.name));
+    SDL_strlcpy(streamed.path, GetAssetPath(name, ASSET_SIGNATURE_TEXTURE).string().c_str(), sizeof(streamed.path));
+    memcpy(streamed.levels, levels, sizeof(TextureLevel) * level_count);
+    streamed.level_count = level_count;
+    streamed.tail_level = tail_level;
+    streamed.resident_level = level_count;
+    streamed.requested_level = level_count;
+    streamed.tail_data = tail_data;
+    streamed.read = -1;
+
+    if (!SetResidentLevel(streamed, tail_level, tail_data))
+        return -1;
+
+    g_streamer->texture_count++;
+    return index;
+}
+
+bool IsTextureStreamingEnabled()
+{
+    return g_streamer != nullptr;
+}
+
+TextureStreamingStats GetTextureStreamingStats()
+{
+    return g_streamer ? g_streamer->stats : TextureStreamingStats{};
+}
+
+void InitTextureStreamer(RendererTraits* traits)
+{
+    assert(!g_streamer);
+
+    // A zero budget keeps every texture fully resident
+    if (traits->texture_memory_budget == 0)
+        return;
+
+    g_streamer = (TextureStreamer*)calloc(1, sizeof(TextureStreamer));
+    if (!g_streamer)
+    {
+        ExitOutOfMemory("texture_streamer");
+        return;
+    }
+
+    g_streamer->max_textures = (int)traits->max_textures;
+    g_streamer->textures = (StreamedTexture*)calloc(traits->max_textures, sizeof(StreamedTexture));
+    g_streamer->budget = traits->texture_memory_budget;
+    g_streamer->mutex = SDL_CreateMutex();
+    g_streamer->condition = SDL_CreateCondition();
+    if (!g_streamer->textures || !g_streamer->mutex || !g_streamer->condition)
+    {
+        ExitOutOfMemory("texture_streamer");
+        return;
+    }
+
+    g_streamer->thread = SDL_CreateThread(StreamerThread, "texture_streamer", nullptr);
+    if (!g_streamer->thread)
+        Exit(SDL_GetError());
+}
+
+void ShutdownTextureStreamer()
+{
+    if (!g_streamer)
+        return;
+
+    SDL_LockMutex(g_streamer->mutex);
+    g_streamer->quit = true;
+    SDL_SignalCondition(g_streamer->condition);
+    SDL_UnlockMutex(g_streamer->mutex);
+    SDL_WaitThread(g_streamer->thread, nullptr);
+
+    for (int i = 0; i < TEXTURE_STREAMING_MAX_READS; i++)
+        free(g_streamer->reads[i].data);
+
+    for (int i = 0; i < g_streamer->texture_count; i++)
+        free(g_streamer->textures[i].tail_data);
+
+    SDL_DestroyCondition(g_streamer->condition);
+    SDL_DestroyMutex(g_streamer->mutex);
+    free(g_streamer->textures);
+    free(g_streamer);
+    g_streamer = nullptr;
+}
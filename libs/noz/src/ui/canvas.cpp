@@ -1,4 +1,366 @@
 //
 //  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
 //
+//  Labels of a canvas are baked into one mesh per material and color from their cached text runs,
+//  so text that does not change is drawn from the mesh heap without any layout or upload per
+//  frame.  Changing a label rebakes the canvas, as does a change to the glyphs the glyph cache of
+//  a label font has uploaded or evicted.  Glyph cache cells used by the baked meshes are touched
+//  whenever the canvas is drawn so they are not evicted while the labels still show them.
+//
+
+constexpr int CANVAS_MAX_MESHES = 16;
+constexpr int CANVAS_MAX_VERTICES = 65536;    // keeps the baked meshes on 16 bit indices
+constexpr int CANVAS_MAX_INDICES = CANVAS_MAX_VERTICES / 4 * 6;
+
+struct CanvasLabel
+{
+    Font* font;
+    Material* material;
+    float font_size;
+    char* text;
+    vec2 position;
+    float max_width;
+    TextAlign align;
+    color_t color;
+    u32 glyph_version;
+    int next;
+    bool used;
+    bool processed;
+};
+
+struct CanvasGlyph
+{
+    Font* font;
+    int cell;
+};
+
+struct CanvasMesh
+{
+    Mesh* mesh;
+    Material* material;
+    color_t color;
+};
+
+struct CanvasImpl
+{
+    OBJECT_BASE;
+    CanvasLabel* labels;
+    int label_count;
+    int max_labels;
+    int free_label;
+    CanvasMesh meshes[CANVAS_MAX_MESHES];
+    int mesh_count;
+    CanvasGlyph* glyphs;
+    int glyph_count;
+    int glyph_capacity;
+    MeshBuilder* builder;
+    bool dirty;
+};
+
+static CanvasImpl* Impl(Canvas* c) { return (CanvasImpl*)Cast(c, TYPE_CANVAS); }
+
+static char* CopyText(const char* text)
+{
+    size_t size = strlen(text) + 1;
+    char* copy = (char*)malloc(size);
+    if (copy)
+        memcpy(copy, text, size);
+    return copy;
+}
+
+static CanvasLabel* GetLabel(CanvasImpl* impl, int index)
+{
+    if (index < 0 || index >= impl->label_count || !impl->labels[index].used)
+        return nullptr;
+
+    return &impl->labels[index];
+}
+
+Canvas* CreateCanvas(Allocator* allocator, int max_labels)
+{
+    assert(max_labels > 0);
+
+    auto canvas = (Canvas*)CreateObject(allocator, sizeof(CanvasImpl) + sizeof(CanvasLabel) * max_labels, TYPE_CANVAS);
+    if (!canvas)
+        return nullptr;
+
+    auto impl = Impl(canvas);
+    impl->labels = (CanvasLabel*)(impl + 1);
+    impl->label_count = 0;
+    impl->max_labels = max_labels;
+    impl->free_label = -1;
+    impl->mesh_count = 0;
+    impl->glyphs = nullptr;
+    impl->glyph_count = 0;
+    impl->glyph_capacity = 0;
+    impl->dirty = false;
+    memset(impl->labels, 0, sizeof(CanvasLabel) * max_labels);
+
+    impl->builder = CreateMeshBuilder(allocator, CANVAS_MAX_VERTICES, CANVAS_MAX_INDICES);
+    if (!impl->builder)
+    {
+        Free(allocator, canvas);
+        return nullptr;
+    }
+
+    return canvas;
+}
+
+int AddLabel(
+    Canvas* canvas,
+    Font* font,
+    Material* material,
+    float font_size,
+    const char* text,
+    const vec2& position,
+    color_t color,
+    float max_width,
+    TextAlign align)
+{
+    assert(font);
+    assert(material);
+    assert(text);
+
+    CanvasImpl* impl = Impl(canvas);
+    char* copy = CopyText(text);
+    if (!copy)
+        return -1;
+
+    int index = impl->free_label;
+    if (index != -1)
+        impl->free_label = impl->labels[index].next;
+    else if (impl->label_count < impl->max_labels)
+        index = impl->label_count++;
+    else
+    {
+        free(copy);
+        return -1;
+    }
+
+    CanvasLabel& label = impl->labels[index];
+    label = {};
+    label.font = font;
+    label.material = material;
+    label.font_size = font_size;
+    label.text = copy;
+    label.position = position;
+    label.max_width = max_width;
+    label.align = align;
+    label.color = color;
+    label.next = -1;
+    label.used = true;
+
+    impl->dirty = true;
+    return index;
+}
+
+void RemoveLabel(Canvas* canvas, int index)
+{
+    CanvasImpl* impl = Impl(canvas);
+    CanvasLabel* label = GetLabel(impl, index);
+    if (!label)
+        return;
+
+    free(label->text);
+    label->text = nullptr;
+    label->used = false;
+    label->next = impl->free_label;
+    impl->free_label = index;
+    impl->dirty = true;
+}
+
+// Setting the text a label already shows does not rebake, so labels can be set every frame
+void SetLabelText(Canvas* canvas, int index, const char* text)
+{
+    assert(text);
+
+    CanvasImpl* impl = Impl(canvas);
+    CanvasLabel* label = GetLabel(impl, index);
+    if (!label || strcmp(label->text, text) == 0)
+        return;
+
+    char* copy = CopyText(text);
+    if (!copy)
+        return;
+
+    free(label->text);
+    label->text = copy;
+    impl->dirty = true;
+}
+
+void SetLabelPosition(Canvas* canvas, int index, const vec2& position)
+{
+    CanvasImpl* impl = Impl(canvas);
+    CanvasLabel* label = GetLabel(impl, index);
+    if (!label || label->position == position)
+        return;
+
+    label->position = position;
+    impl->dirty = true;
+}
+
+void SetLabelColor(Canvas* canvas, int index, color_t color)
+{
+    CanvasImpl* impl = Impl(canvas);
+    CanvasLabel* label = GetLabel(impl, index);
+    if (!label || color_equals(&label->color, &color))
+        return;
+
+    label->color = color;
+    impl->dirty = true;
+}
+
+static bool FlushCanvasMesh(CanvasImpl* impl, Material* material, color_t color)
+{
+    if (GetVertexCount(impl->builder) == 0)
+        return true;
+
+    assert(impl->mesh_count < CANVAS_MAX_MESHES);
+    Mesh* mesh = CreateMesh(ALLOCATOR_DEFAULT, impl->builder, "canvas");
+    Clear(impl->builder);
+    if (!mesh)
+        return false;
+
+    impl->meshes[impl->mesh_count++] = { mesh, material, color };
+    return true;
+}
+
+static void AddCanvasGlyph(CanvasImpl* impl, Font* font, int cell)
+{
+    for (int i = 0; i < impl->glyph_count; i++)
+        if (impl->glyphs[i].font == font && impl->glyphs[i].cell == cell)
+            return;
+
+    if (impl->glyph_count == impl->glyph_capacity)
+    {
+        int capacity = max(32, impl->glyph_capacity * 2);
+        CanvasGlyph* glyphs = (CanvasGlyph*)realloc(impl->glyphs, capacity * sizeof(CanvasGlyph));
+        if (!glyphs)
+            return;
+
+        impl->glyphs = glyphs;
+        impl->glyph_capacity = capacity;
+    }
+
+    impl->glyphs[impl->glyph_count++] = { font, cell };
+}
+
+// Returns false when the label did not fit, what was added of it stays in the builder
+static bool AddLabelQuads(CanvasImpl* impl, CanvasLabel& label, Material* material, color_t color)
+{
+    const TextRun* run = LayoutText(label.font, label.font_size, label.text, label.max_width, label.align);
+    label.glyph_version = GetGlyphVersion(label.font);
+
+    for (int i = 0; i < run->quad_count; i++)
+    {
+        // A full builder becomes a mesh of its own as long as one mesh slot is left for the rest
+        if ((int)GetVertexCount(impl->builder) + 4 > CANVAS_MAX_VERTICES &&
+            (impl->mesh_count + 1 >= CANVAS_MAX_MESHES || !FlushCanvasMesh(impl, material, color)))
+            return false;
+
+        const TextQuad& quad = run->quads[i];
+        int cell = GetGlyphCell(label.font, quad.uv_min);
+        if (cell != -1)
+            AddCanvasGlyph(impl, label.font, cell);
+
+        vec2 top_left = label.position + quad.position_min;
+        vec2 bottom_right = label.position + quad.position_max;
+        AddQuad(
+            impl->builder,
+            vec3(top_left.x, top_left.y, 0.0f),
+            vec3(bottom_right.x, top_left.y, 0.0f),
+            vec3(bottom_right.x, bottom_right.y, 0.0f),
+            vec3(top_left.x, bottom_right.y, 0.0f),
+            quad.uv_min,
+            quad.uv_max,
+            VEC3_FORWARD,
+            0);
+    }
+
+    return true;
+}
+
+static void BakeCanvas(CanvasImpl* impl)
+{
+    for (int i = 0; i < impl->mesh_count; i++)
+        Destroy(impl->meshes[i].mesh);
+
+    impl->mesh_count = 0;
+    impl->glyph_count = 0;
+    impl->dirty = false;
+
+    for (int i = 0; i < impl->label_count; i++)
+        impl->labels[i].processed = false;
+
+    // Each pass bakes every label sharing the material and color of the first one left.  Labels
+    // that do not fit once the canvas ran out of meshes are not drawn.
+    for (int first = 0; first < impl->label_count; first++)
+    {
+        CanvasLabel& key = impl->labels[first];
+        if (!key.used || key.processed)
+            continue;
+
+        if (impl->mesh_count >= CANVAS_MAX_MESHES)
+            break;
+
+        Clear(impl->builder);
+        for (int i = first; i < impl->label_count; i++)
+        {
+            CanvasLabel& label = impl->labels[i];
+            if (!label.used || label.processed || label.material != key.material || !color_equals(&label.color, &key.color))
+                continue;
+
+            label.processed = true;
+            if (!AddLabelQuads(impl, label, key.material, key.color))
+                break;
+        }
+
+        FlushCanvasMesh(impl, key.material, key.color);
+    }
+}
+
+void UpdateCanvas(Canvas* canvas)
+{
+    CanvasImpl* impl = Impl(canvas);
+
+    // Glyphs of the glyph cache that finished or were evicted change the texture coordinates
+    // of the labels using them
+    for (int i = 0; !impl->dirty && i < impl->label_count; i++)
+    {
+        CanvasLabel& label = impl->labels[i];
+        impl->dirty = label.used && label.glyph_version != GetGlyphVersion(label.font);
+    }
+
+    if (impl->dirty)
+        BakeCanvas(impl);
+}
+
+// A dirty canvas is rebaked first, the old meshes stay alive until the frame was submitted so
+// draws of the canvas recorded earlier in the frame remain valid
+void DrawCanvas(Canvas* canvas)
+{
+    UpdateCanvas(canvas);
+
+    CanvasImpl* impl = Impl(canvas);
+    for (int i = 0; i < impl->glyph_count; i++)
+        TouchGlyphCell(impl->glyphs[i].font, impl->glyphs[i].cell);
+
+    Material* bound_material = nullptr;
+    color_t bound_color = {};
+
+    // Baked meshes are already in canvas space
+    BindTransform(identity<mat4>());
+    for (int i = 0; i < impl->mesh_count; i++)
+    {
+        CanvasMesh& canvas_mesh = impl->meshes[i];
+        if (canvas_mesh.material != bound_material || !color_equals(&canvas_mesh.color, &bound_color))
+        {
+            BindColor(canvas_mesh.color);
+            BindMaterial(canvas_mesh.material);
+            bound_material = canvas_mesh.material;
+            bound_color = canvas_mesh.color;
+        }
 
+        DrawMesh(canvas_mesh.mesh);
+    }
+}
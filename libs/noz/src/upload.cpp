@@ -0,0 +1,318 @@
+//
+//  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
+//
+//  Staging ring for buffer and texture uploads.  Uploads are written straight into a mapped
+//  staging block and queued, a flush records every queued copy into a single copy pass and
+//  submits it with a fence.  Blocks are reused round robin and a block is only remapped once
+//  the fence of its previous submit has signaled.
+//
+
+#define STAGING_BLOCK_COUNT 3
+#define STAGING_ALIGNMENT 16
+#define STAGING_TEXTURE_ALIGNMENT 512
+#define MAX_PENDING_UPLOADS 256
+
+enum UploadType
+{
+    upload_type_buffer,
+    upload_type_texture
+};
+
+struct PendingUpload
+{
+    UploadType type;
+    SDL_GPUTransferBuffer* transfer;
+    u32 offset;
+    u32 size;
+    SDL_GPUBuffer* buffer;
+    u32 buffer_offset;
+    SDL_GPUTexture* texture;
+    u32 mip_level;
+    u32 x;
+    u32 y;
+    u32 width;
+    u32 height;
+};
+
+struct StagingBlock
+{
+    SDL_GPUTransferBuffer* transfer;
+    SDL_GPUFence* fence;
+};
+
+struct UploadQueue
+{
+    StagingBlock blocks[STAGING_BLOCK_COUNT];
+    int block_index;
+    u8* mapped;
+    u32 block_size;
+    u32 used;
+    PendingUpload pending[MAX_PENDING_UPLOADS];
+    size_t pending_count;
+
+    // transfer buffers created for uploads larger than a block, released after the flush
+    SDL_GPUTransferBuffer* oversized[MAX_PENDING_UPLOADS];
+    size_t oversized_count;
+
+    UploadStats frame_stats;
+    UploadStats stats;
+};
+
+static SDL_GPUDevice* g_device = nullptr;
+static UploadQueue* g_upload = nullptr;
+
+static StagingBlock& GetCurrentBlock()
+{
+    return g_upload->blocks[g_upload->block_index];
+}
+
+static bool MapCurrentBlock()
+{
+    if (g_upload->mapped)
+        return true;
+
+    // Wait for the last submit that used this block before writing into it again
+    StagingBlock& block = GetCurrentBlock();
+    if (block.fence)
+    {
+        SDL_WaitForGPUFences(g_device, true, &block.fence, 1);
+        SDL_ReleaseGPUFence(g_device, block.fence);
+        block.fence = nullptr;
+    }
+
+    g_upload->mapped = (u8*)SDL_MapGPUTransferBuffer(g_device, block.transfer, false);
+    g_upload->used = 0;
+    return g_upload->mapped != nullptr;
+}
+
+static void* AllocStaging(u32 size, u32 alignment, SDL_GPUTransferBuffer** transfer, u32* offset)
+{
+    // Uploads that can never fit in a block get a dedicated transfer buffer
+    if (size > g_upload->block_size)
+    {
+        if (g_upload->pending_count == MAX_PENDING_UPLOADS || g_upload->oversized_count == MAX_PENDING_UPLOADS)
+            FlushUploads();
+
+        SDL_GPUTransferBufferCreateInfo info = {};
+        info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+        info.size = size;
+        SDL_GPUTransferBuffer* oversized = SDL_CreateGPUTransferBuffer(g_device, &info);
+        if (!oversized)
+            return nullptr;
+
+        g_upload->oversized[g_upload->oversized_count++] = oversized;
+        *transfer = oversized;
+        *offset = 0;
+
+        // oversized buffers are only mapped until the caller has written the data, the unmap
+        // happens at flush time
+        return SDL_MapGPUTransferBuffer(g_device, oversized, false);
+    }
+
+    u32 aligned = (g_upload->used + alignment - 1) & ~(alignment - 1);
+    if (g_upload->pending_count == MAX_PENDING_UPLOADS || (g_upload->mapped && aligned + size > g_upload->block_size))
+        FlushUploads();
+
+    if (!MapCurrentBlock())
+        return nullptr;
+
+    aligned = (g_upload->used + alignment - 1) & ~(alignment - 1);
+    g_upload->used = aligned + size;
+    *transfer = GetCurrentBlock().transfer;
+    *offset = aligned;
+    return g_upload->mapped + aligned;
+}
+
+void* UploadToBufferGPU(SDL_GPUBuffer* buffer, u32 buffer_offset, u32 size)
+{
+    assert(g_upload);
+    assert(buffer);
+
+    if (size == 0)
+        return nullptr;
+
+    SDL_GPUTransferBuffer* transfer;
+    u32 offset;
+    void* data = AllocStaging(size, STAGING_ALIGNMENT, &transfer, &offset);
+    if (!data)
+        return nullptr;
+
+    PendingUpload& upload = g_upload->pending[g_upload->pending_count++];
+    upload = {};
+    upload.type = upload_type_buffer;
+    upload.transfer = transfer;
+    upload.offset = offset;
+    upload.size = size;
+    upload.buffer = buffer;
+    upload.buffer_offset = buffer_offset;
+    return data;
+}
+
+void* UploadToTextureGPU(SDL_GPUTexture* texture, u32 mip_level, u32 width, u32 height, u32 size)
+{
+    return UploadToTextureRegionGPU(texture, mip_level, 0, 0, width, height, size);
+}
+
+void* UploadToTextureRegionGPU(SDL_GPUTexture* texture, u32 mip_level, u32 x, u32 y, u32 width, u32 height, u32 size)
+{
+    assert(g_upload);
+    assert(texture);
+
+    if (size == 0)
+        return nullptr;
+
+    SDL_GPUTransferBuffer* transfer;
+    u32 offset;
+    void* data = AllocStaging(size, STAGING_TEXTURE_ALIGNMENT, &transfer, &offset);
+    if (!data)
+        return nullptr;
+
+    PendingUpload& upload = g_upload->pending[g_upload->pending_count++];
+    upload = {};
+    upload.type = upload_type_texture;
+    upload.transfer = transfer;
+    upload.offset = offset;
+    upload.size = size;
+    upload.texture = texture;
+    upload.mip_level = mip_level;
+    upload.x = x;
+    upload.y = y;
+    upload.width = width;
+    upload.height = height;
+    return data;
+}
+
+void FlushUploads()
+{
+    assert(g_upload);
+
+    if (g_upload->pending_count == 0)
+        return;
+
+    // Flushes of oversized uploads alone never touched the current block
+    bool block_used = g_upload->mapped != nullptr;
+    if (block_used)
+    {
+        SDL_UnmapGPUTransferBuffer(g_device, GetCurrentBlock().transfer);
+        g_upload->mapped = nullptr;
+    }
+
+    for (size_t i = 0; i < g_upload->oversized_count; i++)
+        SDL_UnmapGPUTransferBuffer(g_device, g_upload->oversized[i]);
+
+    SDL_GPUCommandBuffer* cb = SDL_AcquireGPUCommandBuffer(g_device);
+    if (!cb)
+        Exit(SDL_GetError());
+
+    SDL_GPUCopyPass* copy_pass = SDL_BeginGPUCopyPass(cb);
+    size_t bytes = 0;
+    for (size_t i = 0; i < g_upload->pending_count; i++)
+    {
+        const PendingUpload& upload = g_upload->pending[i];
+        if (upload.type == upload_type_buffer)
+        {
+            SDL_GPUTransferBufferLocation source = {upload.transfer, upload.offset};
+            SDL_GPUBufferRegion dest = {upload.buffer, upload.buffer_offset, upload.size};
+            SDL_UploadToGPUBuffer(copy_pass, &source, &dest, false);
+        }
+        else
+        {
+            SDL_GPUTextureTransferInfo source = {upload.transfer, upload.offset, upload.width, upload.height};
+            SDL_GPUTextureRegion dest = {};
+            dest.texture = upload.texture;
+            dest.mip_level = upload.mip_level;
+            dest.x = upload.x;
+            dest.y = upload.y;
+            dest.w = upload.width;
+            dest.h = upload.height;
+            dest.d = 1;
+            SDL_UploadToGPUTexture(copy_pass, &source, &dest, false);
+        }
+
+        bytes += upload.size;
+    }
+    SDL_EndGPUCopyPass(copy_pass);
+
+    // The fence tells us when the block can be written again, mapping it waited on the fence of
+    // its previous submit so none is left to overwrite
+    if (block_used)
+    {
+        StagingBlock& block = GetCurrentBlock();
+        assert(!block.fence);
+        block.fence = SDL_SubmitGPUCommandBufferAndAcquireFence(cb);
+        g_upload->block_index = (g_upload->block_index + 1) % STAGING_BLOCK_COUNT;
+    }
+    else
+        SDL_SubmitGPUCommandBuffer(cb);
+
+    // Releasing is deferred by SDL until the copy has finished
+    for (size_t i = 0; i < g_upload->oversized_count; i++)
+        SDL_ReleaseGPUTransferBuffer(g_device, g_upload->oversized[i]);
+
+    g_upload->frame_stats.bytes_uploaded += bytes;
+    g_upload->frame_stats.upload_count += g_upload->pending_count;
+    g_upload->frame_stats.flush_count++;
+    g_upload->pending_count = 0;
+    g_upload->oversized_count = 0;
+    g_upload->used = 0;
+}
+
+void EndUploadFrame()
+{
+    FlushUploads();
+    g_upload->stats = g_upload->frame_stats;
+    g_upload->frame_stats = {};
+}
+
+UploadStats GetUploadStats()
+{
+    return g_upload->stats;
+}
+
+void InitUpload(RendererTraits* traits, SDL_GPUDevice* device)
+{
+    assert(!g_upload);
+
+    g_device = device;
+    g_upload = (UploadQueue*)calloc(1, sizeof(UploadQueue));
+    if (!g_upload)
+    {
+        ExitOutOfMemory("upload");
+        return;
+    }
+
+    g_upload->block_size = (u32)(traits->staging_memory_size / STAGING_BLOCK_COUNT);
+
+    SDL_GPUTransferBufferCreateInfo info = {};
+    info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+    info.size = g_upload->block_size;
+    for (int i = 0; i < STAGING_BLOCK_COUNT; i++)
+    {
+        g_upload->blocks[i].transfer = SDL_CreateGPUTransferBuffer(device, &info);
+        if (!g_upload->blocks[i].transfer)
+            Exit(SDL_GetError());
+    }
+}
+
+void ShutdownUpload()
+{
+    assert(g_upload);
+
+    FlushUploads();
+
+    for (int i = 0; i < STAGING_BLOCK_COUNT; i++)
+    {
+        StagingBlock& block = g_upload->blocks[i];
+        if (block.fence)
+        {
+            SDL_WaitForGPUFences(g_device, true, &block.fence, 1);
+            SDL_ReleaseGPUFence(g_device, block.fence);
+        }
+
+        SDL_ReleaseGPUTransferBuffer(g_device, block.transfer);
+    }
+
+    free(g_upload);
+    g_upload = nullptr;
+    g_device = nullptr;
+}
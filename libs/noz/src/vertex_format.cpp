@@ -0,0 +1,171 @@
+//
+//  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
+//
+//  Compact vertex formats.  Both compact formats share the mesh_vertex_compact layout and only
+//  differ in how the position is stored.  The vertex shader undoes the position encoding with the
+//  per draw scale and offset returned by GetPositionDecode.
+//
+
+#include <glm/gtc/packing.hpp>
+
+static u16 PackUnorm16(float value)
+{
+    return (u16)(clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+static i16 PackSnorm16(float value)
+{
+    return (i16)round(clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+static float UnpackSnorm16(i16 value)
+{
+    return max((float)value / 32767.0f, -1.0f);
+}
+
+static vec2 EncodeOctahedral(const vec3& normal)
+{
+    float sum = abs(normal.x) + abs(normal.y) + abs(normal.z);
+    if (sum <= 0.0f)
+        return vec2(0.0f);
+
+    vec3 n = normal / sum;
+    if (n.z >= 0.0f)
+        return vec2(n.x, n.y);
+
+    // Fold the lower hemisphere over the diagonals
+    return vec2(
+        (1.0f - abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+        (1.0f - abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+static vec3 DecodeOctahedral(const vec2& encoded)
+{
+    vec3 n = vec3(encoded.x, encoded.y, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float t = max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+u32 GetVertexStride(VertexFormat format)
+{
+    switch (format)
+    {
+    case VERTEX_FORMAT_HALF:
+    case VERTEX_FORMAT_UNORM16:
+        return sizeof(mesh_vertex_compact);
+
+    case VERTEX_FORMAT_FLOAT:
+    default:
+        return sizeof(mesh_vertex);
+    }
+}
+
+void GetPositionDecode(VertexFormat format, const bounds3& bounds, vec4* scale, vec4* offset)
+{
+    assert(scale);
+    assert(offset);
+
+    // Half positions and the float format are used as is.  Normalized positions are expanded back
+    // to the bounds and the bone index in w back to 0..65535.
+    if (format != VERTEX_FORMAT_UNORM16)
+    {
+        *scale = vec4(1.0f);
+        *offset = vec4(0.0f);
+        return;
+    }
+
+    *scale = vec4(bounds.max - bounds.min, 65535.0f);
+    *offset = vec4(bounds.min, 0.0f);
+}
+
+void EncodeVertices(VertexFormat format, const bounds3& bounds, const mesh_vertex* vertices, size_t count, void* output)
+{
+    assert(vertices);
+    assert(output);
+
+    if (format == VERTEX_FORMAT_FLOAT)
+    {
+        memcpy(output, vertices, sizeof(mesh_vertex) * count);
+        return;
+    }
+
+    vec3 size = bounds.max - bounds.min;
+    vec3 inv_size = vec3(
+        size.x > 0.0f ? 1.0f / size.x : 0.0f,
+        size.y > 0.0f ? 1.0f / size.y : 0.0f,
+        size.z > 0.0f ? 1.0f / size.z : 0.0f);
+
+    mesh_vertex_compact* compact = (mesh_vertex_compact*)output;
+    for (size_t i = 0; i < count; i++)
+    {
+        const mesh_vertex& v = vertices[i];
+        mesh_vertex_compact& c = compact[i];
+
+        if (format == VERTEX_FORMAT_UNORM16)
+        {
+            vec3 t = (v.position - bounds.min) * inv_size;
+            c.position[0] = PackUnorm16(t.x);
+            c.position[1] = PackUnorm16(t.y);
+            c.position[2] = PackUnorm16(t.z);
+            c.position[3] = (u16)v.bone;
+        }
+        else
+        {
+            c.position[0] = packHalf1x16(v.position.x);
+            c.position[1] = packHalf1x16(v.position.y);
+            c.position[2] = packHalf1x16(v.position.z);
+            c.position[3] = packHalf1x16(v.bone);
+        }
+
+        c.uv0[0] = packHalf1x16(v.uv0.x);
+        c.uv0[1] = packHalf1x16(v.uv0.y);
+
+        vec2 normal = EncodeOctahedral(v.normal);
+        c.normal[0] = PackSnorm16(normal.x);
+        c.normal[1] = PackSnorm16(normal.y);
+    }
+}
+
+void DecodeVertices(VertexFormat format, const bounds3& bounds, const void* data, size_t count, mesh_vertex* output)
+{
+    assert(data);
+    assert(output);
+
+    if (format == VERTEX_FORMAT_FLOAT)
+    {
+        memmove(output, data, sizeof(mesh_vertex) * count);
+        return;
+    }
+
+    // Decoding front to back lets the compact data sit in the tail of the output array, each
+    // decoded vertex only overwrites compact vertices that were already read.
+    vec3 size = bounds.max - bounds.min;
+    const mesh_vertex_compact* compact = (const mesh_vertex_compact*)data;
+    for (size_t i = 0; i < count; i++)
+    {
+        mesh_vertex_compact c = compact[i];
+        mesh_vertex& v = output[i];
+
+        if (format == VERTEX_FORMAT_UNORM16)
+        {
+            v.position = bounds.min + size * vec3(
+                c.position[0] / 65535.0f,
+                c.position[1] / 65535.0f,
+                c.position[2] / 65535.0f);
+            v.bone = (float)c.position[3];
+        }
+        else
+        {
+            v.position = vec3(
+                unpackHalf1x16(c.position[0]),
+                unpackHalf1x16(c.position[1]),
+                unpackHalf1x16(c.position[2]));
+            v.bone = unpackHalf1x16(c.position[3]);
+        }
+
+        v.uv0 = vec2(unpackHalf1x16(c.uv0[0]), unpackHalf1x16(c.uv0[1]));
+        v.normal = DecodeOctahedral(vec2(UnpackSnorm16(c.normal[0]), UnpackSnorm16(c.normal[1])));
+    }
+}
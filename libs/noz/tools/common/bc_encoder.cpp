@@ -0,0 +1,586 @@
+//
+//  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
+//
+//  Block encoders fit the endpoints along the principal axis of the block and pick the nearest
+//  palette entry per texel.  BC1 endpoints get one least squares refit, BC7 only uses mode 6
+//  (one subset, RGBA endpoints with p-bits and 16 interpolated colors) which is a good match
+//  for the smooth textures we ship and keeps the encoder small.  The endpoint search and the
+//  palette index selection have SSE2 paths that produce the same blocks as the scalar code.
+//
+
+#include "bc_encoder.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define NOZ_BC_SSE2 1
+#endif
+
+struct BlockBits
+{
+    uint8_t* data;
+    int position;
+};
+
+static void WriteBits(BlockBits& bits, uint32_t value, int count)
+{
+    for (int i = 0; i < count; i++, bits.position++)
+        if (value & (1u << i))
+            bits.data[bits.position >> 3] |= (uint8_t)(1u << (bits.position & 7));
+}
+
+// Fetches a 4x4 block, texels past the edge of the image repeat the last row or column
+static void LoadBlock(const uint8_t* rgba, int width, int height, int block_x, int block_y, uint8_t block[16][4])
+{
+    for (int y = 0; y < 4; y++)
+    {
+        int sy = std::min(block_y * 4 + y, height - 1);
+        for (int x = 0; x < 4; x++)
+        {
+            int sx = std::min(block_x * 4 + x, width - 1);
+            memcpy(block[y * 4 + x], rgba + ((size_t)sy * width + sx) * 4, 4);
+        }
+    }
+}
+
+// Principal axis of the block colors over the first channel_count channels
+static void GetPrincipalAxis(const uint8_t block[16][4], int channel_count, float mean[4], float axis[4])
+{
+    for (int c = 0; c < 4; c++)
+    {
+        mean[c] = 0.0f;
+        axis[c] = 0.0f;
+    }
+
+    float covariance[4][4] = {};
+
+#if NOZ_BC_SSE2
+    // One texel per register, lanes past channel_count are masked to zero.  Every lane sums in
+    // the same order as the scalar loops so both paths produce the same endpoints.
+    const __m128 lane_mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, channel_count == 4 ? -1 : 0));
+    __m128 texels[16];
+    __m128 sum = _mm_setzero_ps();
+    for (int i = 0; i < 16; i++)
+    {
+        texels[i] = _mm_cvtepi32_ps(_mm_setr_epi32(block[i][0], block[i][1], block[i][2], block[i][3]));
+        sum = _mm_add_ps(sum, texels[i]);
+    }
+
+    __m128 mean4 = _mm_and_ps(_mm_div_ps(sum, _mm_set1_ps(16.0f)), lane_mask);
+    __m128 rows[4] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()};
+    for (int i = 0; i < 16; i++)
+    {
+        __m128 d = _mm_and_ps(_mm_sub_ps(texels[i], mean4), lane_mask);
+        rows[0] = _mm_add_ps(rows[0], _mm_mul_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(0, 0, 0, 0))));
+        rows[1] = _mm_add_ps(rows[1], _mm_mul_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 1, 1, 1))));
+        rows[2] = _mm_add_ps(rows[2], _mm_mul_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 2, 2, 2))));
+        rows[3] = _mm_add_ps(rows[3], _mm_mul_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(3, 3, 3, 3))));
+    }
+
+    _mm_storeu_ps(mean, mean4);
+    for (int a = 0; a < 4; a++)
+        _mm_storeu_ps(covariance[a], rows[a]);
+#else
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < channel_count; c++)
+            mean[c] += block[i][c];
+
+    for (int c = 0; c < channel_count; c++)
+        mean[c] /= 16.0f;
+
+    for (int i = 0; i < 16; i++)
+        for (int a = 0; a < channel_count; a++)
+            for (int b = 0; b < channel_count; b++)
+                covariance[a][b] += (block[i][a] - mean[a]) * (block[i][b] - mean[b]);
+#endif
+
+    // Power iteration, starting from the diagonal keeps it away from a zero vector
+    for (int c = 0; c < channel_count; c++)
+        axis[c] = covariance[c][c];
+
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[4] = {};
+        for (int a = 0; a < channel_count; a++)
+            for (int b = 0; b < channel_count; b++)
+                next[a] += covariance[a][b] * axis[b];
+
+        float length = 0.0f;
+        for (int c = 0; c < channel_count; c++)
+            length = std::max(length, std::abs(next[c]));
+
+        if (length < 1e-6f)
+            break;
+
+        for (int c = 0; c < channel_count; c++)
+            axis[c] = next[c] / length;
+    }
+}
+
+// Projects the block on its principal axis and returns the two extremes
+static void GetAxisEndpoints(const uint8_t block[16][4], int channel_count, float e0[4], float e1[4])
+{
+    float mean[4];
+    float axis[4];
+    GetPrincipalAxis(block, channel_count, mean, axis);
+
+    float axis_length = 0.0f;
+    for (int c = 0; c < channel_count; c++)
+        axis_length += axis[c] * axis[c];
+
+    float min_t = 0.0f;
+    float max_t = 0.0f;
+    if (axis_length > 1e-12f)
+    {
+        min_t = FLT_MAX;
+        max_t = -FLT_MAX;
+
+#if NOZ_BC_SSE2
+        // Four texels per register with one channel each, masked channels add exact zeros
+        __m128 min4 = _mm_set1_ps(FLT_MAX);
+        __m128 max4 = _mm_set1_ps(-FLT_MAX);
+        __m128 length4 = _mm_set1_ps(axis_length);
+        for (int i = 0; i < 16; i += 4)
+        {
+            __m128 t = _mm_setzero_ps();
+            for (int c = 0; c < channel_count; c++)
+            {
+                __m128 values = _mm_cvtepi32_ps(_mm_setr_epi32(block[i][c], block[i + 1][c], block[i + 2][c], block[i + 3][c]));
+                __m128 d = _mm_sub_ps(values, _mm_set1_ps(mean[c]));
+                t = _mm_add_ps(t, _mm_mul_ps(d, _mm_set1_ps(axis[c])));
+            }
+
+            t = _mm_div_ps(t, length4);
+            min4 = _mm_min_ps(min4, t);
+            max4 = _mm_max_ps(max4, t);
+        }
+
+        float lanes_min[4];
+        float lanes_max[4];
+        _mm_storeu_ps(lanes_min, min4);
+        _mm_storeu_ps(lanes_max, max4);
+        for (int i = 0; i < 4; i++)
+        {
+            min_t = std::min(min_t, lanes_min[i]);
+            max_t = std::max(max_t, lanes_max[i]);
+        }
+#else
+        for (int i = 0; i < 16; i++)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < channel_count; c++)
+                t += (block[i][c] - mean[c]) * axis[c];
+            t /= axis_length;
+            min_t = std::min(min_t, t);
+            max_t = std::max(max_t, t);
+        }
+#endif
+    }
+
+    for (int c = 0; c < 4; c++)
+    {
+        e0[c] = std::clamp(mean[c] + axis[c] * max_t, 0.0f, 255.0f);
+        e1[c] = std::clamp(mean[c] + axis[c] * min_t, 0.0f, 255.0f);
+    }
+}
+
+// Picks the nearest palette entry for every texel and returns the total squared error.  Ties go
+// to the lowest palette index.
+static int SelectPaletteIndices(
+    const uint8_t block[16][4],
+    const int palette[][4],
+    int palette_size,
+    int channel_count,
+    int indices[16])
+{
+#if NOZ_BC_SSE2
+    // Texels are widened to 16 bit lanes so one madd yields the squared distance of two channels
+    // of two texels, four texels are scored against a palette entry at a time
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i channel_mask = _mm_setr_epi16(-1, -1, -1, channel_count == 4 ? -1 : 0, -1, -1, -1, channel_count == 4 ? -1 : 0);
+    int total_error = 0;
+    for (int i = 0; i < 16; i += 4)
+    {
+        __m128i texels = _mm_loadu_si128((const __m128i*)block[i]);
+        __m128i lo = _mm_unpacklo_epi8(texels, zero);
+        __m128i hi = _mm_unpackhi_epi8(texels, zero);
+        __m128i best_error = _mm_set1_epi32(INT_MAX);
+        __m128i best_index = zero;
+        for (int p = 0; p < palette_size; p++)
+        {
+            const int* entry = palette[p];
+            __m128i color = _mm_setr_epi16(
+                (short)entry[0], (short)entry[1], (short)entry[2], (short)entry[3],
+                (short)entry[0], (short)entry[1], (short)entry[2], (short)entry[3]);
+            __m128i d_lo = _mm_and_si128(_mm_sub_epi16(lo, color), channel_mask);
+            __m128i d_hi = _mm_and_si128(_mm_sub_epi16(hi, color), channel_mask);
+            __m128 pairs_lo = _mm_castsi128_ps(_mm_madd_epi16(d_lo, d_lo));
+            __m128 pairs_hi = _mm_castsi128_ps(_mm_madd_epi16(d_hi, d_hi));
+            __m128i error = _mm_add_epi32(
+                _mm_castps_si128(_mm_shuffle_ps(pairs_lo, pairs_hi, _MM_SHUFFLE(2, 0, 2, 0))),
+                _mm_castps_si128(_mm_shuffle_ps(pairs_lo, pairs_hi, _MM_SHUFFLE(3, 1, 3, 1))));
+
+            __m128i better = _mm_cmplt_epi32(error, best_error);
+            best_error = _mm_or_si128(_mm_and_si128(better, error), _mm_andnot_si128(better, best_error));
+            best_index = _mm_or_si128(_mm_and_si128(better, _mm_set1_epi32(p)), _mm_andnot_si128(better, best_index));
+        }
+
+        int errors[4];
+        _mm_storeu_si128((__m128i*)errors, best_error);
+        _mm_storeu_si128((__m128i*)(indices + i), best_index);
+        total_error += errors[0] + errors[1] + errors[2] + errors[3];
+    }
+
+    return total_error;
+#else
+    int total_error = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int best_error = INT_MAX;
+        for (int p = 0; p < palette_size; p++)
+        {
+            int error = 0;
+            for (int c = 0; c < channel_count; c++)
+            {
+                int d = block[i][c] - palette[p][c];
+                error += d * d;
+            }
+
+            if (error < best_error)
+            {
+                best_error = error;
+                indices[i] = p;
+            }
+        }
+
+        total_error += best_error;
+    }
+
+    return total_error;
+#endif
+}
+
+// @bc1
+static uint16_t PackColor565(const float color[3])
+{
+    int r = std::clamp((int)(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+    int g = std::clamp((int)(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+    int b = std::clamp((int)(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void UnpackColor565(uint16_t packed, int color[4])
+{
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+    color[3] = 255;
+}
+
+// Chooses the indices for a pair of endpoints in four color mode and returns the total error
+static int GetColorIndices(const uint8_t block[16][4], uint16_t c0, uint16_t c1, uint32_t* indices)
+{
+    int palette[4][4];
+    UnpackColor565(c0, palette[0]);
+    UnpackColor565(c1, palette[1]);
+    for (int c = 0; c < 3; c++)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    palette[2][3] = 255;
+    palette[3][3] = 255;
+
+    int selected[16];
+    int total_error = SelectPaletteIndices(block, palette, 4, 3, selected);
+
+    *indices = 0;
+    for (int i = 0; i < 16; i++)
+        *indices |= (uint32_t)selected[i] << (i * 2);
+
+    return total_error;
+}
+
+// Solves the endpoints that best reproduce the block for the given indices
+static bool RefitColorEndpoints(const uint8_t block[16][4], uint32_t indices, float e0[3], float e1[3])
+{
+    static const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+    float aa = 0.0f;
+    float bb = 0.0f;
+    float ab = 0.0f;
+    float ax[3] = {};
+    float bx[3] = {};
+    for (int i = 0; i < 16; i++)
+    {
+        float a = weights[(indices >> (i * 2)) & 3];
+        float b = 1.0f - a;
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        for (int c = 0; c < 3; c++)
+        {
+            ax[c] += a * block[i][c];
+            bx[c] += b * block[i][c];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (std::abs(determinant) < 1e-6f)
+        return false;
+
+    for (int c = 0; c < 3; c++)
+    {
+        e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+        e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+    }
+
+    return true;
+}
+
+static void EncodeColorBlock(const uint8_t block[16][4], uint8_t* output)
+{
+    float e0[4];
+    float e1[4];
+    GetAxisEndpoints(block, 3, e0, e1);
+
+    uint16_t c0 = PackColor565(e0);
+    uint16_t c1 = PackColor565(e1);
+    uint32_t indices = 0;
+    int error = GetColorIndices(block, c0, c1, &indices);
+
+    if (c0 != c1 && RefitColorEndpoints(block, indices, e0, e1))
+    {
+        uint16_t refit_c0 = PackColor565(e0);
+        uint16_t refit_c1 = PackColor565(e1);
+        uint32_t refit_indices;
+        int refit_error = GetColorIndices(block, refit_c0, refit_c1, &refit_indices);
+        if (refit_error < error)
+        {
+            c0 = refit_c0;
+            c1 = refit_c1;
+            indices = refit_indices;
+        }
+    }
+
+    // Four color mode needs c0 > c1, swapping the endpoints swaps indices 0/1 and 2/3
+    if (c0 < c1)
+    {
+        std::swap(c0, c1);
+        indices ^= 0x55555555;
+    }
+    else if (c0 == c1)
+        indices = 0;
+
+    output[0] = (uint8_t)(c0 & 0xFF);
+    output[1] = (uint8_t)(c0 >> 8);
+    output[2] = (uint8_t)(c1 & 0xFF);
+    output[3] = (uint8_t)(c1 >> 8);
+    memcpy(output + 4, &indices, 4);
+}
+
+// @bc4
+static void EncodeChannelBlock(const uint8_t block[16][4], int channel, uint8_t* output)
+{
+    int a0 = 0;
+    int a1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        a0 = std::max(a0, (int)block[i][channel]);
+        a1 = std::min(a1, (int)block[i][channel]);
+    }
+
+    memset(output, 0, 8);
+    output[0] = (uint8_t)a0;
+    output[1] = (uint8_t)a1;
+    if (a0 == a1)
+        return;
+
+    // Eight value mode, a0 > a1
+    int palette[8];
+    palette[0] = a0;
+    palette[1] = a1;
+    for (int p = 2; p < 8; p++)
+        palette[p] = ((8 - p) * a0 + (p - 1) * a1) / 7;
+
+    BlockBits bits = {output, 16};
+    for (int i = 0; i < 16; i++)
+    {
+        int value = block[i][channel];
+        int best = 0;
+        int best_error = INT_MAX;
+        for (int p = 0; p < 8; p++)
+        {
+            int error = std::abs(value - palette[p]);
+            if (error < best_error)
+            {
+                best_error = error;
+                best = p;
+            }
+        }
+        WriteBits(bits, (uint32_t)best, 3);
+    }
+}
+
+// @bc7
+static const int BC7_WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Quantizes an endpoint to 7 bits per channel plus a shared p-bit, trying both p-bits
+static void QuantizeEndpointBC7(const float endpoint[4], int quantized[4], int* pbit)
+{
+    int best_error = INT_MAX;
+    for (int p = 0; p < 2; p++)
+    {
+        int candidate[4];
+        int error = 0;
+        for (int c = 0; c < 4; c++)
+        {
+            candidate[c] = std::clamp((int)((endpoint[c] - p) / 2.0f + 0.5f), 0, 127);
+            int d = ((candidate[c] << 1) | p) - (int)(endpoint[c] + 0.5f);
+            error += d * d;
+        }
+
+        if (error < best_error)
+        {
+            best_error = error;
+            *pbit = p;
+            memcpy(quantized, candidate, sizeof(candidate));
+        }
+    }
+}
+
+static void EncodeBlockBC7(const uint8_t block[16][4], uint8_t* output)
+{
+    float e0[4];
+    float e1[4];
+    GetAxisEndpoints(block, 4, e0, e1);
+
+    int q[2][4];
+    int pbit[2];
+    QuantizeEndpointBC7(e0, q[0], &pbit[0]);
+    QuantizeEndpointBC7(e1, q[1], &pbit[1]);
+
+    int endpoints[2][4];
+    for (int c = 0; c < 4; c++)
+    {
+        endpoints[0][c] = (q[0][c] << 1) | pbit[0];
+        endpoints[1][c] = (q[1][c] << 1) | pbit[1];
+    }
+
+    int palette[16][4];
+    for (int p = 0; p < 16; p++)
+        for (int c = 0; c < 4; c++)
+            palette[p][c] = ((64 - BC7_WEIGHTS4[p]) * endpoints[0][c] + BC7_WEIGHTS4[p] * endpoints[1][c] + 32) >> 6;
+
+    int indices[16];
+    SelectPaletteIndices(block, palette, 16, 4, indices);
+
+    // The first index is stored without its top bit, swapping the endpoints mirrors the indices
+    if (indices[0] & 8)
+    {
+        std::swap(q[0], q[1]);
+        std::swap(pbit[0], pbit[1]);
+        for (int i = 0; i < 16; i++)
+            indices[i] = 15 - indices[i];
+    }
+
+    memset(output, 0, 16);
+    BlockBits bits = {output, 0};
+    WriteBits(bits, 1 << 6, 7);
+    for (int c = 0; c < 4; c++)
+    {
+        WriteBits(bits, (uint32_t)q[0][c], 7);
+        WriteBits(bits, (uint32_t)q[1][c], 7);
+    }
+    WriteBits(bits, (uint32_t)pbit[0], 1);
+    WriteBits(bits, (uint32_t)pbit[1], 1);
+    WriteBits(bits, (uint32_t)indices[0], 3);
+    for (int i = 1; i < 16; i++)
+        WriteBits(bits, (uint32_t)indices[i], 4);
+}
+
+// @compress
+static int GetBlockSize(TextureFormat format)
+{
+    return format == TEXTURE_FORMAT_BC1 || format == TEXTURE_FORMAT_BC4 ? 8 : 16;
+}
+
+static void EncodeBlock(TextureFormat format, const uint8_t block[16][4], uint8_t* output)
+{
+    switch (format)
+    {
+    case TEXTURE_FORMAT_BC1:
+        EncodeColorBlock(block, output);
+        break;
+
+    case TEXTURE_FORMAT_BC3:
+        EncodeChannelBlock(block, 3, output);
+        EncodeColorBlock(block, output + 8);
+        break;
+
+    case TEXTURE_FORMAT_BC4:
+        EncodeChannelBlock(block, 0, output);
+        break;
+
+    case TEXTURE_FORMAT_BC5:
+        EncodeChannelBlock(block, 0, output);
+        EncodeChannelBlock(block, 1, output + 8);
+        break;
+
+    case TEXTURE_FORMAT_BC7:
+        EncodeBlockBC7(block, output);
+        break;
+
+    default:
+        assert(false);
+        break;
+    }
+}
+
+void CompressTexture(TextureFormat format, const uint8_t* rgba, int width, int height, uint8_t* output)
+{
+    assert(IsBlockCompressed(format));
+    assert(rgba);
+    assert(output);
+
+    int block_count_x = (width + 3) / 4;
+    int block_count_y = (height + 3) / 4;
+    int block_size = GetBlockSize(format);
+
+    // Workers pull rows of blocks until none are left
+    std::atomic<int> next_row = 0;
+    auto worker = [&]()
+    {
+        uint8_t block[16][4];
+        for (int y = next_row++; y < block_count_y; y = next_row++)
+        {
+            uint8_t* row_output = output + (size_t)y * block_count_x * block_size;
+            for (int x = 0; x < block_count_x; x++)
+            {
+                LoadBlock(rgba, width, height, x, y, block);
+                EncodeBlock(format, block, row_output + (size_t)x * block_size);
+            }
+        }
+    };
+
+    int thread_count = std::clamp((int)std::thread::hardware_concurrency(), 1, block_count_y);
+    std::vector<std::thread> threads;
+    for (int i = 1; i < thread_count; i++)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (auto& thread : threads)
+        thread.join();
+}
@@ -0,0 +1,10 @@
+//
+//  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
+//
+
+#pragma once
+
+// Encodes RGBA8 pixels into BC1/BC3/BC4/BC5/BC7 blocks, the output must hold
+// GetTextureLevelSize(format, width, height) bytes.  Rows of blocks are spread over all hardware
+// threads.  BC4 encodes the red channel, BC5 red and green and BC1 ignores alpha.
+void CompressTexture(TextureFormat format, const uint8_t* rgba, int width, int height, uint8_t* output);
@@ -236,17 +236,16 @@ GLTFMesh GLTFLoader::read_mesh(const std::vector<GLTFBone>& bones)
             // Handle different index types
             if (accessor->component_type == cgltf_component_type_r_16u)
             {
-                memcpy(mesh.indices.data(), buffer_data, accessor->count * sizeof(uint16_t));
-            }
-            else if (accessor->component_type == cgltf_component_type_r_32u)
-            {
-                // Convert from uint32 to uint16
-                uint32_t* indices32 = (uint32_t*)buffer_data;
+                uint16_t* indices16 = (uint16_t*)buffer_data;
                 for (size_t i = 0; i < accessor->count; ++i)
                 {
-                    mesh.indices[i] = static_cast<uint16_t>(indices32[i]);
+                    mesh.indices[i] = indices16[i];
                 }
             }
+            else if (accessor->component_type == cgltf_component_type_r_32u)
+            {
+                memcpy(mesh.indices.data(), buffer_data, accessor->count * sizeof(uint32_t));
+            }
         }
     }
     
@@ -49,7 +49,7 @@ struct GLTFMesh
     std::vector<vec3> normals;
     std::vector<vec2> uvs;
     std::vector<uint32_t> bone_indices;
-    std::vector<uint16_t> indices;
+    std::vector<uint32_t> indices;
 };
 
 struct GLTFBoneFilter
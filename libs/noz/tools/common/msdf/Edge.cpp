@@ -18,6 +18,38 @@ namespace noz::msdf
         this->color = color;
     }
 
+    void Edge::distanceToPseudoDistance(SignedDistance& distance, const dvec2& origin, double param) const
+    {
+        if (param < 0)
+        {
+            dvec2 dir = normalize(direction(0));
+            dvec2 aq = origin - point(0);
+            if (dot(aq, dir) < 0)
+            {
+                double pseudoDistance = cross(aq, dir);
+                if (abs(pseudoDistance) <= abs(distance.distance))
+                {
+                    distance.distance = pseudoDistance;
+                    distance.dot = 0;
+                }
+            }
+        }
+        else if (param > 1)
+        {
+            dvec2 dir = normalize(direction(1));
+            dvec2 bq = origin - point(1);
+            if (dot(bq, dir) > 0)
+            {
+                double pseudoDistance = cross(bq, dir);
+                if (abs(pseudoDistance) <= abs(distance.distance))
+                {
+                    distance.distance = pseudoDistance;
+                    distance.dot = 0;
+                }
+            }
+        }
+    }
+
     void Edge::bounds(const dvec2& p, double& l, double& b, double& r, double& t)
     {
         if (p.x < l)
@@ -45,6 +77,11 @@ namespace noz::msdf
         return glm::mix(p0, p1, mix);
     }
 
+    dvec2 LinearEdge::direction(double mix) const
+    {
+        return p1 - p0;
+    }
+
     void LinearEdge::splitInThirds(std::vector<Edge*>& edges) const
     {
         edges.push_back(new LinearEdge(p0, point(1 / 3.0), color));
@@ -101,6 +138,15 @@ namespace noz::msdf
             mix);
     }
 
+    dvec2 QuadraticEdge::direction(double mix) const
+    {
+        dvec2 tangent = glm::mix(p1 - p0, p2 - p1, mix);
+        if (tangent.x == 0 && tangent.y == 0)
+            return p2 - p0;
+
+        return tangent;
+    }
+
     void QuadraticEdge::splitInThirds(std::vector<Edge*>& result) const
     {
         result.push_back(new QuadraticEdge(p0, mix(p0, p1, 1 / 3.0), point(1 / 3.0), color));
@@ -10,9 +10,17 @@
 
 namespace noz::msdf
 {
+	// Channels an edge contributes to in a multi-channel distance field, one bit per channel
 	enum class EdgeColor
 	{
-		White
+		Black = 0,
+		Red = 1,
+		Green = 2,
+		Yellow = 3,
+		Blue = 4,
+		Magenta = 5,
+		Cyan = 6,
+		White = 7
 	};
 
 	struct Edge
@@ -20,10 +28,15 @@ namespace noz::msdf
 		Edge(EdgeColor color);
 
 		virtual glm::dvec2 point(double mix) const = 0;
+		virtual glm::dvec2 direction(double mix) const = 0;
 		virtual void splitInThirds(std::vector<Edge*>& result) const = 0;
 		virtual void bounds(double& l, double& b, double& r, double& t) const = 0;
 		virtual SignedDistance distance(const glm::dvec2& origin, double& param) const = 0;
 
+		// Past either end the distance is measured to the line extending the edge instead, which
+		// keeps the channels of a multi-channel field straight up to a corner
+		void distanceToPseudoDistance(SignedDistance& distance, const glm::dvec2& origin, double param) const;
+
 		static void bounds(const glm::dvec2& p, double& l, double& b, double& r, double& t);
 
 		EdgeColor color;
@@ -35,6 +48,7 @@ namespace noz::msdf
 		LinearEdge(const glm::dvec2& p0, const glm::dvec2& p1, EdgeColor color);
 
 		glm::dvec2 point(double mix) const override;
+		glm::dvec2 direction(double mix) const override;
 		void splitInThirds(std::vector<Edge*>& result) const override;
 		void bounds(double& l, double& b, double& r, double& t) const override;
 		SignedDistance distance(const glm::dvec2& origin, double& param) const override;
@@ -49,6 +63,7 @@ namespace noz::msdf
 		QuadraticEdge(const glm::dvec2& p0, const glm::dvec2& p1, const glm::dvec2& p2, EdgeColor color);
 
 		glm::dvec2 point(double mix) const override;
+		glm::dvec2 direction(double mix) const override;
 		void splitInThirds(std::vector<Edge*>& result) const override;
 		void bounds(double& l, double& b, double& r, double& t) const override;
 		SignedDistance distance(const glm::dvec2& origin, double& param) const override;
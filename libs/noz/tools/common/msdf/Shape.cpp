@@ -7,9 +7,16 @@
 
 #include "../ttf/TrueTypeFont.h"
 #include "Shape.h"
+#include "Math.h"
 
 namespace noz::msdf
 {
+	Shape::~Shape()
+	{
+		for (auto contour : contours)
+			delete contour;
+	}
+
 	bool Shape::validate()
 	{
 		for(auto& contour : contours)
@@ -51,6 +58,116 @@ namespace noz::msdf
 			contour->bounds(l, b, r, t);
 	}
 
+	static bool isCorner(const glm::dvec2& a, const glm::dvec2& b, double crossThreshold)
+	{
+		return dot(a, b) <= 0 || abs(cross(a, b)) > crossThreshold;
+	}
+
+	// Moves to the next color that shares one channel with the current one, never the banned one
+	static void switchColor(EdgeColor& color, uint64_t& seed, EdgeColor banned = EdgeColor::Black)
+	{
+		auto combined = (EdgeColor)((int)color & (int)banned);
+		if (combined == EdgeColor::Red || combined == EdgeColor::Green || combined == EdgeColor::Blue)
+		{
+			color = (EdgeColor)((int)combined ^ (int)EdgeColor::White);
+			return;
+		}
+
+		if (color == EdgeColor::Black || color == EdgeColor::White)
+		{
+			static const EdgeColor start[3] = { EdgeColor::Cyan, EdgeColor::Magenta, EdgeColor::Yellow };
+			color = start[seed % 3];
+			seed /= 3;
+			return;
+		}
+
+		int shifted = (int)color << (1 + (seed & 1));
+		color = (EdgeColor)((shifted | shifted >> 3) & (int)EdgeColor::White);
+		seed >>= 1;
+	}
+
+	void Shape::colorEdges(double angleThreshold, uint64_t seed)
+	{
+		double crossThreshold = sin(angleThreshold);
+		std::vector<int> corners;
+		for (auto contour : contours)
+		{
+			auto& edges = contour->edges;
+
+			corners.clear();
+			if (!edges.empty())
+			{
+				auto previous = edges.back()->direction(1);
+				for (int i = 0; i < (int)edges.size(); i++)
+				{
+					if (isCorner(glm::normalize(previous), glm::normalize(edges[i]->direction(0)), crossThreshold))
+						corners.push_back(i);
+					previous = edges[i]->direction(1);
+				}
+			}
+
+			// Smooth contours have no corners to preserve
+			if (corners.empty())
+			{
+				for (auto edge : edges)
+					edge->color = EdgeColor::White;
+				continue;
+			}
+
+			// A single corner is spread over three colors so both sides of it differ
+			if (corners.size() == 1)
+			{
+				EdgeColor colors[3] = { EdgeColor::White, EdgeColor::White, EdgeColor::White };
+				switchColor(colors[0], seed);
+				colors[2] = colors[0];
+				switchColor(colors[2], seed);
+
+				int corner = corners[0];
+				int m = (int)edges.size();
+				if (m >= 3)
+				{
+					for (int i = 0; i < m; i++)
+						edges[(corner + i) % m]->color = colors[int(3 + 2.875 * i / (m - 1) - 1.4375 + .5) - 2];
+					continue;
+				}
+
+				// Fewer edges than colors, split them starting at the corner
+				std::vector<Edge*> parts;
+				for (int i = 0; i < m; i++)
+				{
+					auto edge = edges[(corner + i) % m];
+					edge->splitInThirds(parts);
+					delete edge;
+				}
+
+				for (int i = 0; i < (int)parts.size(); i++)
+					parts[i]->color = colors[i * 3 / (int)parts.size()];
+
+				edges = parts;
+				continue;
+			}
+
+			// Every spline between two corners changes color, the last one also differs from the first
+			int cornerCount = (int)corners.size();
+			int spline = 0;
+			int start = corners[0];
+			int m = (int)edges.size();
+			auto color = EdgeColor::White;
+			switchColor(color, seed);
+			auto initialColor = color;
+			for (int i = 0; i < m; i++)
+			{
+				int index = (start + i) % m;
+				if (spline + 1 < cornerCount && corners[spline + 1] == index)
+				{
+					spline++;
+					switchColor(color, seed, spline == cornerCount - 1 ? initialColor : EdgeColor::Black);
+				}
+				edges[index]->color = color;
+			}
+		}
+	}
+
 	Shape* Shape::fromGlyph(const ttf::TrueTypeFont::Glyph* glyph, bool invertYAxis)
 	{
 		if (nullptr == glyph)
@@ -147,7 +264,10 @@ namespace noz::msdf
 		}
 
 		if (!shape->validate())
+		{
+			delete shape;
 			throw std::exception("Invalid shape data in glyph");
+		}
 
 		shape->normalize();
 		shape->inverseYAxis = invertYAxis;
@@ -12,9 +12,15 @@ namespace noz::msdf
 {
 	struct Shape
 	{
+		~Shape();
+
 		bool validate();
 		void normalize();
 		void bounds(double& l, double& b, double& r, double& t);
+
+		// Assigns edge colors for a multi-channel field so that the two edges meeting at a corner
+		// sharper than angleThreshold never share more than one channel
+		void colorEdges(double angleThreshold, uint64_t seed = 0);
 		
 		static Shape* fromGlyph(const ttf::TrueTypeFont::Glyph* glyph, bool invertYAxis);
 
@@ -24,9 +24,326 @@
 
 #include "msdf.h"
 #include "Shape.h"
+#include <cfloat>
+#include <memory>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define NOZ_MSDF_SSE2 1
+#endif
 
 namespace noz::msdf
 {
+    // Edge bounds in single precision, rounded outward so that culling against them never rejects
+    // an edge the double precision distance would have chosen
+    struct EdgeBounds
+    {
+        std::vector<float> l;
+        std::vector<float> b;
+        std::vector<float> r;
+        std::vector<float> t;
+
+        void add(double el, double eb, double er, double et)
+        {
+            l.push_back(std::nextafter((float)el, -FLT_MAX));
+            b.push_back(std::nextafter((float)eb, -FLT_MAX));
+            r.push_back(std::nextafter((float)er, FLT_MAX));
+            t.push_back(std::nextafter((float)et, FLT_MAX));
+        }
+
+        void clear()
+        {
+            l.clear();
+            b.clear();
+            r.clear();
+            t.clear();
+        }
+    };
+
+    // The edges of a shape flattened in contour order so distances are evaluated without a
+    // virtual call per edge
+    struct EdgeList
+    {
+        std::vector<const Edge*> edges;
+        std::vector<bool> quadratic;
+        std::vector<uint8_t> colors;
+        std::vector<int> contourStart;
+        std::vector<double> l;
+        std::vector<double> b;
+        std::vector<double> r;
+        std::vector<double> t;
+        EdgeBounds bounds;
+    };
+
+    static SignedDistance edgeDistance(const EdgeList& list, int index, const dvec2& p, double& param)
+    {
+        if (list.quadratic[index])
+            return static_cast<const QuadraticEdge*>(list.edges[index])->QuadraticEdge::distance(p, param);
+
+        return static_cast<const LinearEdge*>(list.edges[index])->LinearEdge::distance(p, param);
+    }
+
+    static SignedDistance edgeDistance(const EdgeList& list, int index, const dvec2& p)
+    {
+        double param;
+        return edgeDistance(list, index, p, param);
+    }
+
+    // Squared culling radius for a distance, widened by slack to cover the single precision error
+    static float cullLimit(double distance, double slack)
+    {
+        double limit = std::abs(distance) + slack;
+        return (float)(limit * limit) * (1.0f + 1e-6f);
+    }
+
+    // Calls visit(i) for every edge in [begin, end) whose bounds are within sqrt(limit) of p, the
+    // visitor may lower the limit as closer edges are found
+    template <typename Visit>
+    static void cullEdges(const EdgeBounds& bounds, int begin, int end, float px, float py, float& limit, Visit visit)
+    {
+        int i = begin;
+
+#if NOZ_MSDF_SSE2
+        const __m128 x = _mm_set1_ps(px);
+        const __m128 y = _mm_set1_ps(py);
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128 dx = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&bounds.l[i]), x), _mm_sub_ps(x, _mm_loadu_ps(&bounds.r[i])));
+            __m128 dy = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&bounds.b[i]), y), _mm_sub_ps(y, _mm_loadu_ps(&bounds.t[i])));
+            dx = _mm_max_ps(dx, zero);
+            dy = _mm_max_ps(dy, zero);
+            __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+            int mask = _mm_movemask_ps(_mm_cmple_ps(d2, _mm_set1_ps(limit)));
+            for (int j = 0; mask != 0; j++, mask >>= 1)
+                if (mask & 1)
+                    visit(i + j);
+        }
+#endif
+
+        for (; i < end; i++)
+        {
+            float dx = std::max(std::max(bounds.l[i] - px, px - bounds.r[i]), 0.0f);
+            float dy = std::max(std::max(bounds.b[i] - py, py - bounds.t[i]), 0.0f);
+            if (dx * dx + dy * dy <= limit)
+                visit(i);
+        }
+    }
+
+    // Nearest edge of a contour, starting from the edge that was nearest to the previous pixel so
+    // that the bounds of most other edges can be rejected without evaluating them
+    static SignedDistance contourDistance(const EdgeList& list, int contour, const dvec2& p, double slack, int& nearest)
+    {
+        int begin = list.contourStart[contour];
+        int end = list.contourStart[contour + 1];
+        if (begin == end)
+            return SignedDistance::Infinite;
+
+        auto minDistance = edgeDistance(list, nearest, p);
+        float limit = cullLimit(minDistance.distance, slack);
+        cullEdges(list.bounds, begin, end, (float)p.x, (float)p.y, limit, [&](int i)
+        {
+            if (i == nearest)
+                return;
+
+            auto distance = edgeDistance(list, i, p);
+            if (distance < minDistance)
+            {
+                minDistance = distance;
+                nearest = i;
+                limit = cullLimit(minDistance.distance, slack);
+            }
+        });
+
+        return minDistance;
+    }
+
+    struct MultiDistance
+    {
+        double r;
+        double g;
+        double b;
+    };
+
+    static double median(double a, double b, double c)
+    {
+        return std::max(std::min(a, b), std::min(std::max(a, b), c));
+    }
+
+    static double resolveDistance(double distance)
+    {
+        return distance;
+    }
+
+    static double resolveDistance(const MultiDistance& distance)
+    {
+        return median(distance.r, distance.g, distance.b);
+    }
+
+    // Picks the distance of the contour that bounds p.  Overlapping contours are resolved by their
+    // winding so that edges buried inside another contour do not show up in the field.
+    template <typename T>
+    static T combineContours(const std::vector<T>& contourSD, const std::vector<int>& windings, const T& infinite)
+    {
+        int contourCount = (int)contourSD.size();
+        T negDist = infinite;
+        T posDist = infinite;
+        double neg = -resolveDistance(infinite);
+        double pos = resolveDistance(infinite);
+        int winding = 0;
+
+        for (int i = 0; i < contourCount; i++)
+        {
+            double distance = resolveDistance(contourSD[i]);
+            if (windings[i] > 0 && distance >= 0 && abs(distance) < abs(pos))
+            {
+                posDist = contourSD[i];
+                pos = distance;
+            }
+            if (windings[i] < 0 && distance <= 0 && abs(distance) < abs(neg))
+            {
+                negDist = contourSD[i];
+                neg = distance;
+            }
+        }
+
+        T sd = infinite;
+        double d = resolveDistance(infinite);
+        if (pos >= 0 && abs(pos) <= abs(neg))
+        {
+            sd = posDist;
+            d = pos;
+            winding = 1;
+            for (int i = 0; i < contourCount; ++i)
+            {
+                double distance = resolveDistance(contourSD[i]);
+                if (windings[i] > 0 && distance > d && abs(distance) < abs(neg))
+                {
+                    sd = contourSD[i];
+                    d = distance;
+                }
+            }
+        }
+        else if (neg <= 0 && abs(neg) <= abs(pos))
+        {
+            sd = negDist;
+            d = neg;
+            winding = -1;
+            for (int i = 0; i < contourCount; ++i)
+            {
+                double distance = resolveDistance(contourSD[i]);
+                if (windings[i] < 0 && distance < d && abs(distance) < abs(pos))
+                {
+                    sd = contourSD[i];
+                    d = distance;
+                }
+            }
+        }
+
+        for (int i = 0; i < contourCount; ++i)
+        {
+            double distance = resolveDistance(contourSD[i]);
+            if (windings[i] != winding && abs(distance) < abs(d))
+            {
+                sd = contourSD[i];
+                d = distance;
+            }
+        }
+
+        return sd;
+    }
+
+    // Flattens the shape and returns the slack that covers rounding coordinates to float anywhere
+    // within the output
+    static double buildEdgeList(
+        const Shape& shape,
+        EdgeList& list,
+        std::vector<int>& windings,
+        const ivec2& outputSize,
+        double range,
+        const dvec2& scale,
+        const dvec2& translate)
+    {
+        int contourCount = (int)shape.contours.size();
+        windings.resize(contourCount);
+
+        double extent = 0.0;
+        for (int i = 0; i < contourCount; i++)
+        {
+            windings[i] = shape.contours[i]->winding();
+            list.contourStart.push_back((int)list.edges.size());
+            for (auto edge : shape.contours[i]->edges)
+            {
+                double l = DBL_MAX;
+                double b = DBL_MAX;
+                double r = -DBL_MAX;
+                double t = -DBL_MAX;
+                edge->bounds(l, b, r, t);
+                list.edges.push_back(edge);
+                list.quadratic.push_back(dynamic_cast<const QuadraticEdge*>(edge) != nullptr);
+                list.colors.push_back((uint8_t)edge->color);
+                list.l.push_back(l);
+                list.b.push_back(b);
+                list.r.push_back(r);
+                list.t.push_back(t);
+                list.bounds.add(l, b, r, t);
+                extent = std::max(extent, std::max(std::max(std::abs(l), std::abs(r)), std::max(std::abs(b), std::abs(t))));
+            }
+        }
+        list.contourStart.push_back((int)list.edges.size());
+
+        extent = std::max(extent, std::abs(translate.x) + outputSize.x / scale.x);
+        extent = std::max(extent, std::abs(translate.y) + outputSize.y / scale.y);
+        return (extent + range) * 1e-5;
+    }
+
+    // A pixel with no edge within range saturates and its sign can only differ from its left
+    // neighbour if an edge lies between them, which cannot happen while pixels are closer together
+    // than range.  Such pixels copy their neighbour and skip the contour search.
+    struct FarPixels
+    {
+        EdgeBounds bounds;
+        std::vector<int> edges;
+        int nearEdge = -1;
+        bool enabled = false;
+
+        // Only edges that overlap the band within range of a row can bring a pixel in range
+        void beginRow(const EdgeList& list, double y, double range, double slack)
+        {
+            bounds.clear();
+            edges.clear();
+            nearEdge = -1;
+            for (int i = 0; enabled && i < (int)list.edges.size(); i++)
+            {
+                if (list.b[i] - slack > y + range || list.t[i] + slack < y - range)
+                    continue;
+
+                bounds.add(list.l[i], list.b[i], list.r[i], list.t[i]);
+                edges.push_back(i);
+            }
+        }
+
+        bool isFar(const EdgeList& list, const dvec2& p, double range, double slack)
+        {
+            if (nearEdge != -1 && std::abs(edgeDistance(list, nearEdge, p).distance) < range)
+                return false;
+
+            bool near = false;
+            float limit = cullLimit(range, slack);
+            cullEdges(bounds, 0, (int)edges.size(), (float)p.x, (float)p.y, limit, [&](int i)
+            {
+                if (near || std::abs(edgeDistance(list, edges[i], p).distance) >= range)
+                    return;
+
+                near = true;
+                nearEdge = edges[i];
+                limit = -1.0f;
+            });
+
+            return !near;
+        }
+    };
+
     void generateSDF(
         std::vector<uint8_t>& output,
         int outputStride,
@@ -41,72 +358,305 @@ namespace noz::msdf
         int w = outputSize.x;
         int h = outputSize.y;
 
+        EdgeList list;
         std::vector<int> windings;
-        windings.resize(contourCount);
-        for (size_t i = 0; i < shape.contours.size(); i++)
-            windings[i] = shape.contours[i]->winding();
+        double slack = buildEdgeList(shape, list, windings, outputSize, range, scale, translate);
 
         std::vector<double> contourSD;
         contourSD.resize(contourCount);
 
+        std::vector<int> nearest;
+        nearest.resize(contourCount);
+        for (int i = 0; i < contourCount; i++)
+            nearest[i] = list.contourStart[i];
+
+        FarPixels far;
+        far.enabled = 1.0 / scale.x < range;
+
         for (int y = 0; y < h; ++y)
         {
             int row = shape.inverseYAxis ? h - y - 1 : y;
+            far.beginRow(list, (y + .5) / scale.y - translate.y, range, slack);
+
+            int previousSign = 0;
             for (int x = 0; x < w; ++x)
             {
-                auto dummy = 0.0;
                 auto p = dvec2(x + .5, y + .5) / scale - translate;
-                auto negDist = -SignedDistance::Infinite.distance;
-                auto posDist = SignedDistance::Infinite.distance;
-                int winding = 0;
+                auto& pixel = output[x + outputPosition.x + (row + outputPosition.y) * outputStride];
 
-                for (size_t i = 0; i < shape.contours.size(); i++)
+                if (previousSign != 0 && far.isFar(list, p, range, slack))
                 {
-                    auto minDistance = SignedDistance::Infinite;
-                    for(auto edge : shape.contours[i]->edges)
-                    {
-                        auto distance = edge->distance(p, dummy);
-                        if (distance < minDistance)
-                            minDistance = distance;
-                    }
-
-                    contourSD[i] = minDistance.distance;
-                    if (windings[i] > 0 && minDistance.distance >= 0 && abs(minDistance.distance) < abs(posDist))
-                        posDist = minDistance.distance;
-                    if (windings[i] < 0 && minDistance.distance <= 0 && abs(minDistance.distance) < abs(negDist))
-                        negDist = minDistance.distance;
+                    pixel = previousSign > 0 ? 255 : 0;
+                    continue;
                 }
 
-                double sd = SignedDistance::Infinite.distance;
-                if (posDist >= 0 && abs(posDist) <= abs(negDist))
+                for (int i = 0; i < contourCount; i++)
+                    contourSD[i] = contourDistance(list, i, p, slack, nearest[i]).distance;
+
+                double sd = combineContours(contourSD, windings, SignedDistance::Infinite.distance);
+
+                if (far.enabled)
+                    previousSign = sd > 0 ? 1 : -1;
+
+                sd /= (range * 2.0);
+                sd = clamp(sd, -0.5, 0.5);
+                sd = sd + 0.5;
+
+                pixel = (uint8_t)(sd * 255.0f);
+            }
+        }
+    }
+
+    // Nearest edge of each channel in a contour, converted to pseudo distances, and the true
+    // distance.  nearest holds the edges found for the previous pixel, red, green, blue and true.
+    static void contourMultiDistance(
+        const EdgeList& list,
+        int contour,
+        const dvec2& p,
+        double slack,
+        int* nearest,
+        MultiDistance& multiDistance,
+        double& trueDistance)
+    {
+        int begin = list.contourStart[contour];
+        int end = list.contourStart[contour + 1];
+        double infinite = SignedDistance::Infinite.distance;
+        if (begin == end)
+        {
+            multiDistance = { infinite, infinite, infinite };
+            trueDistance = infinite;
+            return;
+        }
+
+        SignedDistance channels[3] = { SignedDistance::Infinite, SignedDistance::Infinite, SignedDistance::Infinite };
+        int channelEdges[3] = { -1, -1, -1 };
+        double channelParams[3] = { 0, 0, 0 };
+        auto minDistance = SignedDistance::Infinite;
+        int minEdge = nearest[3];
+
+        auto visit = [&](int i)
+        {
+            double param;
+            auto distance = edgeDistance(list, i, p, param);
+            if (distance < minDistance)
+            {
+                minDistance = distance;
+                minEdge = i;
+            }
+
+            for (int c = 0; c < 3; c++)
+            {
+                if ((list.colors[i] & (1 << c)) && distance < channels[c])
                 {
-                    sd = posDist;
-                    winding = 1;
-                    for (int i = 0; i < contourCount; ++i)
-                        if (windings[i] > 0 && contourSD[i] > sd && abs(contourSD[i]) < abs(negDist))
-                            sd = contourSD[i];
+                    channels[c] = distance;
+                    channelEdges[c] = i;
+                    channelParams[c] = param;
                 }
-                else if (negDist <= 0 && abs(negDist) <= abs(posDist))
+            }
+        };
+
+        auto getLimit = [&]()
+        {
+            double distance = std::max(std::max(std::abs(channels[0].distance), std::abs(channels[1].distance)), std::abs(channels[2].distance));
+            return cullLimit(distance, slack);
+        };
+
+        for (int i = 0; i < 4; i++)
+            if (std::find(nearest, nearest + i, nearest[i]) == nearest + i)
+                visit(nearest[i]);
+
+        float limit = getLimit();
+        cullEdges(list.bounds, begin, end, (float)p.x, (float)p.y, limit, [&](int i)
+        {
+            if (std::find(nearest, nearest + 4, i) != nearest + 4)
+                return;
+
+            visit(i);
+            limit = getLimit();
+        });
+
+        double distances[3];
+        for (int c = 0; c < 3; c++)
+        {
+            if (channelEdges[c] != -1)
+            {
+                list.edges[channelEdges[c]]->distanceToPseudoDistance(channels[c], p, channelParams[c]);
+                nearest[c] = channelEdges[c];
+            }
+            distances[c] = channels[c].distance;
+        }
+        nearest[3] = minEdge;
+
+        multiDistance = { distances[0], distances[1], distances[2] };
+        trueDistance = minDistance.distance;
+    }
+
+    // Neighbouring texels where two channels flip while the third stays put interpolate into a
+    // false edge between them.  Only the texel farther from the real edge is flagged.
+    static bool isClash(const float* a, const float* b, float threshold)
+    {
+        bool aIn = (a[0] > .5f) + (a[1] > .5f) + (a[2] > .5f) >= 2;
+        bool bIn = (b[0] > .5f) + (b[1] > .5f) + (b[2] > .5f) >= 2;
+        if (aIn != bIn)
+            return false;
+
+        if ((a[0] > .5f && a[1] > .5f && a[2] > .5f) || (a[0] < .5f && a[1] < .5f && a[2] < .5f) ||
+            (b[0] > .5f && b[1] > .5f && b[2] > .5f) || (b[0] < .5f && b[1] < .5f && b[2] < .5f))
+            return false;
+
+        auto flips = [&](int c) { return (a[c] > .5f) != (b[c] > .5f) && (a[c] < .5f) != (b[c] < .5f); };
+
+        int c0, c1, c2;
+        if (flips(0) && flips(1))
+            c0 = 0, c1 = 1, c2 = 2;
+        else if (flips(0) && flips(2))
+            c0 = 0, c1 = 2, c2 = 1;
+        else if (flips(1) && flips(2))
+            c0 = 1, c1 = 2, c2 = 0;
+        else
+            return false;
+
+        return
+            std::abs(a[c0] - b[c0]) >= threshold &&
+            std::abs(a[c1] - b[c1]) >= threshold &&
+            std::abs(a[c2] - .5f) >= std::abs(b[c2] - .5f);
+    }
+
+    static void flattenClashes(std::vector<float>& pixels, const std::vector<int>& clashes)
+    {
+        for (int index : clashes)
+        {
+            float* pixel = &pixels[index * 4];
+            float m = (float)median(pixel[0], pixel[1], pixel[2]);
+            pixel[0] = m;
+            pixel[1] = m;
+            pixel[2] = m;
+        }
+    }
+
+    // Clashes between direct neighbours are flattened first, diagonal ones are looked for again
+    // afterwards since bilinear filtering blends those texels as well
+    static void correctClashes(std::vector<float>& pixels, int w, int h, const dvec2& threshold)
+    {
+        std::vector<int> clashes;
+        for (int y = 0; y < h; ++y)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                const float* pixel = &pixels[(x + y * w) * 4];
+                if ((x > 0 && isClash(pixel, pixel - 4, (float)threshold.x)) ||
+                    (x < w - 1 && isClash(pixel, pixel + 4, (float)threshold.x)) ||
+                    (y > 0 && isClash(pixel, pixel - w * 4, (float)threshold.y)) ||
+                    (y < h - 1 && isClash(pixel, pixel + w * 4, (float)threshold.y)))
+                    clashes.push_back(x + y * w);
+            }
+        }
+        flattenClashes(pixels, clashes);
+
+        clashes.clear();
+        float diagonal = (float)(threshold.x + threshold.y);
+        for (int y = 0; y < h; ++y)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                const float* pixel = &pixels[(x + y * w) * 4];
+                if ((x > 0 && y > 0 && isClash(pixel, pixel - (w + 1) * 4, diagonal)) ||
+                    (x < w - 1 && y > 0 && isClash(pixel, pixel - (w - 1) * 4, diagonal)) ||
+                    (x > 0 && y < h - 1 && isClash(pixel, pixel + (w - 1) * 4, diagonal)) ||
+                    (x < w - 1 && y < h - 1 && isClash(pixel, pixel + (w + 1) * 4, diagonal)))
+                    clashes.push_back(x + y * w);
+            }
+        }
+        flattenClashes(pixels, clashes);
+    }
+
+    void generateMSDF(
+        std::vector<uint8_t>& output,
+        int outputStride,
+        const ivec2& outputPosition,
+        const ivec2& outputSize,
+        const Shape& shape,
+        double range,
+        const dvec2& scale,
+        const dvec2& translate,
+        bool trueDistance)
+    {
+        int contourCount = (int)shape.contours.size();
+        int w = outputSize.x;
+        int h = outputSize.y;
+
+        EdgeList list;
+        std::vector<int> windings;
+        double slack = buildEdgeList(shape, list, windings, outputSize, range, scale, translate);
+
+        std::vector<MultiDistance> contourMSD;
+        contourMSD.resize(contourCount);
+        std::vector<double> contourSD;
+        contourSD.resize(contourCount);
+
+        std::vector<int> nearest;
+        nearest.resize(contourCount * 4);
+        for (int i = 0; i < contourCount * 4; i++)
+            nearest[i] = list.contourStart[i / 4];
+
+        FarPixels far;
+        far.enabled = 1.0 / scale.x < range;
+
+        auto normalizeDistance = [range](double distance)
+        {
+            return (float)(clamp(distance / (range * 2.0), -0.5, 0.5) + 0.5);
+        };
+
+        // Clash correction needs the neighbours, so the field is built in float before it is stored
+        std::vector<float> pixels;
+        pixels.resize((size_t)w * h * 4);
+        for (int y = 0; y < h; ++y)
+        {
+            far.beginRow(list, (y + .5) / scale.y - translate.y, range, slack);
+
+            int previousSign = 0;
+            for (int x = 0; x < w; ++x)
+            {
+                auto p = dvec2(x + .5, y + .5) / scale - translate;
+                float* pixel = &pixels[(x + y * w) * 4];
+
+                if (previousSign != 0 && far.isFar(list, p, range, slack))
                 {
-                    sd = negDist;
-                    winding = -1;
-                    for (int i = 0; i < contourCount; ++i)
-                        if (windings[i] < 0 && contourSD[i] < sd && abs(contourSD[i]) < abs(posDist))
-                            sd = contourSD[i];
+                    pixel[0] = pixel[1] = pixel[2] = pixel[3] = previousSign > 0 ? 1.0f : 0.0f;
+                    continue;
                 }
 
-                for (int i = 0; i < contourCount; ++i)
-                    if (windings[i] != winding && abs(contourSD[i]) < abs(sd))
-                        sd = contourSD[i];
+                for (int i = 0; i < contourCount; i++)
+                    contourMultiDistance(list, i, p, slack, &nearest[i * 4], contourMSD[i], contourSD[i]);
 
-                sd /= (range * 2.0);
-                sd = clamp(sd, -0.5, 0.5);
-                sd = sd + 0.5;
+                double infinite = SignedDistance::Infinite.distance;
+                auto msd = combineContours(contourMSD, windings, MultiDistance{ infinite, infinite, infinite });
+                double sd = combineContours(contourSD, windings, infinite);
+
+                if (far.enabled)
+                    previousSign = sd > 0 ? 1 : -1;
 
-                output[x + outputPosition.x + (row + outputPosition.y) * outputStride] =
-                    (uint8_t)(sd * 255.0f);
+                pixel[0] = normalizeDistance(msd.r);
+                pixel[1] = normalizeDistance(msd.g);
+                pixel[2] = normalizeDistance(msd.b);
+                pixel[3] = normalizeDistance(sd);
             }
         }
+
+        correctClashes(pixels, w, h, dvec2(1.001) / (scale * range * 2.0));
+
+        for (int y = 0; y < h; ++y)
+        {
+            int row = shape.inverseYAxis ? h - y - 1 : y;
+            uint8_t* dst = &output[(outputPosition.x + (row + outputPosition.y) * outputStride) * 4];
+            const float* src = &pixels[y * w * 4];
+            for (int x = 0; x < w * 4; x++)
+                dst[x] = (uint8_t)(src[x] * 255.0f);
+
+            if (!trueDistance)
+                for (int x = 0; x < w; x++)
+                    dst[x * 4 + 3] = 255;
+        }
     }
 
     void renderGlyph(
@@ -119,7 +669,8 @@ namespace noz::msdf
         const dvec2& scale,
         const dvec2& translate)
     {
-        auto shape = Shape::fromGlyph(glyph, true);
+        // Glyphs are rendered on several threads at once, the shape is private to this call
+        std::unique_ptr<Shape> shape(Shape::fromGlyph(glyph, true));
 
         generateSDF(
             output,
@@ -131,7 +682,32 @@ namespace noz::msdf
             scale,
             translate
         );
+    }
 
-        delete shape;
+    void renderGlyphMSDF(
+        const ttf::TrueTypeFont::Glyph* glyph,
+        std::vector<uint8_t>& output,
+        int outputStride,
+        const ivec2& outputPosition,
+        const ivec2& outputSize,
+        double range,
+        const dvec2& scale,
+        const dvec2& translate,
+        bool trueDistance)
+    {
+        std::unique_ptr<Shape> shape(Shape::fromGlyph(glyph, true));
+        shape->colorEdges(3.0);
+
+        generateMSDF(
+            output,
+            outputStride,
+            outputPosition,
+            outputSize,
+            *shape,
+            range,
+            scale,
+            translate,
+            trueDistance
+        );
     }
 }
@@ -14,4 +14,18 @@ namespace noz::msdf
 		const glm::dvec2& scale,
 		const glm::dvec2& translate
 	);
+
+	// Multi-channel field into RGBA8 texels, outputStride and outputPosition are in texels.  The
+	// alpha channel holds the true distance when trueDistance is set and is opaque otherwise.
+	void renderGlyphMSDF(
+		const noz::ttf::TrueTypeFont::Glyph* glyph,
+		std::vector<uint8_t>& output,
+		int outputStride,
+		const glm::ivec2& outputPosition,
+		const glm::ivec2& outputSize,
+		double range,
+		const glm::dvec2& scale,
+		const glm::dvec2& translate,
+		bool trueDistance
+	);
 }
@@ -3,6 +3,7 @@
 //
 
 #include "rect_packer.h"
+#include <algorithm>
 
 using namespace noz;
 
@@ -25,6 +26,104 @@ void rect_packer::Resize(int32_t width, int32_t height)
     free_.push_back(BinRect(1, 1, width - 2, height - 2));
 }
 
+// The usable area is inset by one texel on every side.  Free rectangles that reached the old
+// right or bottom edge are extended and the new strips are added as free rectangles of their own.
+void rect_packer::Grow(int32_t width, int32_t height)
+{
+    assert(width >= size_.w && height >= size_.h);
+
+    int32_t old_right = size_.w - 1;
+    int32_t old_bottom = size_.h - 1;
+    int32_t right = width - 1;
+    int32_t bottom = height - 1;
+
+    for (auto& rect : free_)
+    {
+        if (rect.x + rect.w == old_right)
+            rect.w = right - rect.x;
+        if (rect.y + rect.h == old_bottom)
+            rect.h = bottom - rect.y;
+    }
+
+    if (right > old_right)
+        free_.push_back(BinRect(old_right, 1, right - old_right, bottom - 1));
+    if (bottom > old_bottom)
+        free_.push_back(BinRect(1, old_bottom, right - 1, bottom - old_bottom));
+
+    size_.w = width;
+    size_.h = height;
+    PruneFreeList();
+}
+
+int rect_packer::Insert(const glm::ivec2& size, method method, BinRect& result, const BinSize& max_size)
+{
+    while (true)
+    {
+        int index = Insert(size, method, result);
+        if (index != -1)
+            return index;
+
+        BinSize grown = size_;
+        if ((grown.w <= grown.h && grown.w * 2 <= max_size.w) || grown.h * 2 > max_size.h)
+            grown.w *= 2;
+        else
+            grown.h *= 2;
+
+        if (grown.w > max_size.w || grown.h > max_size.h)
+            return -1;
+
+        Grow(grown.w, grown.h);
+    }
+}
+
+std::vector<size_t> rect_packer::GetPackingOrder(const std::vector<glm::ivec2>& sizes)
+{
+    std::vector<size_t> order(sizes.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+
+    std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b)
+    {
+        int64_t area_a = (int64_t)sizes[a].x * sizes[a].y;
+        int64_t area_b = (int64_t)sizes[b].x * sizes[b].y;
+        if (area_a != area_b)
+            return area_a > area_b;
+
+        return sizes[a].x + sizes[a].y > sizes[b].x + sizes[b].y;
+    });
+
+    return order;
+}
+
+rect_packer::BinSize rect_packer::GetStartSize(const std::vector<glm::ivec2>& sizes, const BinSize& max_size)
+{
+    int64_t area = 0;
+    BinSize largest(0, 0);
+    for (const auto& size : sizes)
+    {
+        area += (int64_t)size.x * size.y;
+        largest.w = std::max(largest.w, size.x);
+        largest.h = std::max(largest.h, size.y);
+    }
+
+    // Both sides include the one texel border
+    BinSize result(1, 1);
+    while (result.w < largest.w + 2 && result.w < max_size.w)
+        result.w *= 2;
+    while (result.h < largest.h + 2 && result.h < max_size.h)
+        result.h *= 2;
+
+    while ((int64_t)(result.w - 2) * (result.h - 2) < area && (result.w < max_size.w || result.h < max_size.h))
+    {
+        if ((result.w <= result.h && result.w < max_size.w) || result.h >= max_size.h)
+            result.w *= 2;
+        else
+            result.h *= 2;
+    }
+
+    return result;
+}
+
 int rect_packer::Insert(const glm::ivec2& size, method method, BinRect& result)
 {
     BinRect rect;
@@ -117,13 +216,13 @@ rect_packer::BinRect rect_packer::ScoreRect(BinSize size, method method, int32_t
 /// Computes the ratio of used surface area.
 float rect_packer::GetOccupancy() const
 {
-    unsigned long area = 0;
+    uint64_t area = 0;
     for (size_t i = 0; i < used_.size(); ++i)
     {
-        area += used_[i].w * used_[i].h;
+        area += (uint64_t)used_[i].w * used_[i].h;
     }
 
-    return (float)area / (size_.w * size_.h);
+    return (float)((double)area / ((double)size_.w * size_.h));
 }
 
 rect_packer::BinRect rect_packer::FindPositionForNewNodeBottomLeft(int32_t width, int32_t height, int32_t& bestY,
@@ -149,7 +248,7 @@ rect_packer::BinRect rect_packer::FindPositionForNewNodeBottomLeft(int32_t width
                 bestX = free_[i].x;
             }
         }
-        if (free_[i].w >= height && free_[i].h >= width)
+        if (allow_rotation_ && free_[i].w >= height && free_[i].h >= width)
         {
             int32_t topSideY = free_[i].y + width;
             if (topSideY < bestY || (topSideY == bestY && free_[i].x < bestX))
@@ -196,7 +295,7 @@ rect_packer::BinRect rect_packer::FindPositionForNewNodeBestShortSideFit(int32_t
             }
         }
 
-        if (free_[i].w >= height && free_[i].h >= width)
+        if (allow_rotation_ && free_[i].w >= height && free_[i].h >= width)
         {
             int32_t flippedLeftoverHoriz = abs(free_[i].w - height);
             int32_t flippedLeftoverVert = abs(free_[i].h - width);
@@ -248,7 +347,7 @@ rect_packer::BinRect rect_packer::FindPositionForNewNodeBestLongSideFit(int32_t
             }
         }
         /*
-            if (free_[i].w >= height && free_[i].h >= width)
+            if (allow_rotation_ && free_[i].w >= height && free_[i].h >= width)
             {
                 int32_t leftoverHoriz = abs(free_[i].w - height);
                 int32_t leftoverVert = abs(free_[i].h - width);
@@ -301,7 +400,7 @@ rect_packer::BinRect rect_packer::FindPositionForNewNodeBestAreaFit(int32_t widt
             }
         }
 
-        if (free_[i].w >= height && free_[i].h >= width)
+        if (allow_rotation_ && free_[i].w >= height && free_[i].h >= width)
         {
             int32_t leftoverHoriz = abs(free_[i].w - height);
             int32_t leftoverVert = abs(free_[i].h - width);
@@ -372,7 +471,7 @@ rect_packer::BinRect rect_packer::FindPositionForNewNodeContactPoint(int32_t wid
                 bestContactScore = score;
             }
         }
-        if (free_[i].w >= height && free_[i].h >= width)
+        if (allow_rotation_ && free_[i].w >= height && free_[i].h >= width)
         {
             int32_t score = ContactPointScoreNode(free_[i].x, free_[i].y, width, height);
             if (score > bestContactScore)
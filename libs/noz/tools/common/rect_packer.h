@@ -44,11 +44,26 @@ namespace noz
 
         void Resize(int32_t width, int32_t height);
 
+        /// Enlarges the bin while keeping every rectangle already placed.
+        void Grow(int32_t width, int32_t height);
+
         int Insert(const glm::ivec2& size, method method, BinRect& result);
         int Insert(int32_t width, int32_t height, method method, BinRect& result) { return Insert(glm::ivec2(width, height), method, result); }
 
+        /// Inserts the rectangle, doubling the shorter side of the bin until it fits or max_size is reached.
+        int Insert(const glm::ivec2& size, method method, BinRect& result, const BinSize& max_size);
+
+        /// Rectangles are only rotated when the caller can handle swapped width and height.
+        void SetAllowRotation(bool allow_rotation) { allow_rotation_ = allow_rotation; }
+
         float GetOccupancy(void) const;
 
+        /// Indices of sizes ordered by descending area then perimeter, the order that packs tightest.
+        static std::vector<size_t> GetPackingOrder(const std::vector<glm::ivec2>& sizes);
+
+        /// Smallest power of two bin, no larger than max_size, that could hold the total area of sizes.
+        static BinSize GetStartSize(const std::vector<glm::ivec2>& sizes, const BinSize& max_size);
+
         const BinSize& size(void) const { return size_; }
 
         bool empty() const { return used_.empty(); }
@@ -81,5 +96,6 @@ namespace noz
         BinSize size_;
         std::vector<BinRect> used_;
         std::vector<BinRect> free_;
+        bool allow_rotation_ = false;
     };
 }
@@ -41,7 +41,7 @@ namespace noz::ttf
         struct Glyph
         {
             uint16_t id;
-            char ascii;
+            uint32_t codepoint;
             std::vector<Point> points;
             std::vector<Contour> contours;
             double advance;
@@ -55,7 +55,10 @@ namespace noz::ttf
 
         const std::vector<Kerning>& kerning() const { return _kerning; }
 
-        const Glyph* glyph(char c) const { return _glyphs[c]; }
+        const Glyph* glyph(uint32_t c) const { return c < _glyphs.size() ? _glyphs[c] : nullptr; }
+
+        /// Indexed by codepoint, null where the filter or the font has no glyph.
+        const std::vector<Glyph*>& glyphs() const { return _glyphs; }
 
         static TrueTypeFont* load(const std::string& path, int requestedSize, const std::string& filter);
         static TrueTypeFont* load(Stream* stream, int requestedSize, const std::string& filter);
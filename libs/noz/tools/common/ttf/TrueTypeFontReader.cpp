@@ -13,18 +13,33 @@ namespace noz::ttf
     TrueTypeFontReader::TrueTypeFontReader(Stream* reader, int requestedSize, const string& filter)
         : _reader(reader),
         _requestedSize(requestedSize),
-        _filter(filter),
         _ttf(nullptr),
         _scale(1.0, 1.0),
         _unitsPerEm(0.0),
         _indexToLocFormat(0)
     {
         _tableOffsets.resize((size_t)TableName::Count);
+
+        // The filter is UTF-8, only the basic multilingual plane is reachable through cmap format 4
+        _filter.resize(0x10000, false);
+        for (size_t i = 0; i < filter.size();)
+        {
+            auto lead = (uint8_t)filter[i];
+            int length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 1;
+            uint32_t c = length == 1 ? lead : lead & (0x7F >> length);
+            for (int j = 1; j < length && i + j < filter.size(); j++)
+                c = (c << 6) | ((uint8_t)filter[i + j] & 0x3F);
+
+            if (c < _filter.size())
+                _filter[c] = true;
+
+            i += length;
+        }
     }
 
-    bool TrueTypeFontReader::isInFilter(char c) const
+    bool TrueTypeFontReader::isInFilter(uint32_t c) const
     {
-        return _filter.find('c') != -1;
+        return c < _filter.size() && _filter[c];
     }
 
     float TrueTypeFontReader::readFixed()
@@ -172,16 +187,11 @@ namespace noz::ttf
                     auto delta = (short)idDelta[i];
                     auto rangeOffset = idRangeOffset[i];
 
-                    if (start > 254)
-                        continue;
-                    if (end > 254)
-                        end = 254;
-
                     if (rangeOffset == 0)
                     {
                         for (int c = start; c <= end; c++)
                         {
-                            if (!isInFilter((char)c))
+                            if (!isInFilter((uint32_t)c))
                                 continue;
 
                             auto glyphId = (uint16_t)(c + delta);
@@ -190,7 +200,7 @@ namespace noz::ttf
 
                             auto glyph = new TrueTypeFont::Glyph {};
                             glyph->id = glyphId;
-                            glyph->ascii = (char)c;
+                            glyph->codepoint = (uint32_t)c;
                             _ttf->_glyphs[c] = glyph;
                             _glyphsById[glyphId] = glyph;
                         }
@@ -199,7 +209,7 @@ namespace noz::ttf
                     {
                         for (int c = start; c <= end; c++)
                         {
-                            if (!isInFilter((char)c))
+                            if (!isInFilter((uint32_t)c))
                                 continue;
 
                             seek(glyphIdArray + i * 2 + rangeOffset + 2 * (c - start));
@@ -209,7 +219,7 @@ namespace noz::ttf
 
                             auto glyph = new TrueTypeFont::Glyph{};
                             glyph->id = glyphId;
-                            glyph->ascii = (char)c;
+                            glyph->codepoint = (uint32_t)c;
                             _ttf->_glyphs[c] = glyph;
                             _glyphsById[glyphId] = glyph;
                         }
@@ -468,8 +478,8 @@ namespace noz::ttf
                             continue;
 
                         TrueTypeFont::Kerning kerning = {};
-                        kerning.left = left->ascii;
-                        kerning.right = right->ascii;
+                        kerning.left = left->codepoint;
+                        kerning.right = right->codepoint;
                         kerning.value = (float)kern;
                         _ttf->_kerning.push_back(kerning);
                     }
@@ -495,8 +505,8 @@ namespace noz::ttf
         readUInt16(); // Entry Selector
         readUInt16(); // Range Shift
 
-        // Right now we only support ASCII table.
-        _ttf->_glyphs.resize(255, nullptr);
+        // Glyphs are indexed by codepoint, cmap format 4 covers the basic multilingual plane
+        _ttf->_glyphs.resize(0x10000, nullptr);
 
         // Read all of the relevant table offsets and validate their checksums
         for (uint16_t i = 0; i < numTables; i++)
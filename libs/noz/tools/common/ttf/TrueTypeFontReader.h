@@ -69,7 +69,7 @@ namespace noz::ttf
         int64_t seek(TableName table);
         int64_t seek(TableName table, int64_t offset);
 
-        bool isInFilter(char c) const;
+        bool isInFilter(uint32_t c) const;
 
         uint32_t calculateChecksum(uint32_t offset, uint32_t length);
 
@@ -78,7 +78,7 @@ namespace noz::ttf
         uint16_t _indexToLocFormat;
         std::vector<int64_t> _tableOffsets;
         glm::dvec2 _scale;
-        std::string _filter;
+        std::vector<bool> _filter;
         double _unitsPerEm;
         int _requestedSize;
         std::vector<TrueTypeFont::Glyph*> _glyphsById;
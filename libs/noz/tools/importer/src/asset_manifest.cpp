@@ -49,6 +49,7 @@ static type_t ToTypeFromSignature(asset_signature_t signature, const std::vector
 static const char* ToStringFromSignature(asset_signature_t signature, const std::vector<AssetImporterTraits*>& importers);
 static const char* ToMacroFromSignature(asset_signature_t signature, const std::vector<AssetImporterTraits*>& importers);
 static void GenerateRendererSetupCalls(ManifestGenerator* generator, Stream* stream);
+static void GeneratePipelinePrewarmCall(ManifestGenerator* generator, Stream* stream);
 
 bool GenerateAssetManifest(
     const fs::path& output_directory,
@@ -191,9 +192,11 @@ static void GenerateAssetsHeader(ManifestGenerator* generator, const fs::path& h
                 std::string var_name = PathToVarName(asset_path.filename().string());
                 access_path += "." + var_name;
                 
-                // Add to the appropriate type group
-                std::string type_key = std::string(type_name) + "s";
+                // Add to the appropriate type group, names that already end in s such as atlas stay as they are
+                std::string type_key = type_name;
                 std::transform(type_key.begin(), type_key.end(), type_key.begin(), ::tolower);
+                if (type_key.back() != 's')
+                    type_key += "s";
                 assets_by_type[type_key].push_back(access_path);
             }
         }
@@ -219,7 +222,8 @@ static void GenerateAssetsHeader(ManifestGenerator* generator, const fs::path& h
         "struct Mesh;\n"
         "struct Font;\n"
         "struct Material;\n"
-        "struct Sound;\n\n");
+        "struct Sound;\n"
+        "struct Atlas;\n\n");
     
     // Build directory tree (same as in OrganizeAssetsByType)
     PathNode root;
@@ -409,6 +413,7 @@ static void GenerateManifestCode(ManifestGenerator* generator)
     
     // Generate renderer setup calls if config is provided
     GenerateRendererSetupCalls(generator, stream);
+    GeneratePipelinePrewarmCall(generator, stream);
     
     WriteCSTR(stream, "\n    return true;\n}\n\n");
     
@@ -694,4 +699,36 @@ static void GenerateRendererSetupCalls(ManifestGenerator* generator, Stream* str
                 
         WriteCSTR(stream, "    %s(%s);\n", global.second.c_str(), access_path.c_str());
     }
-}
\ No newline at end of file
+}
+
+static void GeneratePipelinePrewarmCall(ManifestGenerator* generator, Stream* stream)
+{
+    std::vector<std::string> shaders;
+    for (const auto& entry : generator->asset_entries)
+    {
+        if (entry.signature != ASSET_SIGNATURE_SHADER)
+            continue;
+
+        // Convert asset path to access path (e.g., "shaders/shadow" -> "Assets.shaders.shadow")
+        fs::path asset_path(entry.path);
+        std::string access_path = "Assets";
+
+        auto parent_path = asset_path.parent_path();
+        for (const auto& part : parent_path)
+            access_path += "." + part.string();
+
+        access_path += "." + PathToVarName(asset_path.filename().replace_extension("").string());
+        shaders.push_back(access_path);
+    }
+
+    if (shaders.empty())
+        return;
+
+    // Runs after the renderer globals so the shadow shader pipelines are created as well
+    WriteCSTR(stream, "\n    // Create the pipelines of every shader before the first frame\n");
+    WriteCSTR(stream, "    Shader* pipeline_shaders[] =\n    {\n");
+    for (const auto& shader : shaders)
+        WriteCSTR(stream, "        %s,\n", shader.c_str());
+    WriteCSTR(stream, "    };\n");
+    WriteCSTR(stream, "    PrewarmPipelines(pipeline_shaders, sizeof(pipeline_shaders) / sizeof(Shader*));\n");
+}
@@ -17,6 +17,8 @@ AssetImporterTraits* GetTextureImporterTraits();
 AssetImporterTraits* GetFontImporterTraits();
 AssetImporterTraits* GetMeshImporterTraits();
 AssetImporterTraits* GetStyleSheetImporterTraits();
+AssetImporterTraits* GetAtlasImporterTraits();
+bool FindImageAtlas(const fs::path& image_path, fs::path& atlas_path);
 
 struct ImportJob
 {
@@ -88,6 +90,14 @@ void ProcessFileChange(const fs::path& file_path, FileChangeType change_type, st
         return;
     }
 
+    // Images packed into an atlas re-import the atlas instead
+    fs::path atlas_path;
+    if (FindImageAtlas(file_path, atlas_path))
+    {
+        ProcessFileChange(atlas_path, change_type, importers);
+        return;
+    }
+
     // Find an importer that can handle this file based on extension
     AssetImporterTraits* selected_importer = nullptr;
     
@@ -284,7 +294,8 @@ int main(int argc, char* argv[])
         GetTextureImporterTraits(),
         GetFontImporterTraits(),
         GetMeshImporterTraits(),
-        GetStyleSheetImporterTraits()
+        GetStyleSheetImporterTraits(),
+        GetAtlasImporterTraits()
     };
 
     // Set up signal handler for Ctrl-C
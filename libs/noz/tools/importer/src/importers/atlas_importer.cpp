@@ -0,0 +1,373 @@
+//
+//  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
+//
+//  An .atlas file packs every image in the directory next to it with the same name, plus any
+//  images listed in its [images] group, into one or more texture pages.  Images are addressed at
+//  runtime by their path relative to the atlas directory without the extension.  Transparent
+//  borders are trimmed before packing and pages grow from the smallest size that could hold their
+//  images up to the configured page size.
+//
+
+#include <noz/asset.h>
+#include <noz/noz.h>
+#include <rect_packer.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "../external/stb_image.h"
+
+namespace fs = std::filesystem;
+
+using namespace noz;
+
+struct AtlasSourceImage
+{
+    std::string name;
+    fs::path path;
+    int width;
+    int height;
+    std::vector<uint8_t> rgba;
+    rect_packer::BinRect trim;
+    int page;
+    rect_packer::BinRect packed_rect;
+};
+
+struct AtlasPage
+{
+    rect_packer packer;
+    std::vector<uint8_t> rgba;
+};
+
+static const char* g_atlas_image_extensions[] = {
+    ".png",
+    ".jpg",
+    ".jpeg",
+    ".bmp",
+    ".tga",
+    ".gif",
+    nullptr
+};
+
+static bool IsAtlasImage(const fs::path& path)
+{
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    for (const char** e = g_atlas_image_extensions; *e; e++)
+        if (ext == *e)
+            return true;
+
+    return false;
+}
+
+static std::string GetImageName(const fs::path& path, const fs::path& directory)
+{
+    fs::path name = fs::relative(path, directory);
+    name.replace_extension("");
+    std::string result = name.string();
+    std::replace(result.begin(), result.end(), '\\', '/');
+    return result;
+}
+
+// Images inside a directory that has a sibling .atlas file belong to that atlas instead of being
+// imported as textures of their own
+bool FindImageAtlas(const fs::path& image_path, fs::path& atlas_path)
+{
+    if (!IsAtlasImage(image_path))
+        return false;
+
+    for (fs::path dir = image_path.parent_path(); dir.has_relative_path() && dir != dir.parent_path(); dir = dir.parent_path())
+    {
+        fs::path candidate = dir;
+        candidate += ".atlas";
+        if (fs::exists(candidate))
+        {
+            atlas_path = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static std::vector<AtlasSourceImage> LoadAtlasImages(const fs::path& source_path, Props* atlas)
+{
+    std::vector<AtlasSourceImage> images;
+
+    fs::path directory = source_path.parent_path() / atlas->GetString("atlas", "directory", source_path.stem().string().c_str());
+    if (fs::is_directory(directory))
+        for (const auto& entry : fs::recursive_directory_iterator(directory))
+            if (entry.is_regular_file() && IsAtlasImage(entry.path()))
+                images.push_back({ GetImageName(entry.path(), directory), entry.path() });
+
+    for (const auto& key : atlas->GetKeys("images"))
+    {
+        fs::path path = source_path.parent_path() / key;
+        images.push_back({ GetImageName(path, source_path.parent_path()), path });
+    }
+
+    // Directory iteration order is not stable across platforms
+    std::sort(images.begin(), images.end(), [](const AtlasSourceImage& a, const AtlasSourceImage& b) { return a.name < b.name; });
+
+    for (size_t i = 1; i < images.size(); i++)
+        if (images[i].name == images[i - 1].name)
+            throw std::runtime_error("Duplicate atlas image: " + images[i].name);
+
+    for (auto& image : images)
+    {
+        int channels;
+        stbi_uc* data = stbi_load(image.path.string().c_str(), &image.width, &image.height, &channels, 4);
+        if (!data)
+            throw std::runtime_error("Failed to load atlas image: " + image.path.string());
+
+        image.rgba.assign(data, data + image.width * image.height * 4);
+        image.trim = rect_packer::BinRect(0, 0, image.width, image.height);
+        stbi_image_free(data);
+    }
+
+    return images;
+}
+
+// Shrinks the rectangle to the texels with any alpha, a fully transparent image keeps one texel
+static void TrimImage(AtlasSourceImage& image)
+{
+    int min_x = image.width;
+    int min_y = image.height;
+    int max_x = -1;
+    int max_y = -1;
+    for (int y = 0; y < image.height; y++)
+    {
+        const uint8_t* row = image.rgba.data() + (size_t)y * image.width * 4;
+        for (int x = 0; x < image.width; x++)
+        {
+            if (row[x * 4 + 3] == 0)
+                continue;
+
+            min_x = std::min(min_x, x);
+            max_x = std::max(max_x, x);
+            min_y = std::min(min_y, y);
+            max_y = std::max(max_y, y);
+        }
+    }
+
+    if (max_x == -1)
+        image.trim = rect_packer::BinRect(0, 0, 1, 1);
+    else
+        image.trim = rect_packer::BinRect(min_x, min_y, max_x - min_x + 1, max_y - min_y + 1);
+}
+
+// Each page packs the remaining images largest first and grows until it reaches the page size,
+// whatever does not fit moves on to the next page
+static void PackImages(std::vector<AtlasSourceImage>& images, std::vector<AtlasPage>& pages, int page_size, int padding)
+{
+    std::vector<size_t> remaining;
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        auto& image = images[i];
+        if (image.trim.w + padding * 2 + 2 > page_size || image.trim.h + padding * 2 + 2 > page_size)
+            throw std::runtime_error("Atlas image does not fit in a page: " + image.name);
+
+        remaining.push_back(i);
+    }
+
+    rect_packer::BinSize max_size(page_size, page_size);
+    while (!remaining.empty())
+    {
+        std::vector<glm::ivec2> sizes;
+        for (size_t i : remaining)
+            sizes.push_back(glm::ivec2(images[i].trim.w, images[i].trim.h) + padding * 2);
+
+        rect_packer::BinSize start_size = rect_packer::GetStartSize(sizes, max_size);
+        pages.push_back({ rect_packer(start_size.w, start_size.h) });
+        AtlasPage& page = pages.back();
+
+        std::vector<size_t> next;
+        for (size_t i : rect_packer::GetPackingOrder(sizes))
+        {
+            auto& image = images[remaining[i]];
+            if (-1 == page.packer.Insert(sizes[i], rect_packer::method::BestAreaFit, image.packed_rect, max_size))
+                next.push_back(remaining[i]);
+            else
+                image.page = (int)pages.size() - 1;
+        }
+
+        if (!page.packer.validate())
+            throw std::runtime_error("RectPacker validation failed");
+
+        printf("atlas page %d: %dx%d, %.1f%% occupied\n", (int)pages.size() - 1, page.packer.size().w, page.packer.size().h, page.packer.GetOccupancy() * 100.0f);
+
+        remaining = std::move(next);
+    }
+}
+
+// The padding around each image repeats its edge texels so linear filtering never pulls in a
+// neighbour
+static void BlitImage(AtlasPage& page, const AtlasSourceImage& image, int padding)
+{
+    int page_width = page.packer.size().w;
+    for (int y = 0; y < image.packed_rect.h; y++)
+    {
+        int src_y = image.trim.y + std::clamp(y - padding, 0, image.trim.h - 1);
+        uint8_t* dst = page.rgba.data() + ((image.packed_rect.y + y) * page_width + image.packed_rect.x) * 4;
+        for (int x = 0; x < image.packed_rect.w; x++, dst += 4)
+        {
+            int src_x = image.trim.x + std::clamp(x - padding, 0, image.trim.w - 1);
+            memcpy(dst, image.rgba.data() + (src_y * image.width + src_x) * 4, 4);
+        }
+    }
+}
+
+// Pages are written as complete texture assets so the runtime loads them with LoadTexture
+static void WritePage(Stream* stream, const AtlasPage& page, bool linear)
+{
+    AssetHeader header = {};
+    header.signature = ASSET_SIGNATURE_TEXTURE;
+    header.version = 2;
+    header.flags = 0;
+    WriteAssetHeader(stream, &header);
+
+    WriteU32(stream, TEXTURE_FORMAT_RGBA8);
+    WriteU32(stream, (uint32_t)page.packer.size().w);
+    WriteU32(stream, (uint32_t)page.packer.size().h);
+    WriteU8(stream, linear ? TEXTURE_FILTER_LINEAR : TEXTURE_FILTER_NEAREST);
+    WriteU8(stream, linear ? TEXTURE_FILTER_LINEAR : TEXTURE_FILTER_NEAREST);
+    WriteU8(stream, TEXTURE_CLAMP_CLAMP);
+    WriteU8(stream, TEXTURE_CLAMP_CLAMP);
+    WriteU8(stream, TEXTURE_CLAMP_CLAMP);
+    WriteBool(stream, false);
+    WriteU32(stream, (uint32_t)page.rgba.size());
+    WriteBytes(stream, (void*)page.rgba.data(), page.rgba.size());
+}
+
+static void WriteAtlasData(Stream* stream, const std::vector<AtlasSourceImage>& images, const std::vector<AtlasPage>& pages, int padding, bool linear)
+{
+    AssetHeader header = {};
+    header.signature = ASSET_SIGNATURE_ATLAS;
+    header.version = 2;
+    header.flags = 0;
+    WriteAssetHeader(stream, &header);
+
+    // Images are sorted by name hash so the runtime can binary search them
+    std::vector<std::pair<uint64_t, const AtlasSourceImage*>> sorted;
+    for (const auto& image : images)
+        sorted.push_back({ Hash(image.name.c_str()), &image });
+
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (size_t i = 1; i < sorted.size(); i++)
+        if (sorted[i].first == sorted[i - 1].first)
+            throw std::runtime_error("Atlas image name hash collision: " + sorted[i].second->name);
+
+    WriteU32(stream, (uint32_t)pages.size());
+    WriteU32(stream, (uint32_t)sorted.size());
+    for (const auto& [hash, image] : sorted)
+    {
+        const AtlasPage& page = pages[image->page];
+        float page_width = (float)page.packer.size().w;
+        float page_height = (float)page.packer.size().h;
+        WriteU64(stream, hash);
+        WriteU32(stream, (uint32_t)image->page);
+        WriteFloat(stream, (image->packed_rect.x + padding) / page_width);
+        WriteFloat(stream, (image->packed_rect.y + padding) / page_height);
+        WriteFloat(stream, (image->packed_rect.x + padding + image->trim.w) / page_width);
+        WriteFloat(stream, (image->packed_rect.y + padding + image->trim.h) / page_height);
+        WriteU32(stream, (uint32_t)image->width);
+        WriteU32(stream, (uint32_t)image->height);
+        WriteFloat(stream, image->trim.x / (float)image->width);
+        WriteFloat(stream, image->trim.y / (float)image->height);
+        WriteFloat(stream, (image->trim.x + image->trim.w) / (float)image->width);
+        WriteFloat(stream, (image->trim.y + image->trim.h) / (float)image->height);
+    }
+
+    for (const auto& page : pages)
+        WritePage(stream, page, linear);
+}
+
+void ImportAtlas(const fs::path& source_path, Stream* output_stream, Props* config, Props* meta)
+{
+    Props* atlas = nullptr;
+    if (Stream* atlas_stream = LoadStream(nullptr, source_path))
+    {
+        atlas = Props::Load(atlas_stream);
+        Destroy(atlas_stream);
+    }
+
+    if (!atlas)
+        throw std::runtime_error("Failed to load atlas file");
+
+    int page_size = atlas->GetInt("atlas", "size", 1024);
+    int padding = atlas->GetInt("atlas", "padding", 2);
+    std::string filter = atlas->GetString("atlas", "filter", "linear");
+    bool convert_from_srgb = atlas->GetBool("atlas", "srgb", false);
+    bool premultiply_alpha = atlas->GetBool("atlas", "premultiply_alpha", false);
+    bool trim = atlas->GetBool("atlas", "trim", true);
+
+    std::vector<AtlasSourceImage> images;
+    try
+    {
+        images = LoadAtlasImages(source_path, atlas);
+    }
+    catch (...)
+    {
+        delete atlas;
+        throw;
+    }
+
+    delete atlas;
+
+    if (images.empty())
+        throw std::runtime_error("Atlas has no images");
+
+    if (page_size <= 0 || padding < 0)
+        throw std::runtime_error("Invalid atlas size or padding");
+
+    if (trim)
+        for (auto& image : images)
+            TrimImage(image);
+
+    std::vector<AtlasPage> pages;
+    PackImages(images, pages, page_size, padding);
+
+    for (auto& page : pages)
+        page.rgba.resize((size_t)page.packer.size().w * page.packer.size().h * 4, 0);
+
+    for (const auto& image : images)
+        BlitImage(pages[image.page], image, padding);
+
+    for (auto& page : pages)
+    {
+        size_t pixel_count = page.rgba.size() / 4;
+        if (convert_from_srgb)
+            ConvertSRGBToLinear(page.rgba.data(), pixel_count, 4);
+
+        if (premultiply_alpha)
+            PremultiplyAlpha(page.rgba.data(), pixel_count);
+    }
+
+    WriteAtlasData(output_stream, images, pages, padding, filter != "nearest" && filter != "point");
+}
+
+bool DoesAtlasDependOn(const fs::path& source_path, const fs::path& dependency_path)
+{
+    fs::path meta_path = fs::path(source_path.string() + ".meta");
+    return meta_path == dependency_path;
+}
+
+static const char* g_atlas_extensions[] = {
+    ".atlas",
+    nullptr
+};
+
+static AssetImporterTraits g_atlas_importer_traits = {
+    .type_name = "Atlas",
+    .type = TYPE_ATLAS,
+    .signature = ASSET_SIGNATURE_ATLAS,
+    .file_extensions = g_atlas_extensions,
+    .import_func = ImportAtlas,
+    .does_depend_on = DoesAtlasDependOn
+};
+
+AssetImporterTraits* GetAtlasImporterTraits()
+{
+    return &g_atlas_importer_traits;
+}
@@ -10,9 +10,18 @@
 #include <rect_packer.h>
 #include <ttf/TrueTypeFont.h>
 #include <msdf/msdf.h>
+#include <msdf/Shape.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -28,7 +37,7 @@ struct FontGlyph
     ivec2 advance;
     rect_packer::BinRect packedRect;
     ivec2 bearing;
-    char ascii;
+    uint32_t codepoint;
 };
 
 struct FontKerning
@@ -46,23 +55,167 @@ struct FontMetrics
     float baseline;
 };
 
+static FontGlyph CreateGlyph(const ttf::TrueTypeFont::Glyph* ttfGlyph, int sdfPadding, int padding)
+{
+    FontGlyph glyph{};
+    glyph.codepoint = ttfGlyph->codepoint;
+    glyph.ttf = ttfGlyph;
+    // The tile holds the glyph and its distance field border, the scale only absorbs the rounding
+    glyph.size = noz::RoundToNearest(ttfGlyph->size + glm::dvec2(sdfPadding * 2));
+    glyph.scale = glm::dvec2(glyph.size.x, glyph.size.y) / (ttfGlyph->size + glm::dvec2(sdfPadding * 2));
+    glyph.packedSize = glyph.size + padding * 2;
+    glyph.bearing = noz::RoundToNearest(ttfGlyph->bearing);
+    glyph.advance.x = noz::RoundToNearest((float)ttfGlyph->advance);
+    return glyph;
+}
+
+// Offset from glyph space to the texels of its tile, before the glyph scale is applied
+static glm::dvec2 GetGlyphTranslate(const FontGlyph& glyph, int sdfPadding)
+{
+    return glm::dvec2(
+        -glyph.ttf->bearing.x + sdfPadding,
+        (glyph.ttf->size.y - glyph.ttf->bearing.y) + sdfPadding);
+}
+
+// The quad of a glyph covers its whole texture rectangle, gutter included, in pixels of the
+// imported size from the pen on the baseline with y pointing down.  Texel t of the tile holds the
+// glyph at t / scale - translate, so the outline shows at its true size and position.
+static void GetGlyphQuad(
+    const FontGlyph& glyph,
+    const glm::ivec2& tileSize,
+    int sdfPadding,
+    int padding,
+    glm::dvec2& bearing,
+    glm::dvec2& size)
+{
+    auto translate = GetGlyphTranslate(glyph, sdfPadding);
+    double left = -padding / glyph.scale.x - translate.x;
+    double right = (tileSize.x + padding) / glyph.scale.x - translate.x;
+    double top = translate.y - (tileSize.y + padding) / glyph.scale.y;
+    double bottom = translate.y + padding / glyph.scale.y;
+    bearing = glm::dvec2(left, top);
+    size = glm::dvec2(right - left, bottom - top);
+}
+
+// Every character of the basic multilingual plane as UTF-8, surrogates are skipped
+static std::string GetAllCharacters()
+{
+    std::string characters;
+    for (uint32_t c = 0x20; c < 0x10000; c++)
+    {
+        if (c >= 0xD800 && c <= 0xDFFF)
+            continue;
+
+        if (c < 0x80)
+            characters += (char)c;
+        else if (c < 0x800)
+        {
+            characters += (char)(0xC0 | (c >> 6));
+            characters += (char)(0x80 | (c & 0x3F));
+        }
+        else
+        {
+            characters += (char)(0xE0 | (c >> 12));
+            characters += (char)(0x80 | ((c >> 6) & 0x3F));
+            characters += (char)(0x80 | (c & 0x3F));
+        }
+    }
+
+    return characters;
+}
+
+// Each contour is written as quadratic segments, a start point followed by a control point per
+// segment.  Lines use their midpoint as the control point so the runtime only handles curves.
+static void WriteFontOutlines(
+    Stream* stream,
+    const std::vector<FontGlyph>& outlines,
+    const std::vector<std::unique_ptr<msdf::Shape>>& shapes,
+    int fontSize,
+    int sdfPadding,
+    int padding)
+{
+    uint32_t contourTotal = 0;
+    uint32_t pointTotal = 0;
+    for (const auto& shape : shapes)
+    {
+        for (auto contour : shape->contours)
+        {
+            contourTotal++;
+            pointTotal += (uint32_t)contour->edges.size() * 2;
+        }
+    }
+
+    WriteU32(stream, static_cast<uint32_t>(outlines.size()));
+    if (outlines.empty())
+        return;
+
+    WriteFloat(stream, (float)sdfPadding);
+    WriteU32(stream, static_cast<uint32_t>(padding));
+    WriteU32(stream, contourTotal);
+    WriteU32(stream, pointTotal);
+
+    for (size_t i = 0; i < outlines.size(); i++)
+    {
+        const auto& outline = outlines[i];
+        auto translate = GetGlyphTranslate(outline, sdfPadding);
+        glm::dvec2 quadBearing;
+        glm::dvec2 quadSize;
+        GetGlyphQuad(outline, outline.packedSize - padding * 2, sdfPadding, padding, quadBearing, quadSize);
+        WriteU32(stream, outline.codepoint);
+        WriteFloat(stream, float(quadSize.x) / fontSize);
+        WriteFloat(stream, float(quadSize.y) / fontSize);
+        WriteFloat(stream, float(outline.advance.x) / fontSize);
+        WriteFloat(stream, float(quadBearing.x) / fontSize);
+        WriteFloat(stream, float(quadBearing.y) / fontSize);
+        WriteFloat(stream, (float)outline.scale.x);
+        WriteFloat(stream, (float)outline.scale.y);
+        WriteFloat(stream, (float)translate.x);
+        WriteFloat(stream, (float)translate.y);
+        WriteU32(stream, static_cast<uint32_t>(outline.packedSize.x - padding * 2));
+        WriteU32(stream, static_cast<uint32_t>(outline.packedSize.y - padding * 2));
+        WriteU32(stream, static_cast<uint32_t>(shapes[i]->contours.size()));
+        for (auto contour : shapes[i]->contours)
+        {
+            WriteU32(stream, static_cast<uint32_t>(contour->edges.size() * 2));
+            for (auto edge : contour->edges)
+            {
+                auto start = edge->point(0.0);
+                auto control = (start + edge->point(1.0)) * 0.5;
+                if (auto quadratic = dynamic_cast<const msdf::QuadraticEdge*>(edge))
+                    control = quadratic->p1;
+
+                WriteFloat(stream, (float)start.x);
+                WriteFloat(stream, (float)start.y);
+                WriteFloat(stream, (float)control.x);
+                WriteFloat(stream, (float)control.y);
+            }
+        }
+    }
+}
+
 static void WriteFontData(
     Stream* stream,
     const ttf::TrueTypeFont* ttf,
     const std::vector<unsigned char>& atlasData,
     const glm::ivec2& atlasSize,
     const std::vector<FontGlyph>& glyphs,
-    int fontSize)
+    const std::vector<FontGlyph>& outlines,
+    const std::vector<std::unique_ptr<msdf::Shape>>& outlineShapes,
+    int fontSize,
+    FontType fontType,
+    int sdfPadding,
+    int padding)
 {
     // Write asset header
     AssetHeader header = {};
     header.signature = ASSET_SIGNATURE_FONT;
-    header.version = 1;
+    header.version = 5;
     header.flags = 0;
     WriteAssetHeader(stream, &header);
 
     // Write font size (this is important for runtime scaling)
     WriteU32(stream, static_cast<uint32_t>(fontSize));
+    WriteU32(stream, static_cast<uint32_t>(fontType));
 
     // Write atlas dimensions
     WriteU32(stream, static_cast<uint32_t>(atlasSize.x));
@@ -74,35 +227,68 @@ static void WriteFontData(
     WriteFloat(stream, float(ttf->height()) / fontSize);
     WriteFloat(stream, float(ttf->ascent()) / fontSize);
 
-    // Write glyph count and glyph data
-    WriteU16(stream, static_cast<uint16_t>(glyphs.size()));
+    // Codepoints and glyphs are written as two arrays sorted by codepoint so the runtime can read
+    // each with a single copy
+    WriteU32(stream, static_cast<uint32_t>(glyphs.size()));
+    for (const auto& glyph : glyphs)
+        WriteU32(stream, glyph.codepoint);
+
     for (const auto& glyph : glyphs)
     {
-        WriteU32(stream, glyph.ascii);
+        glm::dvec2 quadBearing;
+        glm::dvec2 quadSize;
+        GetGlyphQuad(
+            glyph,
+            glm::ivec2(glyph.packedRect.w, glyph.packedRect.h) - padding * 2,
+            sdfPadding,
+            padding,
+            quadBearing,
+            quadSize);
         WriteFloat(stream, glyph.packedRect.x / float(atlasSize.x));
         WriteFloat(stream, glyph.packedRect.y / float(atlasSize.y));
         WriteFloat(stream, (glyph.packedRect.x + glyph.packedRect.w) / float(atlasSize.x));
         WriteFloat(stream, (glyph.packedRect.y + glyph.packedRect.h) / float(atlasSize.y));
-        WriteFloat(stream, float(glyph.size.x) / fontSize);
-        WriteFloat(stream, float(glyph.size.y) / fontSize);
+        WriteFloat(stream, float(quadSize.x) / fontSize);
+        WriteFloat(stream, float(quadSize.y) / fontSize);
         WriteFloat(stream, float(glyph.advance.x) / fontSize);
+        WriteFloat(stream, float(quadBearing.x) / fontSize);
+        WriteFloat(stream, float(quadBearing.y) / fontSize);
         WriteFloat(stream, 0.0f);
-        WriteFloat(stream, float(glyph.bearing.x) / fontSize);
-        WriteFloat(stream, float(-glyph.bearing.y) / fontSize);
         WriteFloat(stream, 0.0f);
     }
 
-    // Write kerning count and kerning data
-    WriteU16(stream, static_cast<uint16_t>(ttf->kerning().size()));
-    for (const auto& k : ttf->kerning())
+    // Kerning pairs sorted by first then second codepoint for binary search
+    std::vector<ttf::TrueTypeFont::Kerning> kerning = ttf->kerning();
+    std::sort(kerning.begin(), kerning.end(), [](const auto& a, const auto& b)
+    {
+        return a.left != b.left ? a.left < b.left : a.right < b.right;
+    });
+    kerning.erase(std::unique(kerning.begin(), kerning.end(), [](const auto& a, const auto& b)
+    {
+        return a.left == b.left && a.right == b.right;
+    }), kerning.end());
+
+    WriteU32(stream, static_cast<uint32_t>(kerning.size()));
+    for (const auto& k : kerning)
     {
         WriteU32(stream, k.left);
         WriteU32(stream, k.right);
         WriteFloat(stream, k.value);
     }
 
+    WriteFontOutlines(stream, outlines, outlineShapes, fontSize, sdfPadding, padding);
+
     WriteBytes(stream, (void*)atlasData.data(), atlasData.size());
 }
+
+static FontType ParseFontType(const std::string& type)
+{
+    if (type == "sdf") return FONT_TYPE_SDF;
+    if (type == "msdf") return FONT_TYPE_MSDF;
+    if (type == "mtsdf") return FONT_TYPE_MTSDF;
+    throw std::runtime_error("Unknown font type '" + type + "'");
+}
+
 void ImportFont(const fs::path& source_path, Stream* output_stream, Props* config, Props* meta)
 {
     fs::path src_path = source_path;
@@ -113,6 +299,11 @@ void ImportFont(const fs::path& source_path, Stream* output_stream, Props* confi
     int sdfPadding = meta->GetInt("font", "sdfPadding", 8);
     int padding = meta->GetInt("font", "padding", 1);
 
+    // Multi-channel fonts keep sharp corners at a much smaller size, msdf stores the field in
+    // RGB and mtsdf adds the true distance in alpha for effects such as outlines and glows
+    FontType fontType = ParseFontType(meta->GetString("font", "type", "sdf"));
+    int channels = fontType == FONT_TYPE_SDF ? 1 : 4;
+
     // Load font file
     std::ifstream file(src_path, std::ios::binary);
     if (!file.is_open())
@@ -134,50 +325,66 @@ void ImportFont(const fs::path& source_path, Stream* output_stream, Props* confi
     Stream* stream = LoadStream(nullptr, fontData.data(), fontData.size());
     auto ttf = std::shared_ptr<ttf::TrueTypeFont>(ttf::TrueTypeFont::load(stream, fontSize, characters));
 
-    // Build the imported glyph list
+    // Build the imported glyph list in codepoint order, characters is UTF-8
     std::vector<FontGlyph> glyphs;
-    for (size_t i = 0; i < characters.size(); i++)
+    for (auto ttfGlyph : ttf->glyphs())
     {
-        auto ttfGlyph = ttf->glyph(characters[i]);
         if (ttfGlyph == nullptr)
             continue;
 
-        FontGlyph iglyph{};
-        iglyph.ascii = characters[i];
-        iglyph.ttf = ttfGlyph;
-
-        iglyph.size = noz::RoundToNearest(ttfGlyph->size + glm::dvec2(sdfPadding * 2));
-        iglyph.scale = glm::dvec2(iglyph.size.x, iglyph.size.y) / ttfGlyph->size;
-        iglyph.packedSize = iglyph.size + (padding + sdfPadding) * 2;
-        iglyph.bearing = noz::RoundToNearest(ttfGlyph->bearing);
-        iglyph.advance.x = noz::RoundToNearest((float)ttfGlyph->advance);
-
-        glyphs.push_back(iglyph);
+        glyphs.push_back(CreateGlyph(ttfGlyph, sdfPadding, padding));
     }
 
-    // Pack the glyphs
-    int minHeight = (int)noz::NextPowerOf2((uint32_t)(fontSize + 2 + sdfPadding * 2 + padding * 2));
-    rect_packer packer(minHeight, minHeight);
-
-    while (packer.empty())
+    // Dynamic fonts also carry the outlines of every other glyph in the font so the runtime can
+    // rasterize characters such as player names on demand
+    std::shared_ptr<ttf::TrueTypeFont> dynamicTtf;
+    std::vector<FontGlyph> outlines;
+    std::vector<std::unique_ptr<msdf::Shape>> outlineShapes;
+    if (meta->GetBool("font", "dynamic", false))
     {
-        for(auto& glyph : glyphs)
+        SetPosition(stream, 0);
+        dynamicTtf = std::shared_ptr<ttf::TrueTypeFont>(ttf::TrueTypeFont::load(stream, fontSize, GetAllCharacters()));
+        for (auto ttfGlyph : dynamicTtf->glyphs())
         {
-            if (glyph.ttf->contours.size() == 0)
+            if (ttfGlyph == nullptr || ttf->glyph(ttfGlyph->codepoint) != nullptr)
                 continue;
 
-            if (-1 == packer.Insert(glyph.packedSize, rect_packer::method::BestLongSideFit, glyph.packedRect))
+            // Glyphs with broken outlines are left out rather than failing the whole font
+            try
             {
-                rect_packer::BinSize size = packer.size();
-                if (size.w <= size.h)
-                    size.w <<= 1;
-                else
-                    size.h <<= 1;
-
-                packer.Resize(size.w, size.h);
-                break;
+                outlineShapes.emplace_back(msdf::Shape::fromGlyph(ttfGlyph, true));
+            }
+            catch (const std::exception&)
+            {
+                continue;
             }
+
+            outlines.push_back(CreateGlyph(ttfGlyph, sdfPadding, padding));
         }
+
+        printf("%s: stored %zu outlines for dynamic glyphs\n", source_path.filename().string().c_str(), outlines.size());
+    }
+
+    // Pack the glyphs largest first, growing the atlas in place whenever one does not fit
+    std::vector<glm::ivec2> packedSizes;
+    std::vector<size_t> packedGlyphs;
+    for (size_t i = 0; i < glyphs.size(); i++)
+    {
+        if (glyphs[i].ttf->contours.size() == 0)
+            continue;
+
+        packedSizes.push_back(glyphs[i].packedSize);
+        packedGlyphs.push_back(i);
+    }
+
+    rect_packer::BinSize maxSize(8192, 8192);
+    rect_packer::BinSize startSize = rect_packer::GetStartSize(packedSizes, maxSize);
+    rect_packer packer(startSize.w, startSize.h);
+    for (size_t i : rect_packer::GetPackingOrder(packedSizes))
+    {
+        auto& glyph = glyphs[packedGlyphs[i]];
+        if (-1 == packer.Insert(glyph.packedSize, rect_packer::method::BestLongSideFit, glyph.packedRect, maxSize))
+            throw std::runtime_error("Font atlas exceeds the maximum size");
     }
 
     if (!packer.validate())
@@ -185,38 +392,92 @@ void ImportFont(const fs::path& source_path, Stream* output_stream, Props* confi
         throw std::runtime_error("RectPacker validation failed");
     }
 
+    printf("%s: atlas %dx%d, %.1f%% occupied\n",
+        source_path.filename().string().c_str(),
+        packer.size().w,
+        packer.size().h,
+        packer.GetOccupancy() * 100.0f);
+
     auto imageSize = glm::ivec2(packer.size().w, packer.size().h);
     std::vector<uint8_t> image;
-    image.resize(imageSize.x * imageSize.y, 0);
-
-    for (size_t i = 0; i < glyphs.size(); i++)
+    image.resize((size_t)imageSize.x * imageSize.y * channels, 0);
+
+    // Packed glyphs never overlap, so each worker renders a glyph into its own tile and copies it
+    // into the atlas without locking.  Glyphs are handed out largest first to balance the workers.
+    std::vector<size_t> renderOrder;
+    for (size_t i : rect_packer::GetPackingOrder(packedSizes))
+        renderOrder.push_back(packedGlyphs[i]);
+
+    auto renderStart = std::chrono::steady_clock::now();
+    std::atomic<size_t> nextGlyph = 0;
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto worker = [&]()
     {
-        auto glyph = glyphs[i];
-        if (glyph.ttf->contours.size() == 0)
-            continue;
-
-        msdf::renderGlyph(
-            glyph.ttf,
-            image,
-            imageSize.x,
-            glm::ivec2(
-                glyph.packedRect.x + padding,
-                glyph.packedRect.y + padding
-            ),
-            glm::ivec2(
+        std::vector<uint8_t> tile;
+        for (size_t i = nextGlyph++; i < renderOrder.size(); i = nextGlyph++)
+        {
+            const auto& glyph = glyphs[renderOrder[i]];
+            auto tileSize = glm::ivec2(
                 glyph.packedRect.w - padding * 2,
-                glyph.packedRect.h - padding * 2
-            ),
-            sdfPadding,
-            glyph.scale,
-            glm::dvec2(
-                -glyph.ttf->bearing.x + sdfPadding,
-                (glyph.ttf->size.y - glyph.ttf->bearing.y) + sdfPadding
-            )
-        );
-    }
+                glyph.packedRect.h - padding * 2);
+
+            auto translate = GetGlyphTranslate(glyph, sdfPadding);
+
+            try
+            {
+                tile.assign((size_t)tileSize.x * tileSize.y * channels, 0);
+                if (fontType == FONT_TYPE_SDF)
+                    msdf::renderGlyph(glyph.ttf, tile, tileSize.x, glm::ivec2(0, 0), tileSize, sdfPadding, glyph.scale, translate);
+                else
+                    msdf::renderGlyphMSDF(
+                        glyph.ttf,
+                        tile,
+                        tileSize.x,
+                        glm::ivec2(0, 0),
+                        tileSize,
+                        sdfPadding,
+                        glyph.scale,
+                        translate,
+                        fontType == FONT_TYPE_MTSDF);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error)
+                    error = std::current_exception();
+                nextGlyph = renderOrder.size();
+                return;
+            }
+
+            size_t rowSize = (size_t)tileSize.x * channels;
+            uint8_t* dst = image.data() + ((size_t)(glyph.packedRect.y + padding) * imageSize.x + glyph.packedRect.x + padding) * channels;
+            for (int y = 0; y < tileSize.y; y++)
+                memcpy(dst + (size_t)y * imageSize.x * channels, tile.data() + y * rowSize, rowSize);
+        }
+    };
+
+    int threadCount = std::clamp((int)std::thread::hardware_concurrency(), 1, std::max((int)renderOrder.size(), 1));
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; i++)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    if (error)
+        std::rethrow_exception(error);
+
+    auto renderTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - renderStart);
+    printf("%s: rendered %zu glyphs in %.1f ms on %d threads\n",
+        source_path.filename().string().c_str(),
+        renderOrder.size(),
+        renderTime.count(),
+        threadCount);
 
-    WriteFontData(output_stream, ttf.get(), image, imageSize, glyphs, fontSize);
+    WriteFontData(output_stream, ttf.get(), image, imageSize, glyphs, outlines, outlineShapes, fontSize, fontType, sdfPadding, padding);
 }
 
 bool DoesFontDependOn(const fs::path& source_path, const fs::path& dependency_path)
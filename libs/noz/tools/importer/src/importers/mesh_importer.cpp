@@ -8,7 +8,9 @@
 #include <filesystem>
 #include <noz/asset.h>
 #include <noz/noz.h>
+#include <queue>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -21,16 +23,16 @@ static void FlattenMesh(GLTFMesh* mesh)
     struct TriangleInfo
     {
         float maxZ;
-        uint16_t i0, i1, i2;
+        uint32_t i0, i1, i2;
     };
     std::vector<TriangleInfo> triangles;
 
     // Process each triangle (3 consecutive indices)
     for (size_t i = 0; i < mesh->indices.size(); i += 3)
     {
-        uint16_t idx0 = mesh->indices[i];
-        uint16_t idx1 = mesh->indices[i + 1];
-        uint16_t idx2 = mesh->indices[i + 2];
+        uint32_t idx0 = mesh->indices[i];
+        uint32_t idx1 = mesh->indices[i + 1];
+        uint32_t idx2 = mesh->indices[i + 2];
 
         // Find the maximum y value in this triangle
         float maxZ = std::max({
@@ -65,16 +67,780 @@ static void FlattenMesh(GLTFMesh* mesh)
     }
 }
 
+// Spread the lower 10 bits of value so there are two zero bits between each of them
+static uint32_t SpreadBits(uint32_t value)
+{
+    value &= 0x3FF;
+    value = (value | (value << 16)) & 0x030000FF;
+    value = (value | (value << 8)) & 0x0300F00F;
+    value = (value | (value << 4)) & 0x030C30C3;
+    value = (value | (value << 2)) & 0x09249249;
+    return value;
+}
+
+// Reorder the triangles along a Morton curve through the mesh bounds and cut the result into
+// clusters of at most cluster_triangles triangles.  Neighbouring triangles end up in the same
+// cluster which keeps the cluster bounds tight for culling.
+static std::vector<MeshCluster> BuildClusters(GLTFMesh* mesh, const bounds3& bounds, size_t cluster_triangles)
+{
+    std::vector<MeshCluster> clusters;
+    size_t triangle_count = mesh->indices.size() / 3;
+    if (cluster_triangles == 0 || triangle_count <= cluster_triangles)
+        return clusters;
+
+    struct TriangleKey
+    {
+        uint32_t key;
+        uint32_t triangle;
+    };
+
+    vec3 size = bounds.max - bounds.min;
+    vec3 scale = vec3(
+        size.x > 0.0f ? 1023.0f / size.x : 0.0f,
+        size.y > 0.0f ? 1023.0f / size.y : 0.0f,
+        size.z > 0.0f ? 1023.0f / size.z : 0.0f);
+
+    std::vector<TriangleKey> keys(triangle_count);
+    for (size_t t = 0; t < triangle_count; t++)
+    {
+        vec3 centroid =
+            (mesh->positions[mesh->indices[t * 3 + 0]] +
+             mesh->positions[mesh->indices[t * 3 + 1]] +
+             mesh->positions[mesh->indices[t * 3 + 2]]) / 3.0f;
+        uvec3 cell = uvec3((centroid - bounds.min) * scale);
+        keys[t] = { SpreadBits(cell.x) | (SpreadBits(cell.y) << 1) | (SpreadBits(cell.z) << 2), (uint32_t)t };
+    }
+
+    std::stable_sort(keys.begin(), keys.end(),
+        [](const TriangleKey& a, const TriangleKey& b)
+        {
+            return a.key < b.key;
+        });
+
+    std::vector<uint32_t> indices(triangle_count * 3);
+    for (size_t t = 0; t < triangle_count; t++)
+    {
+        indices[t * 3 + 0] = mesh->indices[keys[t].triangle * 3 + 0];
+        indices[t * 3 + 1] = mesh->indices[keys[t].triangle * 3 + 1];
+        indices[t * 3 + 2] = mesh->indices[keys[t].triangle * 3 + 2];
+    }
+    mesh->indices.swap(indices);
+
+    for (size_t first = 0; first < triangle_count; first += cluster_triangles)
+    {
+        size_t count = std::min(cluster_triangles, triangle_count - first);
+        MeshCluster cluster = {};
+        cluster.index_offset = static_cast<uint32_t>(first * 3);
+        cluster.index_count = static_cast<uint32_t>(count * 3);
+        cluster.bounds.min = cluster.bounds.max = mesh->positions[mesh->indices[first * 3]];
+        for (size_t i = cluster.index_offset; i < cluster.index_offset + cluster.index_count; i++)
+            cluster.bounds = expand(cluster.bounds, mesh->positions[mesh->indices[i]]);
+
+        clusters.push_back(cluster);
+    }
+
+    return clusters;
+}
+
+// @optimize
+
+constexpr int VERTEX_CACHE_SIZE = 32;
+constexpr uint32_t VERTEX_FIFO_SIZE = 16;
+
+struct WeldVertex
+{
+    vec3 position;
+    vec3 normal;
+    vec2 uv;
+    uint32_t bone;
+
+    bool operator==(const WeldVertex& other) const
+    {
+        return memcmp(this, &other, sizeof(WeldVertex)) == 0;
+    }
+};
+
+struct WeldVertexHash
+{
+    size_t operator()(const WeldVertex& vertex) const
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&vertex);
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(WeldVertex); i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        return static_cast<size_t>(hash);
+    }
+};
+
+struct VertexCacheStats
+{
+    float acmr;
+    float atvr;
+};
+
+// Vertices transformed per triangle (ACMR) and per vertex (ATVR) when drawn through a 16 entry
+// FIFO, the usual model of the post transform cache
+static VertexCacheStats GetVertexCacheStats(const GLTFMesh* mesh)
+{
+    VertexCacheStats stats = {};
+    size_t triangle_count = mesh->indices.size() / 3;
+    if (triangle_count == 0 || mesh->positions.empty())
+        return stats;
+
+    // A vertex is still cached when fewer than VERTEX_FIFO_SIZE misses happened since its own
+    std::vector<uint32_t> timestamps(mesh->positions.size(), 0);
+    uint32_t misses = 0;
+    for (uint32_t index : mesh->indices)
+    {
+        if (timestamps[index] != 0 && misses - timestamps[index] < VERTEX_FIFO_SIZE)
+            continue;
+
+        timestamps[index] = ++misses;
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(triangle_count);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(mesh->positions.size());
+    return stats;
+}
+
+// Merge vertices with bitwise identical attributes.  Exporters write a vertex per face corner
+// for split or flat shaded meshes and most of those are duplicates.
+static void WeldVertices(GLTFMesh* mesh)
+{
+    size_t vertex_count = mesh->positions.size();
+
+    // Attributes that do not cover every vertex are ignored when writing, drop them up front so
+    // they can not line up with the welded vertices by accident
+    if (mesh->normals.size() != vertex_count)
+        mesh->normals.clear();
+    if (mesh->uvs.size() != vertex_count)
+        mesh->uvs.clear();
+    if (mesh->bone_indices.size() != vertex_count)
+        mesh->bone_indices.clear();
+
+    std::unordered_map<WeldVertex, uint32_t, WeldVertexHash> unique;
+    unique.reserve(vertex_count);
+
+    std::vector<uint32_t> remap(vertex_count);
+    GLTFMesh welded;
+    for (size_t i = 0; i < vertex_count; i++)
+    {
+        WeldVertex vertex = {};
+        vertex.position = mesh->positions[i];
+        if (!mesh->normals.empty())
+            vertex.normal = mesh->normals[i];
+        if (!mesh->uvs.empty())
+            vertex.uv = mesh->uvs[i];
+        if (!mesh->bone_indices.empty())
+            vertex.bone = mesh->bone_indices[i];
+
+        auto result = unique.emplace(vertex, static_cast<uint32_t>(welded.positions.size()));
+        remap[i] = result.first->second;
+        if (!result.second)
+            continue;
+
+        welded.positions.push_back(mesh->positions[i]);
+        if (!mesh->normals.empty())
+            welded.normals.push_back(mesh->normals[i]);
+        if (!mesh->uvs.empty())
+            welded.uvs.push_back(mesh->uvs[i]);
+        if (!mesh->bone_indices.empty())
+            welded.bone_indices.push_back(mesh->bone_indices[i]);
+    }
+
+    for (uint32_t& index : mesh->indices)
+        index = remap[index];
+
+    mesh->positions.swap(welded.positions);
+    mesh->normals.swap(welded.normals);
+    mesh->uvs.swap(welded.uvs);
+    mesh->bone_indices.swap(welded.bone_indices);
+}
+
+static float GetVertexScore(int cache_position, uint32_t remaining_triangles)
+{
+    if (remaining_triangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cache_position >= 0)
+    {
+        // The vertices of the last triangle get a fixed score so the next triangle is not
+        // chosen just because it shares an edge with it
+        if (cache_position < 3)
+            score = 0.75f;
+        else
+            score = powf(1.0f - static_cast<float>(cache_position - 3) / (VERTEX_CACHE_SIZE - 3), 1.5f);
+    }
+
+    // Vertices with few triangles left are boosted so they get finished and leave the cache
+    return score + 2.0f * powf(static_cast<float>(remaining_triangles), -0.5f);
+}
+
+// Reorder a range of triangles for post transform vertex cache hits with Tom Forsyth's linear
+// speed vertex cache optimization.  Each step emits the triangle with the highest score among
+// those touching the simulated LRU cache.
+static void OptimizeVertexCache(uint32_t* indices, size_t triangle_count, size_t vertex_count)
+{
+    if (triangle_count == 0)
+        return;
+
+    // Triangles of each vertex, the first remaining[v] entries of a list are not emitted yet
+    std::vector<uint32_t> remaining(vertex_count, 0);
+    for (size_t i = 0; i < triangle_count * 3; i++)
+        remaining[indices[i]]++;
+
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; v++)
+        offsets[v + 1] = offsets[v] + remaining[v];
+
+    std::vector<uint32_t> adjacency(triangle_count * 3);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < triangle_count * 3; i++)
+        adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+    std::vector<int> cache_positions(vertex_count, -1);
+    std::vector<float> vertex_scores(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++)
+        vertex_scores[v] = GetVertexScore(-1, remaining[v]);
+
+    std::vector<float> triangle_scores(triangle_count);
+    for (size_t t = 0; t < triangle_count; t++)
+        triangle_scores[t] =
+            vertex_scores[indices[t * 3 + 0]] +
+            vertex_scores[indices[t * 3 + 1]] +
+            vertex_scores[indices[t * 3 + 2]];
+
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<uint32_t> output;
+    output.reserve(triangle_count * 3);
+
+    uint32_t cache[VERTEX_CACHE_SIZE + 3];
+    size_t cache_count = 0;
+    int best_triangle = -1;
+    while (output.size() < triangle_count * 3)
+    {
+        // Nothing in the cache touches a remaining triangle, start over from the best one left
+        if (best_triangle < 0)
+        {
+            float best_score = -FLT_MAX;
+            for (size_t t = 0; t < triangle_count; t++)
+            {
+                if (emitted[t] || triangle_scores[t] <= best_score)
+                    continue;
+
+                best_score = triangle_scores[t];
+                best_triangle = static_cast<int>(t);
+            }
+        }
+
+        uint32_t* triangle = indices + best_triangle * 3;
+        emitted[best_triangle] = true;
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t v = triangle[k];
+            output.push_back(v);
+
+            uint32_t* list = adjacency.data() + offsets[v];
+            for (uint32_t a = 0; a < remaining[v]; a++)
+            {
+                if (list[a] != static_cast<uint32_t>(best_triangle))
+                    continue;
+
+                std::swap(list[a], list[remaining[v] - 1]);
+                break;
+            }
+
+            remaining[v]--;
+        }
+
+        // Move the triangle to the front of the cache, the cache briefly grows past its size so
+        // the vertices pushed out still get their scores lowered
+        uint32_t new_cache[VERTEX_CACHE_SIZE + 3];
+        size_t new_cache_count = 0;
+        for (int k = 0; k < 3; k++)
+            new_cache[new_cache_count++] = triangle[k];
+        for (size_t c = 0; c < cache_count; c++)
+            if (cache[c] != triangle[0] && cache[c] != triangle[1] && cache[c] != triangle[2])
+                new_cache[new_cache_count++] = cache[c];
+
+        for (size_t c = 0; c < new_cache_count; c++)
+        {
+            uint32_t v = new_cache[c];
+            cache_positions[v] = c < VERTEX_CACHE_SIZE ? static_cast<int>(c) : -1;
+            vertex_scores[v] = GetVertexScore(cache_positions[v], remaining[v]);
+        }
+
+        best_triangle = -1;
+        float best_score = -FLT_MAX;
+        for (size_t c = 0; c < new_cache_count; c++)
+        {
+            uint32_t v = new_cache[c];
+            const uint32_t* list = adjacency.data() + offsets[v];
+            for (uint32_t a = 0; a < remaining[v]; a++)
+            {
+                uint32_t t = list[a];
+                triangle_scores[t] =
+                    vertex_scores[indices[t * 3 + 0]] +
+                    vertex_scores[indices[t * 3 + 1]] +
+                    vertex_scores[indices[t * 3 + 2]];
+
+                if (triangle_scores[t] <= best_score)
+                    continue;
+
+                best_score = triangle_scores[t];
+                best_triangle = static_cast<int>(t);
+            }
+        }
+
+        cache_count = std::min(new_cache_count, static_cast<size_t>(VERTEX_CACHE_SIZE));
+        memcpy(cache, new_cache, sizeof(uint32_t) * cache_count);
+    }
+
+    memcpy(indices, output.data(), sizeof(uint32_t) * output.size());
+}
+
+template <typename T>
+static void RemapVertices(std::vector<T>& values, const std::vector<uint32_t>& remap, size_t vertex_count)
+{
+    if (values.empty())
+        return;
+
+    std::vector<T> remapped(vertex_count);
+    for (size_t i = 0; i < values.size(); i++)
+        if (remap[i] != UINT32_MAX)
+            remapped[remap[i]] = values[i];
+
+    values.swap(remapped);
+}
+
+// Renumber the vertices in the order the triangles first use them so vertex fetches walk
+// forward through memory.  Vertices no triangle uses are dropped.
+static void OptimizeVertexFetch(GLTFMesh* mesh)
+{
+    std::vector<uint32_t> remap(mesh->positions.size(), UINT32_MAX);
+    uint32_t vertex_count = 0;
+    for (uint32_t& index : mesh->indices)
+    {
+        if (remap[index] == UINT32_MAX)
+            remap[index] = vertex_count++;
+
+        index = remap[index];
+    }
+
+    RemapVertices(mesh->positions, remap, vertex_count);
+    RemapVertices(mesh->normals, remap, vertex_count);
+    RemapVertices(mesh->uvs, remap, vertex_count);
+    RemapVertices(mesh->bone_indices, remap, vertex_count);
+}
+
+// Reorder the triangles of each cluster for the vertex cache and the vertices for fetch
+// locality.  Triangles never move between clusters so the cluster bounds stay valid.  Clusters
+// are optimized on indices compacted to the vertices they use, so the cost of each one only
+// depends on its own size and not on the vertex count of the whole mesh.
+static void OptimizeMesh(GLTFMesh* mesh, const std::vector<MeshCluster>& clusters)
+{
+    size_t triangle_count = mesh->indices.size() / 3;
+    if (clusters.empty())
+    {
+        OptimizeVertexCache(mesh->indices.data(), triangle_count, mesh->positions.size());
+    }
+    else
+    {
+        std::vector<uint32_t> local_index(mesh->positions.size(), UINT32_MAX);
+        std::vector<uint32_t> global_index;
+        for (const MeshCluster& cluster : clusters)
+        {
+            uint32_t* indices = mesh->indices.data() + cluster.index_offset;
+            global_index.clear();
+            for (uint32_t i = 0; i < cluster.index_count; i++)
+            {
+                uint32_t& local = local_index[indices[i]];
+                if (local == UINT32_MAX)
+                {
+                    local = static_cast<uint32_t>(global_index.size());
+                    global_index.push_back(indices[i]);
+                }
+
+                indices[i] = local;
+            }
+
+            OptimizeVertexCache(indices, cluster.index_count / 3, global_index.size());
+
+            for (uint32_t i = 0; i < cluster.index_count; i++)
+                indices[i] = global_index[indices[i]];
+
+            for (uint32_t vertex : global_index)
+                local_index[vertex] = UINT32_MAX;
+        }
+    }
+
+    OptimizeVertexFetch(mesh);
+}
+
+// @lod
+
+// Symmetric 4x4 matrix of the summed squared distances to a set of planes
+struct Quadric
+{
+    double m[10];
+};
+
+struct PositionHash
+{
+    size_t operator()(const vec3& position) const
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&position);
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(vec3); i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        return static_cast<size_t>(hash);
+    }
+};
+
+struct EdgeCollapse
+{
+    double cost;
+    uint32_t from;
+    uint32_t to;
+    uint32_t from_version;
+    uint32_t to_version;
+
+    bool operator>(const EdgeCollapse& other) const
+    {
+        return cost > other.cost;
+    }
+};
+
+static void AddPlane(Quadric& q, const vec3& normal, float distance, double weight)
+{
+    double a = normal.x;
+    double b = normal.y;
+    double c = normal.z;
+    double d = distance;
+    double values[10] = { a*a, a*b, a*c, a*d, b*b, b*c, b*d, c*c, c*d, d*d };
+    for (int i = 0; i < 10; i++)
+        q.m[i] += values[i] * weight;
+}
+
+static double GetQuadricError(const Quadric& q, const vec3& position)
+{
+    double x = position.x;
+    double y = position.y;
+    double z = position.z;
+    return
+        q.m[0]*x*x + 2*q.m[1]*x*y + 2*q.m[2]*x*z + 2*q.m[3]*x +
+        q.m[4]*y*y + 2*q.m[5]*y*z + 2*q.m[6]*y +
+        q.m[7]*z*z + 2*q.m[8]*z +
+        q.m[9];
+}
+
+// Vertex at the target position whose attributes best match the vertex being collapsed, so a
+// triangle keeps its normal, palette uv and bone when its corner moves
+static uint32_t GetNearestWedge(const GLTFMesh* mesh, uint32_t vertex, const std::vector<uint32_t>& wedges)
+{
+    uint32_t best = wedges[0];
+    float best_distance = FLT_MAX;
+    for (uint32_t wedge : wedges)
+    {
+        float distance = 0.0f;
+        if (!mesh->bone_indices.empty() && mesh->bone_indices[wedge] != mesh->bone_indices[vertex])
+            distance += 1000.0f;
+        if (!mesh->normals.empty())
+            distance += 1.0f - dot(mesh->normals[wedge], mesh->normals[vertex]);
+        if (!mesh->uvs.empty())
+            distance += dot(mesh->uvs[wedge] - mesh->uvs[vertex], mesh->uvs[wedge] - mesh->uvs[vertex]);
+
+        if (distance >= best_distance)
+            continue;
+
+        best_distance = distance;
+        best = wedge;
+    }
+
+    return best;
+}
+
+// Simplify a triangle list down to target_triangles with quadric error metric edge collapses.
+// Collapses work on positions so attribute seams do not stop them, each moved corner picks the
+// closest matching vertex at the target position.  Positions on an open border are locked to
+// keep the silhouette and the output only references existing vertices.
+static std::vector<uint32_t> SimplifyMesh(const GLTFMesh* mesh, const std::vector<uint32_t>& input, size_t target_triangles)
+{
+    std::vector<uint32_t> indices(input);
+    size_t triangle_count = indices.size() / 3;
+
+    // Group the vertices by position
+    std::unordered_map<vec3, uint32_t, PositionHash> position_ids;
+    std::vector<uint32_t> group(mesh->positions.size(), UINT32_MAX);
+    std::vector<std::vector<uint32_t>> group_wedges;
+    std::vector<vec3> group_positions;
+    for (uint32_t index : indices)
+    {
+        if (group[index] != UINT32_MAX)
+            continue;
+
+        auto result = position_ids.emplace(mesh->positions[index], static_cast<uint32_t>(group_positions.size()));
+        if (result.second)
+        {
+            group_positions.push_back(mesh->positions[index]);
+            group_wedges.emplace_back();
+        }
+
+        group[index] = result.first->second;
+        group_wedges[group[index]].push_back(index);
+    }
+
+    size_t group_count = group_positions.size();
+    std::vector<Quadric> quadrics(group_count, Quadric{});
+    std::vector<std::vector<uint32_t>> group_triangles(group_count);
+    std::unordered_map<uint64_t, uint32_t> edge_counts;
+    for (size_t t = 0; t < triangle_count; t++)
+    {
+        uint32_t g[3] = { group[indices[t * 3 + 0]], group[indices[t * 3 + 1]], group[indices[t * 3 + 2]] };
+        vec3 n = cross(group_positions[g[1]] - group_positions[g[0]], group_positions[g[2]] - group_positions[g[0]]);
+        float area = length(n);
+        if (area > 0.0f)
+        {
+            n /= area;
+            for (int k = 0; k < 3; k++)
+                AddPlane(quadrics[g[k]], n, -dot(n, group_positions[g[0]]), area);
+        }
+
+        for (int k = 0; k < 3; k++)
+        {
+            group_triangles[g[k]].push_back(static_cast<uint32_t>(t));
+            uint32_t a = std::min(g[k], g[(k + 1) % 3]);
+            uint32_t b = std::max(g[k], g[(k + 1) % 3]);
+            edge_counts[(static_cast<uint64_t>(a) << 32) | b]++;
+        }
+    }
+
+    std::vector<bool> locked(group_count, false);
+    for (const auto& edge : edge_counts)
+    {
+        if (edge.second == 2)
+            continue;
+
+        locked[static_cast<uint32_t>(edge.first >> 32)] = true;
+        locked[static_cast<uint32_t>(edge.first)] = true;
+    }
+
+    std::vector<uint32_t> versions(group_count, 0);
+    std::vector<bool> collapsed(group_count, false);
+    std::vector<bool> removed(triangle_count, false);
+    std::priority_queue<EdgeCollapse, std::vector<EdgeCollapse>, std::greater<EdgeCollapse>> queue;
+
+    auto push_edge = [&](uint32_t a, uint32_t b)
+    {
+        Quadric q;
+        for (int i = 0; i < 10; i++)
+            q.m[i] = quadrics[a].m[i] + quadrics[b].m[i];
+
+        if (!locked[a])
+            queue.push({ GetQuadricError(q, group_positions[b]), a, b, versions[a], versions[b] });
+        if (!locked[b])
+            queue.push({ GetQuadricError(q, group_positions[a]), b, a, versions[b], versions[a] });
+    };
+
+    for (const auto& edge : edge_counts)
+        push_edge(static_cast<uint32_t>(edge.first >> 32), static_cast<uint32_t>(edge.first));
+
+    auto get_group = [&](uint32_t t, int k) { return group[indices[t * 3 + k]]; };
+
+    size_t remaining = triangle_count;
+    while (remaining > target_triangles && !queue.empty())
+    {
+        EdgeCollapse collapse = queue.top();
+        queue.pop();
+
+        uint32_t from = collapse.from;
+        uint32_t to = collapse.to;
+        if (collapsed[from] || collapsed[to] || versions[from] != collapse.from_version || versions[to] != collapse.to_version)
+            continue;
+
+        // Reject collapses that turn a surviving triangle by more than ~70 degrees.  Only
+        // rejecting actual flips lets normals drift over successive collapses until they flip.
+        bool flips = false;
+        for (uint32_t t : group_triangles[from])
+        {
+            if (removed[t])
+                continue;
+
+            vec3 p[3];
+            vec3 moved[3];
+            bool has_to = false;
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t g = get_group(t, k);
+                has_to |= g == to;
+                p[k] = group_positions[g];
+                moved[k] = g == from ? group_positions[to] : p[k];
+            }
+
+            if (has_to)
+                continue;
+
+            vec3 before = cross(p[1] - p[0], p[2] - p[0]);
+            vec3 after = cross(moved[1] - moved[0], moved[2] - moved[0]);
+            float before_length = length(before);
+            float after_length = length(after);
+            if (before_length > 0.0f && dot(before, after) <= 0.35f * before_length * after_length)
+            {
+                flips = true;
+                break;
+            }
+        }
+
+        if (flips)
+            continue;
+
+        for (uint32_t t : group_triangles[from])
+        {
+            if (removed[t])
+                continue;
+
+            if (get_group(t, 0) == to || get_group(t, 1) == to || get_group(t, 2) == to)
+            {
+                removed[t] = true;
+                remaining--;
+                continue;
+            }
+
+            for (int k = 0; k < 3; k++)
+                if (get_group(t, k) == from)
+                    indices[t * 3 + k] = GetNearestWedge(mesh, indices[t * 3 + k], group_wedges[to]);
+
+            group_triangles[to].push_back(t);
+        }
+
+        for (int i = 0; i < 10; i++)
+            quadrics[to].m[i] += quadrics[from].m[i];
+
+        collapsed[from] = true;
+        group_triangles[from].clear();
+        versions[to]++;
+
+        // Every edge of the target changed cost
+        std::vector<uint32_t> neighbours;
+        for (uint32_t t : group_triangles[to])
+        {
+            if (removed[t])
+                continue;
+
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t g = get_group(t, k);
+                if (g != to && std::find(neighbours.begin(), neighbours.end(), g) == neighbours.end())
+                    neighbours.push_back(g);
+            }
+        }
+
+        for (uint32_t neighbour : neighbours)
+            push_edge(to, neighbour);
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(remaining * 3);
+    for (size_t t = 0; t < triangle_count; t++)
+        if (!removed[t])
+            output.insert(output.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+
+    return output;
+}
+
+static std::vector<float> ParseLodRatios(const std::string& value)
+{
+    std::vector<float> ratios;
+    size_t start = 0;
+    while (start < value.size())
+    {
+        size_t end = value.find(',', start);
+        if (end == std::string::npos)
+            end = value.size();
+
+        float ratio = std::stof(value.substr(start, end - start));
+        if (ratio <= 0.0f || ratio >= 1.0f || (!ratios.empty() && ratio >= ratios.back()))
+            throw std::runtime_error("lod_ratios must be decreasing values between 0 and 1");
+
+        ratios.push_back(ratio);
+        start = end + 1;
+    }
+
+    return ratios;
+}
+
+// Append a simplified index range per ratio after the full detail indices.  Each level is
+// simplified from the previous one and is drawn once the mesh covers less than
+// screen_size * sqrt(ratio) of the screen height, which keeps the triangle density on screen
+// roughly constant.
+static std::vector<MeshLod> BuildLods(GLTFMesh* mesh, const std::vector<float>& ratios, float screen_size, const fs::path& path)
+{
+    std::vector<MeshLod> lods;
+    lods.push_back({ 0, static_cast<uint32_t>(mesh->indices.size()), screen_size });
+
+    size_t triangle_count = mesh->indices.size() / 3;
+    std::vector<uint32_t> previous(mesh->indices);
+    for (float ratio : ratios)
+    {
+        std::vector<uint32_t> simplified = SimplifyMesh(mesh, previous, static_cast<size_t>(triangle_count * ratio));
+        if (simplified.empty() || simplified.size() >= previous.size())
+            break;
+
+        OptimizeVertexCache(simplified.data(), simplified.size() / 3, mesh->positions.size());
+
+        MeshLod lod = {};
+        lod.index_offset = static_cast<uint32_t>(mesh->indices.size());
+        lod.index_count = static_cast<uint32_t>(simplified.size());
+        lod.screen_size = screen_size * sqrtf(ratio);
+        lods.push_back(lod);
+
+        mesh->indices.insert(mesh->indices.end(), simplified.begin(), simplified.end());
+        previous.swap(simplified);
+
+        printf("%s: lod %zu, %zu -> %zu triangles\n",
+            path.filename().string().c_str(),
+            lods.size() - 1,
+            triangle_count,
+            static_cast<size_t>(lod.index_count / 3));
+    }
+
+    return lods;
+}
+
+static VertexFormat ParseVertexFormat(const std::string& value)
+{
+    if (value == "half")
+        return VERTEX_FORMAT_HALF;
+
+    if (value == "unorm16")
+        return VERTEX_FORMAT_UNORM16;
+
+    if (value != "float")
+        throw std::runtime_error("Unknown vertex_format '" + value + "', expected float, half or unorm16");
+
+    return VERTEX_FORMAT_FLOAT;
+}
+
 static void WriteMeshData(
     Stream* stream,
     const GLTFMesh* mesh,
+    const std::vector<MeshCluster>& clusters,
+    const std::vector<MeshLod>& lods,
     Props* meta)
 {
+    VertexFormat vertex_format = ParseVertexFormat(meta->GetString("mesh", "vertex_format", "float"));
+
+    // 32 bit indices are only used when a vertex can not be addressed with 16
+    uint8_t index_size = mesh->positions.size() > 65536 ? sizeof(uint32_t) : sizeof(uint16_t);
+
     // Write asset header
     AssetHeader header = {};
     header.signature = ASSET_SIGNATURE_MESH;
-    header.version = 1;
-    header.flags = 0;
+    header.version = 4;
+    // Occluders, static batching and anything else reading the vertices on the CPU need the copy,
+    // meshes that are only ever drawn opt out with keep_cpu_copy=false
+    header.flags = meta->GetBool("mesh", "keep_cpu_copy", true) ? 0 : MESH_ASSET_FLAG_DISCARD_CPU_COPY;
     WriteAssetHeader(stream, &header);
 
     // header
@@ -82,11 +848,16 @@ static void WriteMeshData(
     WriteBytes(stream, &bounds, sizeof(bounds3));
     WriteU32(stream, static_cast<uint32_t>(mesh->positions.size()));
     WriteU32(stream, static_cast<uint32_t>(mesh->indices.size()));
+    WriteU8(stream, static_cast<uint8_t>(vertex_format));
+    WriteU8(stream, index_size);
+    WriteU32(stream, static_cast<uint32_t>(clusters.size()));
+    WriteU32(stream, static_cast<uint32_t>(lods.size()));
 
     // verts
+    std::vector<mesh_vertex> vertices(mesh->positions.size());
     for (size_t i = 0; i < mesh->positions.size(); ++i)
     {
-        mesh_vertex vertex = {};
+        mesh_vertex& vertex = vertices[i];
         vertex.position = mesh->positions[i];
         vertex.uv0 = vec2(0, 0);
         vertex.bone = 0;
@@ -100,12 +871,29 @@ static void WriteMeshData(
             
         if (mesh->bone_indices.size() == mesh->positions.size() && i < mesh->bone_indices.size())
             vertex.bone = static_cast<float>(mesh->bone_indices[i]);
-            
-        WriteBytes(stream, &vertex, sizeof(mesh_vertex));
     }
+
+    std::vector<uint8_t> encoded(GetVertexStride(vertex_format) * vertices.size());
+    EncodeVertices(vertex_format, bounds, vertices.data(), vertices.size(), encoded.data());
+    WriteBytes(stream, encoded.data(), encoded.size());
     
     // indices
-    WriteBytes(stream, const_cast<uint16_t*>(mesh->indices.data()), mesh->indices.size() * sizeof(uint16_t));
+    if (index_size == sizeof(uint32_t))
+    {
+        WriteBytes(stream, const_cast<uint32_t*>(mesh->indices.data()), mesh->indices.size() * sizeof(uint32_t));
+    }
+    else
+    {
+        std::vector<uint16_t> indices(mesh->indices.begin(), mesh->indices.end());
+        WriteBytes(stream, indices.data(), indices.size() * sizeof(uint16_t));
+    }
+
+    // clusters
+    if (!clusters.empty())
+        WriteBytes(stream, const_cast<MeshCluster*>(clusters.data()), clusters.size() * sizeof(MeshCluster));
+
+    // levels of detail
+    WriteBytes(stream, const_cast<MeshLod*>(lods.data()), lods.size() * sizeof(MeshLod));
 }
 
 void ImportMesh(const fs::path& source_path, Stream* output_stream, Props* config, Props* meta)
@@ -136,12 +924,52 @@ void ImportMesh(const fs::path& source_path, Stream* output_stream, Props* confi
         throw std::runtime_error("No mesh data found");
     }
     
-    // Apply flatten if requested
+    // Apply flatten if requested, flattened meshes depend on their triangle order so they are
+    // never split into clusters, optimized or simplified
+    std::vector<MeshCluster> clusters;
+    std::vector<MeshLod> lods;
     if (meta->GetBool("mesh", "flatten", false))
+    {
         FlattenMesh(&mesh);
+    }
+    else
+    {
+        bool optimize = meta->GetBool("mesh", "optimize", true);
+        VertexCacheStats before = GetVertexCacheStats(&mesh);
+        size_t vertex_count = mesh.positions.size();
+        if (optimize)
+            WeldVertices(&mesh);
+
+        clusters = BuildClusters(
+            &mesh,
+            to_bounds(mesh.positions.data(), mesh.positions.size()),
+            static_cast<size_t>(std::max(0, meta->GetInt("mesh", "cluster_triangles", 0))));
+
+        if (optimize)
+        {
+            OptimizeMesh(&mesh, clusters);
+
+            VertexCacheStats after = GetVertexCacheStats(&mesh);
+            printf("%s: vertices %zu -> %zu, acmr %.3f -> %.3f, atvr %.3f -> %.3f\n",
+                src_path.filename().string().c_str(),
+                vertex_count,
+                mesh.positions.size(),
+                before.acmr,
+                after.acmr,
+                before.atvr,
+                after.atvr);
+        }
+
+        // Levels of detail share the vertices and follow the full detail indices
+        lods = BuildLods(
+            &mesh,
+            ParseLodRatios(meta->GetString("mesh", "lod_ratios", "")),
+            meta->GetFloat("mesh", "lod_screen_size", 0.5f),
+            src_path);
+    }
 
     // Write mesh data to stream
-    WriteMeshData(output_stream, &mesh, meta);
+    WriteMeshData(output_stream, &mesh, clusters, lods, meta);
 }
 
 bool DoesMeshDependOn(const fs::path& source_path, const fs::path& dependency_path)
@@ -2,6 +2,7 @@
 //  NoZ Game Engine - Copyright(c) 2025 NoZ Games, LLC
 //
 
+#include <bc_encoder.h>
 #include <noz/asset.h>
 #include <noz/noz.h>
 #include <filesystem>
@@ -18,77 +19,169 @@
 
 namespace fs = std::filesystem;
 
-static float SRGBToLinear(float srgb)
+struct FilterTap
 {
-    if (srgb <= 0.04045f)
-        return srgb / 12.92f;
+    int index;
+    float weight;
+};
+
+static float BesselI0(float x)
+{
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 32 && term > sum * 1e-8f; k++)
+    {
+        float t = x / (2.0f * k);
+        term *= t * t;
+        sum += term;
+    }
+    return sum;
+}
+
+static float Sinc(float x)
+{
+    if (std::abs(x) < 1e-6f)
+        return 1.0f;
+
+    x *= 3.14159265f;
+    return std::sin(x) / x;
+}
 
-    return std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+// How filter taps past the edge of a level are resolved, matching how the sampler addresses them
+enum FilterEdge
+{
+    filter_edge_clamp,
+    filter_edge_repeat,
+    filter_edge_mirror
+};
+
+static FilterEdge GetFilterEdge(const std::string& clamp)
+{
+    if (clamp == "repeat")
+        return filter_edge_repeat;
+    if (clamp == "mirrored_repeat")
+        return filter_edge_mirror;
+    return filter_edge_clamp;
 }
 
-static void ConvertSRGBToLinear(uint8_t* pixels, int width, int height, int channels)
+static int GetEdgeIndex(int s, int size, FilterEdge edge)
 {
-    int total_pixels = width * height;
-    for (int i = 0; i < total_pixels; ++i)
+    if (edge == filter_edge_repeat)
+        return ((s % size) + size) % size;
+
+    if (edge == filter_edge_mirror)
     {
-        // Convert RGB channels (skip alpha)
-        for (int c = 0; c < std::min(3, channels); ++c)
+        int period = size * 2;
+        int m = ((s % period) + period) % period;
+        return m < size ? m : period - 1 - m;
+    }
+
+    return std::clamp(s, 0, size - 1);
+}
+
+// Taps for every destination texel along one axis.  The box filter weights each source texel by
+// how much of the destination footprint it covers, which stays exact for odd sizes.  The Kaiser
+// filter is a windowed sinc three destination texels wide that keeps mips sharper.
+static std::vector<std::vector<FilterTap>> GetFilterTaps(int src_size, int dst_size, bool kaiser, FilterEdge edge)
+{
+    std::vector<std::vector<FilterTap>> taps(dst_size);
+    float scale = (float)src_size / dst_size;
+    for (int d = 0; d < dst_size; d++)
+    {
+        std::vector<FilterTap>& dst_taps = taps[d];
+        float weight_sum = 0.0f;
+        if (!kaiser)
         {
-            uint8_t srgb_value = pixels[i * channels + c];
-            float srgb_float = (float)srgb_value / 255.0f;
-            float linear_float = SRGBToLinear(srgb_float);
-            pixels[i * channels + c] = static_cast<uint8_t>(std::round(linear_float * 255.0f));
+            float start = d * scale;
+            float end = start + scale;
+            for (int s = (int)start; s < src_size && s < end; s++)
+            {
+                float weight = std::min(end, s + 1.0f) - std::max(start, (float)s);
+                if (weight > 0.0f)
+                {
+                    dst_taps.push_back({s, weight});
+                    weight_sum += weight;
+                }
+            }
+        }
+        else
+        {
+            constexpr float radius = 3.0f;
+            constexpr float alpha = 4.0f;
+            float center = (d + 0.5f) * scale - 0.5f;
+            float support = radius * scale;
+            for (int s = (int)std::ceil(center - support); s <= (int)std::floor(center + support); s++)
+            {
+                float x = (s - center) / support;
+                float weight = Sinc((s - center) / scale) * BesselI0(alpha * std::sqrt(std::max(0.0f, 1.0f - x * x))) / BesselI0(alpha);
+                dst_taps.push_back({GetEdgeIndex(s, src_size, edge), weight});
+                weight_sum += weight;
+            }
         }
+
+        for (FilterTap& tap : dst_taps)
+            tap.weight /= weight_sum;
     }
+
+    return taps;
 }
 
+// Separable downsample of a linear RGBA float image
 static void GenerateMipmap(
-    const uint8_t* src, int src_width, int src_height, 
-    uint8_t* dst, int dst_width, int dst_height, 
-    int channels)
+    const std::vector<float>& src, int src_width, int src_height,
+    std::vector<float>& dst, int dst_width, int dst_height,
+    bool kaiser, FilterEdge edge_u, FilterEdge edge_v)
 {
-    float x_ratio = (float)src_width / dst_width;
-    float y_ratio = (float)src_height / dst_height;
-    
+    auto taps_x = GetFilterTaps(src_width, dst_width, kaiser, edge_u);
+    auto taps_y = GetFilterTaps(src_height, dst_height, kaiser, edge_v);
+
+    std::vector<float> rows((size_t)dst_width * src_height * 4, 0.0f);
+    for (int y = 0; y < src_height; y++)
+        for (int x = 0; x < dst_width; x++)
+            for (const FilterTap& tap : taps_x[x])
+                for (int c = 0; c < 4; c++)
+                    rows[((size_t)y * dst_width + x) * 4 + c] += src[((size_t)y * src_width + tap.index) * 4 + c] * tap.weight;
+
+    dst.assign((size_t)dst_width * dst_height * 4, 0.0f);
     for (int y = 0; y < dst_height; y++)
+        for (const FilterTap& tap : taps_y[y])
+            for (int x = 0; x < dst_width; x++)
+                for (int c = 0; c < 4; c++)
+                    dst[((size_t)y * dst_width + x) * 4 + c] += rows[((size_t)tap.index * dst_width + x) * 4 + c] * tap.weight;
+}
+
+// Mips are filtered in linear space at full precision, sRGB sources are decoded first so that
+// averaging does not darken them and premultiplying happens before filtering to avoid halos
+static std::vector<float> DecodeLevel(const std::vector<uint8_t>& rgba, bool srgb, bool premultiply)
+{
+    std::vector<float> pixels(rgba.size());
+    for (size_t i = 0; i < rgba.size(); i += 4)
     {
-        for (int x = 0; x < dst_width; x++)
+        float alpha = rgba[i + 3] / 255.0f;
+        for (int c = 0; c < 3; c++)
         {
-            // Simple box filter for downsampling
-            float src_x = x * x_ratio;
-            float src_y = y * y_ratio;
-            
-            int src_x0 = (int)src_x;
-            int src_y0 = (int)src_y;
-            int src_x1 = std::min(src_x0 + 1, src_width - 1);
-            int src_y1 = std::min(src_y0 + 1, src_height - 1);
-            
-            float fx = src_x - src_x0;
-            float fy = src_y - src_y0;
-            
-            for (int c = 0; c < channels; c++)
-            {
-                float v00 = src[(src_y0 * src_width + src_x0) * channels + c];
-                float v10 = src[(src_y0 * src_width + src_x1) * channels + c];
-                float v01 = src[(src_y1 * src_width + src_x0) * channels + c];
-                float v11 = src[(src_y1 * src_width + src_x1) * channels + c];
-                
-                float v0 = v00 * (1 - fx) + v10 * fx;
-                float v1 = v01 * (1 - fx) + v11 * fx;
-                float v = v0 * (1 - fy) + v1 * fy;
-                
-                dst[(y * dst_width + x) * channels + c] = (uint8_t)v;
-            }
+            float value = srgb ? SRGBToLinear(rgba[i + c]) : rgba[i + c] / 255.0f;
+            pixels[i + c] = premultiply ? value * alpha : value;
         }
+        pixels[i + 3] = alpha;
     }
+    return pixels;
+}
+
+static std::vector<uint8_t> EncodeLevel(const std::vector<float>& pixels)
+{
+    std::vector<uint8_t> rgba(pixels.size());
+    for (size_t i = 0; i < pixels.size(); i++)
+        rgba[i] = (uint8_t)(std::clamp(pixels[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+    return rgba;
 }
 
 static void WriteTextureData(
     Stream* stream,
-    const uint8_t* data,
+    const std::vector<uint8_t>& data,
     int width,
     int height,
-    int channels,
+    TextureFormat format,
     const std::string& min_filter,
     const std::string& mag_filter,
     const std::string& clamp_u,
@@ -99,7 +192,7 @@ static void WriteTextureData(
     // Write asset header
     AssetHeader header = {};
     header.signature = ASSET_SIGNATURE_TEXTURE;
-    header.version = 1;
+    header.version = 2;
     header.flags = 0;
     WriteAssetHeader(stream, &header);
     
@@ -126,7 +219,6 @@ static void WriteTextureData(
     else if (clamp_w == "clamp_to_border") clamp_w_value = 3;
     
     // Write texture metadata
-    uint32_t format = (channels == 4) ? 1 : 0; // 0=RGB, 1=RGBA
     WriteU32(stream, format);
     WriteU32(stream, width);
     WriteU32(stream, height);
@@ -140,16 +232,15 @@ static void WriteTextureData(
     WriteBool(stream, has_mipmaps);
     
     // Write pixel data
-    size_t data_size = width * height * channels;
-    WriteU32(stream, data_size);
-    WriteBytes(stream, (void*)data, data_size);
+    WriteU32(stream, static_cast<uint32_t>(data.size()));
+    WriteBytes(stream, (void*)data.data(), data.size());
 }
 
 static void WriteTextureWithMipmaps(
     Stream* stream,
     const std::vector<std::vector<uint8_t>>& mip_levels,
     const std::vector<std::pair<int, int>>& mip_dimensions,
-    int channels,
+    TextureFormat format,
     const std::string& min_filter,
     const std::string& mag_filter,
     const std::string& clamp_u,
@@ -171,7 +262,7 @@ static void WriteTextureWithMipmaps(
     // Write asset header
     AssetHeader header = {};
     header.signature = ASSET_SIGNATURE_TEXTURE;
-    header.version = 1;
+    header.version = 2;
     header.flags = 0;
     WriteAssetHeader(stream, &header);
     
@@ -198,7 +289,6 @@ static void WriteTextureWithMipmaps(
     else if (clamp_w == "clamp_to_border") clamp_w_value = 3;
     
     // Write texture metadata
-    uint32_t format = (channels == 4) ? 1 : 0; // 0=RGB, 1=RGBA
     uint32_t width = mip_dimensions[0].first;
     uint32_t height = mip_dimensions[0].second;
     uint32_t num_mip_levels = static_cast<uint32_t>(mip_levels.size());
@@ -231,6 +321,27 @@ static void WriteTextureWithMipmaps(
     }
 }
 
+static TextureFormat ParseCompression(const std::string& compression)
+{
+    if (compression == "none") return TEXTURE_FORMAT_RGBA8;
+    if (compression == "bc1") return TEXTURE_FORMAT_BC1;
+    if (compression == "bc3") return TEXTURE_FORMAT_BC3;
+    if (compression == "bc4") return TEXTURE_FORMAT_BC4;
+    if (compression == "bc5") return TEXTURE_FORMAT_BC5;
+    if (compression == "bc7") return TEXTURE_FORMAT_BC7;
+    throw std::runtime_error("Unknown texture compression: " + compression);
+}
+
+static std::vector<uint8_t> CompressLevel(TextureFormat format, const std::vector<uint8_t>& rgba, int width, int height)
+{
+    if (!IsBlockCompressed(format))
+        return rgba;
+
+    std::vector<uint8_t> compressed(GetTextureLevelSize(format, width, height));
+    CompressTexture(format, rgba.data(), width, height, compressed.data());
+    return compressed;
+}
+
 void ImportTexture(const fs::path& source_path, Stream* output_stream, Props* config, Props* meta)
 {
     fs::path src_path = source_path;
@@ -251,11 +362,33 @@ void ImportTexture(const fs::path& source_path, Stream* output_stream, Props* co
     std::string clamp_v = meta->GetString("texture", "clamp_v", "clamp_to_edge");
     std::string clamp_w = meta->GetString("texture", "clamp_w", "clamp_to_edge");
     bool generate_mipmaps = meta->GetBool("texture", "mipmaps", false);
+    std::string mip_filter = meta->GetString("texture", "mip_filter", "box");
     bool convert_from_srgb = meta->GetBool("texture", "srgb", false);
+    bool premultiply_alpha = meta->GetBool("texture", "premultiply_alpha", false);
+    TextureFormat format = ParseCompression(meta->GetString("texture", "compression", "none"));
+
+    if (mip_filter != "box" && mip_filter != "kaiser")
+    {
+        stbi_image_free(image_data);
+        throw std::runtime_error("Unknown mip filter: " + mip_filter);
+    }
+
+    // Lower mips may be smaller than a block but the top level has to be made of whole blocks
+    if (IsBlockCompressed(format) && (width % 4 != 0 || height % 4 != 0))
+    {
+        stbi_image_free(image_data);
+        throw std::runtime_error("Compressed textures must be a multiple of 4 in size");
+    }
     
     // Convert to RGBA if needed
     std::vector<uint8_t> rgba_data;
-    if (channels != 4)
+    if (channels == 3)
+    {
+        rgba_data.resize(width * height * 4);
+        ConvertRGBToRGBA(image_data, rgba_data.data(), width * height);
+        channels = 4;
+    }
+    else if (channels != 4)
     {
         rgba_data.resize(width * height * 4);
         for (int i = 0; i < width * height; ++i)
@@ -275,18 +408,18 @@ void ImportTexture(const fs::path& source_path, Stream* output_stream, Props* co
     
     stbi_image_free(image_data);
     
-    // Convert from sRGB to linear if requested
-    if (convert_from_srgb)
-        ConvertSRGBToLinear(rgba_data.data(), width, height, channels);
-
     // Generate mipmaps if requested
     if (generate_mipmaps)
     {
         std::vector<std::vector<uint8_t>> mip_levels;
         std::vector<std::pair<int, int>> mip_dimensions;
-        
-        // Add base level
-        mip_levels.push_back(rgba_data);
+        bool kaiser = mip_filter == "kaiser";
+        FilterEdge edge_u = GetFilterEdge(clamp_u);
+        FilterEdge edge_v = GetFilterEdge(clamp_v);
+
+        // Add base level, every level is filtered from the float copy of the one above it
+        std::vector<float> level = DecodeLevel(rgba_data, convert_from_srgb, premultiply_alpha);
+        mip_levels.push_back(EncodeLevel(level));
         mip_dimensions.push_back({width, height});
         
         // Generate additional mip levels
@@ -298,27 +431,29 @@ void ImportTexture(const fs::path& source_path, Stream* output_stream, Props* co
             int next_width = std::max(1, current_width / 2);
             int next_height = std::max(1, current_height / 2);
             
-            std::vector<uint8_t> mip_data(next_width * next_height * channels);
-            
-            // Generate mipmap from previous level
+            std::vector<float> next_level;
             GenerateMipmap(
-                mip_levels.back().data(), current_width, current_height,
-                mip_data.data(), next_width, next_height,
-                channels
+                level, current_width, current_height,
+                next_level, next_width, next_height,
+                kaiser, edge_u, edge_v
             );
             
-            mip_levels.push_back(std::move(mip_data));
+            mip_levels.push_back(EncodeLevel(next_level));
             mip_dimensions.push_back({next_width, next_height});
+            level = std::move(next_level);
             
             current_width = next_width;
             current_height = next_height;
         }
+
+        for (size_t i = 0; i < mip_levels.size(); ++i)
+            mip_levels[i] = CompressLevel(format, mip_levels[i], mip_dimensions[i].first, mip_dimensions[i].second);
         
         WriteTextureWithMipmaps(
             output_stream,
             mip_levels,
             mip_dimensions,
-            channels,
+            format,
             min_filter,
             mag_filter,
             clamp_u,
@@ -328,12 +463,19 @@ void ImportTexture(const fs::path& source_path, Stream* output_stream, Props* co
     }
     else
     {
+        // Convert from sRGB to linear if requested
+        if (convert_from_srgb)
+            ConvertSRGBToLinear(rgba_data.data(), width * height, channels);
+
+        if (premultiply_alpha)
+            PremultiplyAlpha(rgba_data.data(), width * height);
+
         WriteTextureData(
             output_stream,
-            rgba_data.data(),
+            CompressLevel(format, rgba_data, width, height),
             width,
             height,
-            channels,
+            format,
             min_filter,
             mag_filter,
             clamp_u,
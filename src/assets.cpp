@@ -42,11 +42,11 @@ bool LoadAssets(size_t arena_size)
     NOZ_LOAD_SHADER("shaders/lit", Assets.shaders.lit);
     NOZ_LOAD_SHADER("shaders/shadow", Assets.shaders.shadow);
     NOZ_LOAD_SHADER("shaders/text", Assets.shaders.text);
+    NOZ_LOAD_SHADER("shaders/text_msdf", Assets.shaders.text_msdf);
     NOZ_LOAD_SHADER("shaders/ui", Assets.shaders.ui);
     NOZ_LOAD_SHADER("shaders/vignette", Assets.shaders.vignette);
     NOZ_LOAD_TEXTURE("textures/grid", Assets.textures.grid);
-    NOZ_LOAD_TEXTURE("textures/icons/meshes/buildings/extractor", Assets.textures.icons.meshes.buildings.extractor);
-    NOZ_LOAD_TEXTURE("textures/icons/meshes/buildings/Stone", Assets.textures.icons.meshes.buildings.stone);
+    NOZ_LOAD_ATLAS("textures/icons", Assets.textures.icons);
     NOZ_LOAD_TEXTURE("textures/palette", Assets.textures.palette);
     NOZ_LOAD_STYLE_SHEET("ui/common", Assets.ui.common);
     NOZ_LOAD_STYLE_SHEET("ui/hud", Assets.ui.hud);
@@ -56,6 +56,22 @@ bool LoadAssets(size_t arena_size)
     SetShadowPassShader(Assets.shaders.shadow);
     SetGammaPassShader(Assets.shaders.gamma);
 
+    // Create the pipelines of every shader before the first frame
+    Shader* pipeline_shaders[] =
+    {
+        Assets.shaders.border_effect,
+        Assets.shaders._default,
+        Assets.shaders.gamma,
+        Assets.shaders.gizmo,
+        Assets.shaders.lit,
+        Assets.shaders.shadow,
+        Assets.shaders.text,
+        Assets.shaders.text_msdf,
+        Assets.shaders.ui,
+        Assets.shaders.vignette,
+    };
+    PrewarmPipelines(pipeline_shaders, sizeof(pipeline_shaders) / sizeof(Shader*));
+
     return true;
 }
 
@@ -3,6 +3,9 @@
 // Generated by NoZ Game Engine Asset Importer
 //
 
+// @atlas
+// LoadedAssets.textures.icons
+//
 // @fonts
 // LoadedAssets.fonts.roboto_black
 //
@@ -24,6 +27,7 @@
 // LoadedAssets.shaders.lit
 // LoadedAssets.shaders.shadow
 // LoadedAssets.shaders.text
+// LoadedAssets.shaders.text_msdf
 // LoadedAssets.shaders.ui
 // LoadedAssets.shaders.vignette
 //
@@ -34,8 +38,6 @@
 //
 // @textures
 // LoadedAssets.textures.grid
-// LoadedAssets.textures.icons.meshes.buildings.extractor
-// LoadedAssets.textures.icons.meshes.buildings.stone
 // LoadedAssets.textures.palette
 //
 
@@ -48,6 +50,7 @@ struct Mesh;
 struct Font;
 struct Material;
 struct Sound;
+struct Atlas;
 
 struct LoadedAssets
 {
@@ -87,23 +90,14 @@ struct LoadedAssets
         Shader* lit;
         Shader* shadow;
         Shader* text;
+        Shader* text_msdf;
         Shader* ui;
         Shader* vignette;
     } shaders;
     struct
     {
-        struct
-        {
-            struct
-            {
-                struct
-                {
-                    Texture* extractor;
-                    Texture* stone;
-                } buildings;
-            } meshes;
-        } icons;
         Texture* grid;
+        Atlas* icons;
         Texture* palette;
     } textures;
     struct